@@ -120,6 +120,7 @@ class ThinBlockTest(BitcoinTestFramework):
                             "validation_time",
                             "compact_block_size",
                             "compact_full_tx",
+                            "missing_tx_fetch_time",
                             "rerequested"}
 
         # test clear block stats function
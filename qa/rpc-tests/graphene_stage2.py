@@ -14,6 +14,7 @@ logging.getLogger().setLevel(logging.INFO)
 
 class GrapheneStage2Test(BitcoinTestFramework):
     expected_stats = {'enabled', 
+                      'failure_recovery_time', 
                       'filter', 
                       'graphene_additional_tx_size', 
                       'graphene_block_size', 
@@ -10,6 +10,7 @@ from test_framework.util import *
 
 class GrapheneBlockTest(BitcoinTestFramework):
     expected_stats = {'enabled', 
+                      'failure_recovery_time', 
                       'filter', 
                       'graphene_additional_tx_size', 
                       'graphene_block_size', 
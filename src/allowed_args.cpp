@@ -850,7 +850,10 @@ BitcoinBench::BitcoinBench() : AllowedArgs(true)
         .addArg("-plot-width=<x>", ::AllowedArgs::requiredInt,
             strprintf("Plot width in pixel (default: %u)", DEFAULT_PLOT_WIDTH))
         .addArg("-plot-height=<x>", ::AllowedArgs::requiredInt,
-            strprintf("Plot height in pixel (default: %u)", DEFAULT_PLOT_HEIGHT));
+            strprintf("Plot height in pixel (default: %u)", DEFAULT_PLOT_HEIGHT))
+        .addArg("-relaycapture=<dir>", ::AllowedArgs::requiredStr,
+            "Directory of captured experiment logs (expLogFiles) replayed by the RelayReplay benchmarks "
+            "(default: synthetic capture)");
 };
 
 Bitcoind::Bitcoind(CTweakMap *pTweaks) : AllowedArgs(false) { addAllNodeOptions(*this, HMM_BITCOIND, pTweaks); }
@@ -0,0 +1,390 @@
+// Copyright (c) 2019 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_ARENAMAP_H
+#define BITCOIN_ARENAMAP_H
+
+#include "crypto/common.h"
+#include "memusage.h"
+
+#include <assert.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * A hash map whose entries live in an arena of chunks and are found through an open addressing index.
+ *
+ * Entries are never moved once they are constructed, so references and iterators to an entry stay valid until
+ * the entry itself is erased, as they do for std::unordered_map.  The chunks start small, so that short lived
+ * maps stay cheap, and double in size up to MAX_CHUNK_SIZE entries.  Erased entries are reused by later inserts,
+ * and the whole arena is released once the map is empty.
+ *
+ * Each index slot holds the low 32 bits of the key's hash and 1 + the position of the entry in the arena, or 0
+ * if the slot is empty.  Lookups are resolved with linear probing, and only touch an entry when its stored hash
+ * matches.  The index is kept at most 3/4 full and erasing shifts the following slots back, so there are no
+ * tombstones and the index never has to be rebuilt because of erases.
+ *
+ * Iteration is in arena order rather than index order.  Erasing an entry while iterating, or inserting entries
+ * (which may grow the index), does not disturb the iteration: erased entries are skipped and new entries are
+ * either visited later or not at all.
+ *
+ * Up to 2^32 - 1 entries are supported.
+ */
+template <typename K, typename T, typename Hash>
+class arenamap
+{
+public:
+    typedef K key_type;
+    typedef T mapped_type;
+    typedef std::pair<const K, T> value_type;
+    typedef size_t size_type;
+
+    static const uint32_t MIN_CHUNK_BITS = 4;
+    static const uint32_t MAX_CHUNK_BITS = 16;
+    static const uint32_t MAX_CHUNK_SIZE = 1 << MAX_CHUNK_BITS;
+
+private:
+    struct Node
+    {
+        typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type data;
+        //! Low 32 bits of the hash of the key, so that the index can be searched without hashing the key again
+        uint32_t nHash;
+        bool fLive;
+
+        value_type *value() { return reinterpret_cast<value_type *>(&data); }
+        const value_type *value() const { return reinterpret_cast<const value_type *>(&data); }
+    };
+
+    struct Slot
+    {
+        uint32_t nHash;
+        uint32_t nNode;
+        Slot() : nHash(0), nNode(0) {}
+    };
+
+    //! Number of chunks that are smaller than MAX_CHUNK_SIZE, and the entries that they hold together
+    static const uint32_t NUM_GROWING_CHUNKS = MAX_CHUNK_BITS - MIN_CHUNK_BITS;
+    static const uint32_t GROWING_NODES = (1 << MAX_CHUNK_BITS) - (1 << MIN_CHUNK_BITS);
+
+    std::vector<std::unique_ptr<Node[]> > vChunks;
+    //! Every entry below this position has been allocated at some time, and may have been erased since
+    uint32_t nNodes;
+    //! Number of entries that the chunks have room for, and the memory that they take
+    size_t nCapacity;
+    size_t nChunkUsage;
+    //! Positions of erased entries that can be reused
+    std::vector<uint32_t> vFree;
+    //! The open addressing index.  Its size is 0 or a power of 2.
+    std::vector<Slot> vIndex;
+    size_t nSize;
+    Hash hasher;
+
+    static size_t ChunkSize(size_t nChunk)
+    {
+        return nChunk < NUM_GROWING_CHUNKS ? (size_t)1 << (MIN_CHUNK_BITS + nChunk) : MAX_CHUNK_SIZE;
+    }
+
+    Node *NodeAt(uint32_t nNode) const
+    {
+        if (nNode < GROWING_NODES)
+        {
+            // chunk c holds the entries from 2^(c + MIN_CHUNK_BITS) - 2^MIN_CHUNK_BITS on
+            const uint32_t nChunk = CountBits((nNode >> MIN_CHUNK_BITS) + 1) - 1;
+            return &vChunks[nChunk][nNode + (1 << MIN_CHUNK_BITS) - (1 << (MIN_CHUNK_BITS + nChunk))];
+        }
+        nNode -= GROWING_NODES;
+        return &vChunks[NUM_GROWING_CHUNKS + (nNode >> MAX_CHUNK_BITS)][nNode & (MAX_CHUNK_SIZE - 1)];
+    }
+
+    /** Return the slot holding the entry with this key, or the empty slot where it would be inserted */
+    size_t FindSlot(const K &key, uint32_t nHash) const
+    {
+        const size_t nMask = vIndex.size() - 1;
+        size_t nSlot = nHash & nMask;
+        while (vIndex[nSlot].nNode != 0 &&
+               (vIndex[nSlot].nHash != nHash || !(NodeAt(vIndex[nSlot].nNode - 1)->value()->first == key)))
+            nSlot = (nSlot + 1) & nMask;
+        return nSlot;
+    }
+
+    /** Return the slot pointing at the entry at position nNode, which must be in the map */
+    size_t SlotOf(uint32_t nNode) const
+    {
+        const size_t nMask = vIndex.size() - 1;
+        size_t nSlot = NodeAt(nNode)->nHash & nMask;
+        while (vIndex[nSlot].nNode != nNode + 1)
+            nSlot = (nSlot + 1) & nMask;
+        return nSlot;
+    }
+
+    void Rehash(size_t nSlots)
+    {
+        std::vector<Slot> vOld(nSlots);
+        vIndex.swap(vOld);
+        const size_t nMask = nSlots - 1;
+        for (const Slot &slot : vOld)
+        {
+            if (slot.nNode == 0)
+                continue;
+            size_t nSlot = slot.nHash & nMask;
+            while (vIndex[nSlot].nNode != 0)
+                nSlot = (nSlot + 1) & nMask;
+            vIndex[nSlot] = slot;
+        }
+    }
+
+    uint32_t AllocateNode()
+    {
+        if (!vFree.empty())
+        {
+            uint32_t nNode = vFree.back();
+            vFree.pop_back();
+            return nNode;
+        }
+        assert(nNodes < std::numeric_limits<uint32_t>::max());
+        if (nNodes == nCapacity)
+        {
+            const size_t nChunkSize = ChunkSize(vChunks.size());
+            vChunks.emplace_back(new Node[nChunkSize]());
+            nCapacity += nChunkSize;
+            nChunkUsage += memusage::MallocUsage(sizeof(Node) * nChunkSize);
+        }
+        return nNodes++;
+    }
+
+    /** Destroy the entry at position nNode and make it available for reuse */
+    void FreeNode(uint32_t nNode)
+    {
+        Node *node = NodeAt(nNode);
+        node->value()->~value_type();
+        node->fLive = false;
+        vFree.push_back(nNode);
+    }
+
+    /** Empty the slot nSlot, moving back the slots that follow it so that every probe sequence stays unbroken */
+    void EraseSlot(size_t nSlot)
+    {
+        const size_t nMask = vIndex.size() - 1;
+        for (size_t nNext = (nSlot + 1) & nMask; vIndex[nNext].nNode != 0; nNext = (nNext + 1) & nMask)
+        {
+            // the entry in nNext may fill the hole unless its home slot lies after the hole
+            const size_t nHome = vIndex[nNext].nHash & nMask;
+            if (((nNext - nHome) & nMask) >= ((nNext - nSlot) & nMask))
+            {
+                vIndex[nSlot] = vIndex[nNext];
+                nSlot = nNext;
+            }
+        }
+        vIndex[nSlot] = Slot();
+    }
+
+public:
+    template <bool fConst>
+    class iterator_base
+    {
+        friend class arenamap;
+        template <bool>
+        friend class iterator_base;
+        typedef typename std::conditional<fConst, const arenamap, arenamap>::type map_type;
+
+        map_type *map;
+        uint32_t nNode;
+
+        iterator_base(map_type *mapIn, uint32_t nNodeIn) : map(mapIn), nNode(nNodeIn) {}
+        //! Move to the first entry at or after nNode that has not been erased
+        void SkipErased()
+        {
+            while (nNode < map->nNodes && !map->NodeAt(nNode)->fLive)
+                nNode++;
+            if (nNode >= map->nNodes)
+                nNode = END;
+        }
+
+    public:
+        static const uint32_t END = std::numeric_limits<uint32_t>::max();
+
+        typedef std::forward_iterator_tag iterator_category;
+        typedef typename std::conditional<fConst, const arenamap::value_type, arenamap::value_type>::type
+            value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef typename std::conditional<fConst, const arenamap::value_type, arenamap::value_type>::type *pointer;
+        typedef typename std::conditional<fConst, const arenamap::value_type, arenamap::value_type>::type &reference;
+
+        iterator_base() : map(nullptr), nNode(END) {}
+        //! Allow a const_iterator to be made from an iterator
+        template <bool fOtherConst, typename = typename std::enable_if<fConst || !fOtherConst>::type>
+        iterator_base(const iterator_base<fOtherConst> &other) : map(other.map), nNode(other.nNode)
+        {
+        }
+
+        reference operator*() const { return *map->NodeAt(nNode)->value(); }
+        pointer operator->() const { return map->NodeAt(nNode)->value(); }
+        iterator_base &operator++()
+        {
+            nNode++;
+            SkipErased();
+            return *this;
+        }
+        iterator_base operator++(int)
+        {
+            iterator_base copy(*this);
+            ++(*this);
+            return copy;
+        }
+        bool operator==(const iterator_base &other) const { return nNode == other.nNode; }
+        bool operator!=(const iterator_base &other) const { return nNode != other.nNode; }
+    };
+
+    typedef iterator_base<false> iterator;
+    typedef iterator_base<true> const_iterator;
+
+    arenamap() : nNodes(0), nCapacity(0), nChunkUsage(0), nSize(0) {}
+    arenamap(const arenamap &) = delete;
+    arenamap &operator=(const arenamap &) = delete;
+    ~arenamap() { clear(); }
+
+    iterator begin()
+    {
+        iterator it(this, 0);
+        it.SkipErased();
+        return it;
+    }
+    const_iterator begin() const
+    {
+        const_iterator it(this, 0);
+        it.SkipErased();
+        return it;
+    }
+    iterator end() { return iterator(this, iterator::END); }
+    const_iterator end() const { return const_iterator(this, const_iterator::END); }
+
+    size_t size() const { return nSize; }
+    bool empty() const { return nSize == 0; }
+
+    iterator find(const K &key)
+    {
+        if (nSize == 0)
+            return end();
+        const size_t nSlot = FindSlot(key, (uint32_t)hasher(key));
+        return vIndex[nSlot].nNode == 0 ? end() : iterator(this, vIndex[nSlot].nNode - 1);
+    }
+    const_iterator find(const K &key) const
+    {
+        if (nSize == 0)
+            return end();
+        const size_t nSlot = FindSlot(key, (uint32_t)hasher(key));
+        return vIndex[nSlot].nNode == 0 ? end() : const_iterator(this, vIndex[nSlot].nNode - 1);
+    }
+    size_t count(const K &key) const { return find(key) != end(); }
+
+    /**
+     * Construct an entry from args and insert it if its key is not in the map yet.  Returns the entry with that
+     * key and whether it was inserted.
+     */
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args &&... args)
+    {
+        if ((nSize + 1) * 4 > vIndex.size() * 3)
+            Rehash(std::max<size_t>(16, vIndex.size() * 2));
+
+        const uint32_t nNode = AllocateNode();
+        Node *node = NodeAt(nNode);
+        new (node->value()) value_type(std::forward<Args>(args)...);
+        node->nHash = (uint32_t)hasher(node->value()->first);
+
+        const size_t nSlot = FindSlot(node->value()->first, node->nHash);
+        if (vIndex[nSlot].nNode != 0)
+        {
+            node->value()->~value_type();
+            vFree.push_back(nNode);
+            return std::make_pair(iterator(this, vIndex[nSlot].nNode - 1), false);
+        }
+        node->fLive = true;
+        vIndex[nSlot].nHash = node->nHash;
+        vIndex[nSlot].nNode = nNode + 1;
+        nSize++;
+        return std::make_pair(iterator(this, nNode), true);
+    }
+
+    T &operator[](const K &key)
+    {
+        iterator it = find(key);
+        if (it != end())
+            return it->second;
+        return emplace(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple())
+            .first->second;
+    }
+
+    /** Erase the entry at it and return an iterator to the next entry */
+    iterator erase(const_iterator it)
+    {
+        EraseSlot(SlotOf(it.nNode));
+        FreeNode(it.nNode);
+        if (--nSize == 0)
+        {
+            // nothing is left to reuse the arena, so give it back
+            clear();
+            return end();
+        }
+        iterator next(this, it.nNode);
+        ++next;
+        return next;
+    }
+    size_t erase(const K &key)
+    {
+        const_iterator it = find(key);
+        if (it == end())
+            return 0;
+        erase(it);
+        return 1;
+    }
+
+    /** Erase every entry and release all memory */
+    void clear()
+    {
+        for (uint32_t nNode = 0; nNode < nNodes; nNode++)
+        {
+            Node *node = NodeAt(nNode);
+            if (node->fLive)
+                node->value()->~value_type();
+        }
+        std::vector<std::unique_ptr<Node[]> >().swap(vChunks);
+        std::vector<uint32_t>().swap(vFree);
+        std::vector<Slot>().swap(vIndex);
+        nNodes = 0;
+        nCapacity = 0;
+        nChunkUsage = 0;
+        nSize = 0;
+    }
+
+    /**
+     * Memory allocated by the map itself, but not memory owned by the entries.  Erased entries that are waiting
+     * to be reused are not counted, so that erasing entries brings the usage down as it does for a node based
+     * map, even though the arena is only released when the map becomes empty.
+     */
+    size_t DynamicMemoryUsage() const
+    {
+        return memusage::DynamicUsage(vChunks) + memusage::DynamicUsage(vFree) + memusage::DynamicUsage(vIndex) +
+               nChunkUsage - sizeof(Node) * vFree.size();
+    }
+};
+
+namespace memusage
+{
+template <typename X, typename Y, typename Z>
+static inline size_t DynamicUsage(const arenamap<X, Y, Z> &m)
+{
+    return m.DynamicMemoryUsage();
+}
+}
+
+#endif // BITCOIN_ARENAMAP_H
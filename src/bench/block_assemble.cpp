@@ -98,4 +98,78 @@ static void AssembleBlock(benchmark::State &state)
     }
 }
 
+// Templates for a mempool of many independent transactions, where most of the time goes into selecting them. The
+// block candidate kept by the mempool is either reused, as it is between mempool changes, or thrown away before
+// each template to measure a full selection.
+static void AssembleLargeMempool(benchmark::State &state, bool fReuseCandidate)
+{
+    TestingSetup test_setup(CBaseChainParams::REGTEST);
+    const CChainParams &chainparams = Params(CBaseChainParams::REGTEST);
+
+    const CScript redeemScript = CScript() << OP_DROP << OP_TRUE;
+    const CScript SCRIPT_PUB = CScript() << OP_HASH160 << ToByteVector(CScriptID(redeemScript)) << OP_EQUAL;
+
+    const CScript scriptSig = CScript() << std::vector<uint8_t>(100, 0xff) << ToByteVector(redeemScript);
+
+    constexpr size_t NUM_BLOCKS{120};
+    constexpr size_t NUM_FANOUTS{20};
+    constexpr size_t FANOUT_OUTPUTS{250};
+    std::vector<CTxIn> vCoinbases;
+    for (size_t b = 0; b < NUM_BLOCKS; ++b)
+        vCoinbases.push_back(MineBlock(SCRIPT_PUB, chainparams));
+
+    // Split the mature coinbases into many outputs and confirm them
+    std::vector<CTransactionRef> vFanouts;
+    for (size_t i = 0; i < NUM_FANOUTS; i++)
+    {
+        CMutableTransaction tx;
+        tx.vin.push_back(vCoinbases[i]);
+        tx.vin.back().scriptSig = scriptSig;
+        for (size_t j = 0; j < FANOUT_OUTPUTS; j++)
+            tx.vout.emplace_back(4999 * COIN / 100 / FANOUT_OUTPUTS, SCRIPT_PUB);
+        vFanouts.push_back(MakeTransactionRef(tx));
+    }
+    std::vector<CTransactionRef> vSpends;
+    for (const CTransactionRef &fanout : vFanouts)
+    {
+        for (size_t j = 0; j < FANOUT_OUTPUTS; j++)
+        {
+            CMutableTransaction tx;
+            tx.vin.emplace_back(COutPoint(fanout->GetHash(), j), scriptSig);
+            tx.vout.emplace_back(fanout->vout[j].nValue - (1000 + j) * 10, SCRIPT_PUB);
+            vSpends.push_back(MakeTransactionRef(tx));
+        }
+    }
+    for (const std::vector<CTransactionRef> *vtx : {&vFanouts, &vSpends})
+    {
+        {
+            LOCK(cs_main);
+            for (const auto &txr : *vtx)
+            {
+                CValidationState vstate;
+                bool ret{AcceptToMemoryPool(mempool, vstate, txr, false, /* fLimitFree */
+                    nullptr /* pfMissingInputs */, false, /* fOverrideMempoolLimit */
+                    true, /* fRejectAbsurdFee */
+                    TransactionClass::DEFAULT)};
+                assert(ret);
+            }
+        }
+        CommitTxToMempool();
+        if (vtx == &vFanouts)
+            MineBlock(SCRIPT_PUB, chainparams);
+    }
+    assert(mempool.size() == vSpends.size());
+
+    while (state.KeepRunning())
+    {
+        if (!fReuseCandidate)
+            mempool.blockCandidate->Invalidate();
+        PrepareBlock(SCRIPT_PUB, chainparams);
+    }
+}
+
+static void AssembleBlockLargeMempool(benchmark::State &state) { AssembleLargeMempool(state, true); }
+static void AssembleBlockLargeMempoolRebuild(benchmark::State &state) { AssembleLargeMempool(state, false); }
 BENCHMARK(AssembleBlock, 700);
+BENCHMARK(AssembleBlockLargeMempool, 20);
+BENCHMARK(AssembleBlockLargeMempoolRebuild, 20);
@@ -4,9 +4,13 @@
 
 #include "bench.h"
 #include "coins.h"
+#include "crypto/common.h"
 #include "policy/policy.h"
+#include "utiltime.h"
 #include "wallet/crypter.h"
 
+#include <iostream>
+#include <unordered_map>
 #include <vector>
 
 // FIXME: Dedup with SetupDummyInputs in test/transaction_tests.cpp.
@@ -90,3 +94,70 @@ static void CCoinsCaching(benchmark::State &state)
 }
 
 BENCHMARK(CCoinsCaching, 170 * 1000);
+
+static COutPoint NthOutpoint(uint64_t n)
+{
+    uint256 hash;
+    WriteLE64(hash.begin(), n);
+    return COutPoint(hash, n & 3);
+}
+
+/**
+ * Fill a coins map with nEntries coins, look each of them up in a scattered order, then drain the map the way
+ * BatchWrite does, erasing each entry as it is visited.  The time each phase takes and the memory that the map
+ * reports for itself are printed once at the end.
+ */
+template <typename Map>
+static void CoinsMap(benchmark::State &state, const std::string &strName, uint64_t nEntries)
+{
+    const CScript script = CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 1) << OP_EQUALVERIFY
+                                     << OP_CHECKSIG;
+    uint64_t nInsertMicros = 0;
+    uint64_t nFindMicros = 0;
+    uint64_t nDrainMicros = 0;
+    size_t nUsage = 0;
+    uint64_t nRuns = 0;
+    while (state.KeepRunning())
+    {
+        Map map;
+        uint64_t nStart = GetStopwatchMicros();
+        for (uint64_t i = 0; i < nEntries; i++)
+        {
+            CCoinsCacheEntry entry(Coin(CTxOut(i, script), 1, false));
+            entry.flags = CCoinsCacheEntry::DIRTY;
+            map.emplace(NthOutpoint(i), std::move(entry));
+        }
+        nInsertMicros += GetStopwatchMicros() - nStart;
+        nUsage = memusage::DynamicUsage(map);
+
+        // 7919 is prime, so this visits every entry once
+        nStart = GetStopwatchMicros();
+        CAmount nTotal = 0;
+        for (uint64_t i = 0; i < nEntries; i++)
+            nTotal += map.find(NthOutpoint((i * 7919) % nEntries))->second.coin.out.nValue;
+        nFindMicros += GetStopwatchMicros() - nStart;
+        assert(nTotal == (CAmount)(nEntries * (nEntries - 1) / 2));
+
+        nStart = GetStopwatchMicros();
+        for (auto it = map.begin(); it != map.end();)
+            it = map.erase(it);
+        nDrainMicros += GetStopwatchMicros() - nStart;
+        assert(map.empty());
+        nRuns++;
+    }
+    std::cout << "# " << strName << " with " << nEntries << " coins: insert " << nInsertMicros / nRuns / 1000 << " ms, "
+              << "find " << nFindMicros / nRuns / 1000 << " ms, drain " << nDrainMicros / nRuns / 1000
+              << " ms, reported usage " << nUsage / (1024 * 1024) << " MiB" << std::endl;
+}
+
+// The map that CCoinsViewCache used before CCoinsMap
+typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsUnorderedMap;
+
+static void CoinsMapArena10M(benchmark::State &state) { CoinsMap<CCoinsMap>(state, "CCoinsMap", 10 * 1000 * 1000); }
+static void CoinsMapUnordered10M(benchmark::State &state)
+{
+    CoinsMap<CCoinsUnorderedMap>(state, "unordered_map", 10 * 1000 * 1000);
+}
+
+BENCHMARK(CoinsMapArena10M, 1);
+BENCHMARK(CoinsMapUnordered10M, 1);
@@ -4,6 +4,7 @@
 
 #include "checkqueue.h"
 #include "bench.h"
+#include "hashwrapper.h"
 #include "key.h"
 #include "prevector.h"
 #include "pubkey.h"
@@ -68,3 +69,60 @@ static void CCheckQueueSpeedPrevectorJob(benchmark::State &state)
     ECC_Stop();
 }
 BENCHMARK(CCheckQueueSpeedPrevectorJob, 1400);
+
+// Sweeps the number of script check threads over a block's worth of cheap checks, added a couple at a time as
+// ConnectBlock adds the inputs of each transaction. Each check hashes a little so that the sweep measures how
+// the queue spreads the work rather than how long one check takes.
+static const size_t SCALING_CHECKS = 100000;
+static const size_t SCALING_CHECKS_PER_ADD = 2;
+
+static void CCheckQueueScaling(benchmark::State &state, int nThreads)
+{
+    struct HashJob
+    {
+        uint256 hash;
+        HashJob() {}
+        explicit HashJob(uint64_t n) { hash = Hash(BEGIN(n), END(n)); }
+        bool operator()()
+        {
+            hash = Hash(hash.begin(), hash.end());
+            return true;
+        }
+        void swap(HashJob &x) { std::swap(hash, x.hash); };
+    };
+    CCheckQueue<HashJob> queue{QUEUE_BATCH_SIZE};
+    boost::thread_group tg;
+    for (auto x = 0; x < nThreads; ++x)
+    {
+        tg.create_thread([&] { queue.Thread(); });
+    }
+    while (state.KeepRunning())
+    {
+        CCheckQueueControl<HashJob> control(&queue);
+        for (size_t i = 0; i < SCALING_CHECKS; i += SCALING_CHECKS_PER_ADD)
+        {
+            std::vector<HashJob> vChecks;
+            for (size_t x = 0; x < SCALING_CHECKS_PER_ADD; ++x)
+                vChecks.emplace_back(i + x);
+            control.Add(vChecks);
+        }
+        control.Wait();
+    }
+    tg.interrupt_all();
+    tg.join_all();
+}
+
+static void CCheckQueueScaling1(benchmark::State &state) { CCheckQueueScaling(state, 1); }
+static void CCheckQueueScaling2(benchmark::State &state) { CCheckQueueScaling(state, 2); }
+static void CCheckQueueScaling4(benchmark::State &state) { CCheckQueueScaling(state, 4); }
+static void CCheckQueueScaling8(benchmark::State &state) { CCheckQueueScaling(state, 8); }
+static void CCheckQueueScaling16(benchmark::State &state) { CCheckQueueScaling(state, 16); }
+static void CCheckQueueScaling32(benchmark::State &state) { CCheckQueueScaling(state, 32); }
+static void CCheckQueueScaling64(benchmark::State &state) { CCheckQueueScaling(state, 64); }
+BENCHMARK(CCheckQueueScaling1, 5);
+BENCHMARK(CCheckQueueScaling2, 5);
+BENCHMARK(CCheckQueueScaling4, 5);
+BENCHMARK(CCheckQueueScaling8, 5);
+BENCHMARK(CCheckQueueScaling16, 5);
+BENCHMARK(CCheckQueueScaling32, 5);
+BENCHMARK(CCheckQueueScaling64, 5);
@@ -0,0 +1,89 @@
+// Copyright (c) 2019 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "coins.h"
+#include "primitives/block.h"
+#include "random.h"
+#include "utiltime.h"
+#include "validation/validation.h"
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <thread>
+
+/**
+ * A coins database that takes nLatencyMicros to answer each read, like a disk read that misses the OS cache.
+ * Reads do not modify the map, so any number of threads can read at once.
+ */
+class CCoinsViewSlow : public CCoinsView
+{
+    std::map<COutPoint, Coin> mapCoins;
+    const int64_t nLatencyMicros;
+
+public:
+    CCoinsViewSlow(int64_t nLatencyMicrosIn) : nLatencyMicros(nLatencyMicrosIn) {}
+    void Add(const COutPoint &outpoint, const Coin &coin) { mapCoins.emplace(outpoint, coin); }
+    bool GetCoin(const COutPoint &outpoint, Coin &coin) const override
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(nLatencyMicros));
+        auto it = mapCoins.find(outpoint);
+        if (it == mapCoins.end())
+            return false;
+        coin = it->second;
+        return true;
+    }
+};
+
+/**
+ * Look up every input of a block of nInputs inputs through a cold coins cache, as ConnectBlock does, with or
+ * without prefetching the coins first. The time spent on the lookups, including the prefetch, is printed once at
+ * the end.
+ */
+static void CoinsPrefetch(benchmark::State &state, bool fPrefetch)
+{
+    const size_t nInputs = 2000;
+    FastRandomContext rand(true);
+    CCoinsViewSlow db(50);
+    CBlock block;
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vout.resize(1);
+    block.vtx.push_back(MakeTransactionRef(coinbase));
+    for (size_t i = 0; i < nInputs; i++)
+    {
+        const COutPoint outpoint(rand.rand256(), 0);
+        db.Add(outpoint, Coin(CTxOut(1000, CScript() << OP_TRUE), 1, false));
+        CMutableTransaction tx;
+        tx.vin.push_back(CTxIn(outpoint));
+        tx.vout.resize(1);
+        block.vtx.push_back(MakeTransactionRef(tx));
+    }
+
+    uint64_t nMicros = 0;
+    uint64_t nBlocks = 0;
+    while (state.KeepRunning())
+    {
+        CCoinsViewCache tip(&db);
+        CCoinsViewCache view(&tip);
+        const uint64_t nStart = GetStopwatchMicros();
+        if (fPrefetch)
+            PrefetchBlockCoins(block, &tip);
+        for (size_t i = 1; i < block.vtx.size(); i++)
+        {
+            CoinAccessor coin(view, block.vtx[i]->vin[0].prevout);
+            assert(!coin->IsSpent());
+        }
+        nMicros += GetStopwatchMicros() - nStart;
+        nBlocks++;
+    }
+    std::cout << "# " << (fPrefetch ? "prefetched" : "serial") << " lookup of " << nInputs
+              << " cold inputs: " << nMicros / nBlocks / 1000.0 << " ms" << std::endl;
+}
+
+static void CoinsPrefetchSerial(benchmark::State &state) { CoinsPrefetch(state, false); }
+static void CoinsPrefetchParallel(benchmark::State &state) { CoinsPrefetch(state, true); }
+BENCHMARK(CoinsPrefetchSerial, 2);
+BENCHMARK(CoinsPrefetchParallel, 2);
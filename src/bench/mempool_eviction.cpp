@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "bench.h"
+#include "random.h"
 #include "txmempool.h"
 
 static void AddTx(const CTransactionRef &tx, const CAmount &nFee, CTxMemPool &pool)
@@ -116,3 +117,115 @@ static void MempoolEviction(benchmark::State &state)
 }
 
 BENCHMARK(MempoolEviction, 41000);
+
+// A mainnet-like backlog: independent transactions of the same size paying one of a handful of fees, so that
+// entries with equal fee rates, which are ordered by txid or time, are common. Only the most recently requested
+// size is kept in memory.
+static const size_t LARGE_MEMPOOL_TXS = 500000;
+
+static CTxMemPool &LargeMempool(size_t nTxs, std::vector<uint256> &vHashes, std::vector<COutPoint> &vPrevouts)
+{
+    static std::unique_ptr<CTxMemPool> pool;
+    static std::vector<uint256> vPoolHashes;
+    static std::vector<COutPoint> vPoolPrevouts;
+    if (vPoolHashes.size() != nTxs)
+    {
+        pool.reset();
+        pool.reset(new CTxMemPool(CFeeRate(1000)));
+        vPoolHashes.clear();
+        vPoolPrevouts.clear();
+        FastRandomContext rand(true);
+        for (size_t i = 0; i < nTxs; i++)
+        {
+            CMutableTransaction tx;
+            tx.vin.resize(1);
+            tx.vin[0].prevout = COutPoint(rand.rand256(), 0);
+            tx.vin[0].scriptSig = CScript() << OP_1;
+            tx.vout.resize(1);
+            tx.vout[0].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+            tx.vout[0].nValue = 10 * COIN;
+            const CTransactionRef txr = MakeTransactionRef(tx);
+            AddTx(txr, 1000 + 100 * rand.randrange(8), *pool);
+            vPoolHashes.push_back(txr->GetHash());
+            vPoolPrevouts.push_back(tx.vin[0].prevout);
+        }
+    }
+    vHashes = vPoolHashes;
+    vPrevouts = vPoolPrevouts;
+    return *pool;
+}
+
+// Find random transactions by txid
+static void MempoolLargeLookup(benchmark::State &state)
+{
+    std::vector<uint256> vHashes;
+    std::vector<COutPoint> vPrevouts;
+    CTxMemPool &pool = LargeMempool(LARGE_MEMPOOL_TXS, vHashes, vPrevouts);
+    FastRandomContext rand(true);
+    while (state.KeepRunning())
+    {
+        size_t nFound = 0;
+        for (int i = 0; i < 50000; i++)
+            nFound += pool.exists(vHashes[rand.randrange(vHashes.size())]);
+        assert(nFound == 50000);
+    }
+}
+
+// Change the fee delta of random transactions, which moves them within the fee ordered indexes
+static void MempoolLargeReprioritise(benchmark::State &state)
+{
+    std::vector<uint256> vHashes;
+    std::vector<COutPoint> vPrevouts;
+    CTxMemPool &pool = LargeMempool(LARGE_MEMPOOL_TXS, vHashes, vPrevouts);
+    FastRandomContext rand(true);
+    while (state.KeepRunning())
+    {
+        WRITELOCK(pool.cs_txmempool);
+        for (int i = 0; i < 50000; i++)
+        {
+            CTxMemPool::txiter it = pool.mapTx.find(vHashes[rand.randrange(vHashes.size())]);
+            pool.mapTx.modify(it, update_fee_delta(100 * rand.randrange(8)));
+        }
+    }
+}
+
+// The conflict checks done for every admitted transaction: is the outpoint already spent by a mempool
+// transaction, and does the transaction spend any mempool transaction. Half of the lookups hit.
+static void MempoolSpentLookup(benchmark::State &state, size_t nTxs)
+{
+    std::vector<uint256> vHashes;
+    std::vector<COutPoint> vPrevouts;
+    CTxMemPool &pool = LargeMempool(nTxs, vHashes, vPrevouts);
+    FastRandomContext rand(true);
+    std::vector<CTransactionRef> vSpends;
+    for (int i = 0; i < 25000; i++)
+    {
+        const size_t n = rand.randrange(vPrevouts.size());
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = (i & 1) ? vPrevouts[n] : COutPoint(vHashes[n], 0);
+        vSpends.push_back(MakeTransactionRef(tx));
+    }
+    while (state.KeepRunning())
+    {
+        size_t nSpent = 0;
+        size_t nNoInputs = 0;
+        for (const CTransactionRef &tx : vSpends)
+        {
+            {
+                WRITELOCK(pool.cs_txmempool);
+                nSpent += pool.isSpent(tx->vin[0].prevout);
+            }
+            nNoInputs += pool.HasNoInputsOf(tx);
+        }
+        assert(nSpent == 12500);
+        assert(nNoInputs == 12500);
+    }
+}
+
+static void MempoolSpentLookup100k(benchmark::State &state) { MempoolSpentLookup(state, 100000); }
+static void MempoolSpentLookup1M(benchmark::State &state) { MempoolSpentLookup(state, 1000000); }
+BENCHMARK(MempoolLargeLookup, 10);
+BENCHMARK(MempoolLargeReprioritise, 10);
+BENCHMARK(MempoolSpentLookup100k, 10);
+BENCHMARK(MempoolSpentLookup1M, 10);
@@ -0,0 +1,87 @@
+// Copyright (c) 2019 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "random.h"
+#include "txadmission.h"
+#include "txmempool.h"
+#include "utiltime.h"
+
+#include <iostream>
+
+static CTransactionRef MakeTx(const COutPoint &prevout, FastRandomContext &rand)
+{
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = prevout;
+    tx.vin[0].scriptSig = CScript() << OP_1;
+    tx.vout.resize(1);
+    tx.vout[0].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+    tx.vout[0].nValue = rand.randrange(10 * COIN);
+    return MakeTransactionRef(tx);
+}
+
+static void AddTx(const CTransactionRef &tx, CTxMemPool &pool)
+{
+    LockPoints lp;
+    pool.addUnchecked(tx->GetHash(), CTxMemPoolEntry(tx, 1000, 0, 10.0, 1, false, tx->GetValueOut(), false, 1, lp));
+}
+
+/**
+ * Connect a block of nBlockTxs transactions to a mempool holding half of them. Each of those has a child left
+ * behind in the mempool, so the children's ancestor state is updated. A tenth of the block's other transactions
+ * double spend a mempool transaction, which is removed as a conflict. The mempool is refilled before every
+ * block; the time spent in removeForBlock alone is printed once at the end.
+ */
+static void MempoolRemoveForBlock(benchmark::State &state, size_t nBlockTxs)
+{
+    FastRandomContext rand(true);
+    std::vector<CTransactionRef> vBlock;
+    std::vector<CTransactionRef> vPool;
+    for (size_t i = 0; i < nBlockTxs / 2; i++)
+    {
+        CTransactionRef parent = MakeTx(COutPoint(rand.rand256(), 0), rand);
+        vBlock.push_back(parent);
+        vPool.push_back(parent);
+        vPool.push_back(MakeTx(COutPoint(parent->GetHash(), 0), rand));
+    }
+    for (size_t i = 0; i < nBlockTxs / 2; i++)
+    {
+        const COutPoint prevout(rand.rand256(), 0);
+        vBlock.push_back(MakeTx(prevout, rand));
+        if (i % 5 == 0)
+            vPool.push_back(MakeTx(prevout, rand));
+    }
+
+    // removeForBlock resubmits the commit queue, which only the admission threads normally create
+    {
+        boost::unique_lock<boost::mutex> lock(csCommitQ);
+        if (txCommitQ == nullptr)
+            txCommitQ = new CTxCommitBatch();
+    }
+
+    uint64_t nRemoveMicros = 0;
+    uint64_t nBlocks = 0;
+    while (state.KeepRunning())
+    {
+        CTxMemPool pool(CFeeRate(1000));
+        for (const CTransactionRef &tx : vPool)
+            AddTx(tx, pool);
+
+        std::list<CTransactionRef> conflicts;
+        const uint64_t nStart = GetStopwatchMicros();
+        pool.removeForBlock(vBlock, 1, conflicts, false);
+        nRemoveMicros += GetStopwatchMicros() - nStart;
+        nBlocks++;
+        assert(conflicts.size() == nBlockTxs / 10);
+        assert(pool.size() == nBlockTxs / 2);
+    }
+    std::cout << "# removeForBlock of a " << nBlockTxs << " tx block: " << nRemoveMicros / nBlocks / 1000.0 << " ms"
+              << std::endl;
+}
+
+static void MempoolRemoveForBlock10k(benchmark::State &state) { MempoolRemoveForBlock(state, 10000); }
+static void MempoolRemoveForBlock100k(benchmark::State &state) { MempoolRemoveForBlock(state, 100000); }
+BENCHMARK(MempoolRemoveForBlock10k, 5);
+BENCHMARK(MempoolRemoveForBlock100k, 2);
@@ -0,0 +1,264 @@
+// Copyright (c) 2019 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "blockrelay/compactblock.h"
+#include "blockrelay/graphene.h"
+#include "blockrelay/graphene_set.h"
+#include "random.h"
+#include "serialize.h"
+#include "uint256.h"
+#include "util.h"
+#include "version.h"
+
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <unordered_map>
+
+/**
+ * Replay of captured block relay traffic.
+ *
+ * The experiment logger (logFile.cpp) records, for every block received, the transaction ids of the block under
+ * <capture>/blocktxs/<type>/<blockhash>/<peer> and a snapshot of the mempool at the time the block arrived under
+ * <capture>/mempool/<blockhash>/<peer>. Pass the expLogFiles directory with -relaycapture=<dir> and these benchmarks
+ * rebuild each recorded block from its mempool snapshot with the compact block, xthin and graphene short id
+ * schemes. The short ids recorded in cmpctblk and grapheneblockreqtxs were salted by the sending peer, so they are
+ * recomputed here from the recorded txids.
+ *
+ * Each benchmark prints, once, the wire bytes needed per protocol and how many transactions would have had to be
+ * re-requested. Without -relaycapture a synthetic capture is generated.
+ */
+
+struct CRelayCapture
+{
+    std::string name;
+    std::vector<uint256> vBlockTx;
+    std::vector<uint256> vMempoolTx;
+};
+
+static std::vector<uint256> ReadHashes(const boost::filesystem::path &path)
+{
+    std::vector<uint256> vHashes;
+    std::ifstream in(path.string());
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (line.size() == 64 && IsHex(line))
+            vHashes.push_back(uint256S(line));
+    }
+    return vHashes;
+}
+
+static std::vector<CRelayCapture> LoadCaptures(const std::string &strDir)
+{
+    namespace fs = boost::filesystem;
+
+    std::vector<CRelayCapture> vCaptures;
+    const fs::path blockDir = fs::path(strDir) / "blocktxs";
+    const fs::path mempoolDir = fs::path(strDir) / "mempool";
+    if (!fs::is_directory(blockDir))
+        return vCaptures;
+
+    // blocktxs/<type>/<blockhash>/<peer> paired with mempool/<blockhash>/<peer>
+    for (fs::directory_iterator type(blockDir); type != fs::directory_iterator(); ++type)
+    {
+        if (!fs::is_directory(type->path()))
+            continue;
+        for (fs::directory_iterator block(type->path()); block != fs::directory_iterator(); ++block)
+        {
+            if (!fs::is_directory(block->path()))
+                continue;
+            for (fs::directory_iterator peer(block->path()); peer != fs::directory_iterator(); ++peer)
+            {
+                const fs::path mempoolFile = mempoolDir / block->path().filename() / peer->path().filename();
+                if (!fs::is_regular_file(mempoolFile))
+                    continue;
+
+                CRelayCapture capture;
+                capture.name = block->path().filename().string();
+                capture.vBlockTx = ReadHashes(peer->path());
+                capture.vMempoolTx = ReadHashes(mempoolFile);
+                if (!capture.vBlockTx.empty())
+                    vCaptures.push_back(std::move(capture));
+            }
+        }
+    }
+    return vCaptures;
+}
+
+// A mainnet-like capture: a 2000 tx block, 2 of which were not in the mempool, and a 5000 tx mempool backlog
+static std::vector<CRelayCapture> SyntheticCaptures()
+{
+    FastRandomContext rand(true);
+    std::vector<CRelayCapture> vCaptures(5);
+    for (size_t i = 0; i < vCaptures.size(); i++)
+    {
+        CRelayCapture &capture = vCaptures[i];
+        capture.name = "synthetic" + std::to_string(i);
+        for (int j = 0; j < 2000; j++)
+        {
+            capture.vBlockTx.push_back(rand.rand256());
+            if (j % 1000 != 0)
+                capture.vMempoolTx.push_back(capture.vBlockTx.back());
+        }
+        for (int j = 0; j < 5000; j++)
+            capture.vMempoolTx.push_back(rand.rand256());
+    }
+    return vCaptures;
+}
+
+static const std::vector<CRelayCapture> &GetCaptures()
+{
+    static std::vector<CRelayCapture> vCaptures;
+    static bool fLoaded = false;
+    if (!fLoaded)
+    {
+        const std::string strDir = GetArg("-relaycapture", "");
+        if (!strDir.empty())
+            vCaptures = LoadCaptures(strDir);
+        if (vCaptures.empty())
+            vCaptures = SyntheticCaptures();
+        fLoaded = true;
+    }
+    return vCaptures;
+}
+
+static void PrintReplayStats(const std::string &strProtocol, uint64_t nBytes, uint64_t nMissing, uint64_t nFailed)
+{
+    std::cout << "# " << strProtocol << " replay of " << GetCaptures().size() << " blocks: " << nBytes << " bytes, "
+              << nMissing << " txs re-requested, " << nFailed << " failed reconstructions" << std::endl;
+}
+
+/** Rebuild the block's short id list from the mempool the way CompactBlock::process does. */
+static void RelayReplayCompact(benchmark::State &state)
+{
+    const std::vector<CRelayCapture> &vCaptures = GetCaptures();
+    const uint64_t k0 = 0x0706050403020100ULL;
+    const uint64_t k1 = 0x0f0e0d0c0b0a0908ULL;
+    uint64_t nBytes = 0;
+    uint64_t nMissing = 0;
+    bool fFirst = true;
+    while (state.KeepRunning())
+    {
+        for (const CRelayCapture &capture : vCaptures)
+        {
+            // sender
+            std::vector<uint64_t> vShortIds;
+            vShortIds.reserve(capture.vBlockTx.size());
+            for (const uint256 &hash : capture.vBlockTx)
+                vShortIds.push_back(GetShortID(k0, k1, hash));
+
+            // receiver
+            std::unordered_map<uint64_t, uint256> mapPartialTxHash;
+            mapPartialTxHash.reserve(capture.vMempoolTx.size());
+            for (const uint256 &hash : capture.vMempoolTx)
+                mapPartialTxHash.emplace(GetShortID(k0, k1, hash), hash);
+
+            uint64_t nMissingTx = 0;
+            for (uint64_t shortid : vShortIds)
+                nMissingTx += !mapPartialTxHash.count(shortid);
+
+            if (fFirst)
+            {
+                // header, nonce, compact size and 6 byte short ids
+                nBytes += 80 + 8 + GetSizeOfCompactSize(vShortIds.size()) + 6 * vShortIds.size();
+                nMissing += nMissingTx;
+            }
+        }
+        fFirst = false;
+    }
+    PrintReplayStats("compact block", nBytes, nMissing, 0);
+}
+
+/** Rebuild the block's cheap hash list from the mempool the way CXThinBlock::process does. */
+static void RelayReplayXthin(benchmark::State &state)
+{
+    const std::vector<CRelayCapture> &vCaptures = GetCaptures();
+    uint64_t nBytes = 0;
+    uint64_t nMissing = 0;
+    bool fFirst = true;
+    while (state.KeepRunning())
+    {
+        for (const CRelayCapture &capture : vCaptures)
+        {
+            // sender
+            std::vector<uint64_t> vTxHashes;
+            vTxHashes.reserve(capture.vBlockTx.size());
+            for (const uint256 &hash : capture.vBlockTx)
+                vTxHashes.push_back(hash.GetCheapHash());
+
+            // receiver
+            std::map<uint64_t, uint256> mapPartialTxHash;
+            for (const uint256 &hash : capture.vMempoolTx)
+                mapPartialTxHash.emplace(hash.GetCheapHash(), hash);
+
+            uint64_t nMissingTx = 0;
+            for (uint64_t cheapHash : vTxHashes)
+                nMissingTx += !mapPartialTxHash.count(cheapHash);
+
+            if (fFirst)
+            {
+                // header, compact size and 8 byte cheap hashes
+                nBytes += 80 + GetSizeOfCompactSize(vTxHashes.size()) + 8 * vTxHashes.size();
+                nMissing += nMissingTx;
+            }
+        }
+        fFirst = false;
+    }
+    PrintReplayStats("xthin", nBytes, nMissing, 0);
+}
+
+/** Encode each block as a graphene set sized for the receiver's mempool, then reconcile it against that mempool. */
+static void RelayReplayGraphene(benchmark::State &state)
+{
+    const std::vector<CRelayCapture> &vCaptures = GetCaptures();
+    const uint64_t k0 = 0x0706050403020100ULL;
+    const uint64_t k1 = 0x0f0e0d0c0b0a0908ULL;
+    uint64_t nBytes = 0;
+    uint64_t nMissing = 0;
+    uint64_t nFailed = 0;
+    bool fFirst = true;
+    while (state.KeepRunning())
+    {
+        for (const CRelayCapture &capture : vCaptures)
+        {
+            // sender
+            CGrapheneSet senderSet(capture.vMempoolTx.size(), capture.vMempoolTx.size(), capture.vBlockTx, k0, k1,
+                GRAPHENE_MAX_VERSION_SUPPORTED, 0, false, true, true);
+
+            // receiver
+            uint64_t nMissingTx = 0;
+            bool fDecoded = true;
+            try
+            {
+                std::vector<uint64_t> vBlockCheapHashes = senderSet.Reconcile(capture.vMempoolTx);
+                std::set<uint64_t> setMempool;
+                for (const uint256 &hash : capture.vMempoolTx)
+                    setMempool.insert(senderSet.GetShortID(hash));
+                for (uint64_t cheapHash : vBlockCheapHashes)
+                    nMissingTx += !setMempool.count(cheapHash);
+            }
+            catch (const std::runtime_error &)
+            {
+                fDecoded = false;
+            }
+
+            if (fFirst)
+            {
+                // header plus the graphene set
+                nBytes += 80 + ::GetSerializeSize(senderSet, SER_NETWORK, PROTOCOL_VERSION);
+                nMissing += nMissingTx;
+                nFailed += !fDecoded;
+            }
+        }
+        fFirst = false;
+    }
+    PrintReplayStats("graphene", nBytes, nMissing, nFailed);
+}
+
+BENCHMARK(RelayReplayCompact, 50);
+BENCHMARK(RelayReplayXthin, 50);
+BENCHMARK(RelayReplayGraphene, 5);
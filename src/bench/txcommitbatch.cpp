@@ -0,0 +1,80 @@
+// Copyright (c) 2019 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "random.h"
+#include "txadmission.h"
+
+#include <map>
+#include <vector>
+
+// Synthetic load: commit cycles of 10000 validated transactions.  Each cycle fills the commit queue, looks every
+// transaction up once (as CommitQGet and the inventory checks do), iterates the queue and then discards it.
+static const size_t NUM_TXS = 10000;
+
+static const std::vector<CTxCommitData> &SyntheticCommits()
+{
+    static std::vector<CTxCommitData> vCommits;
+    if (vCommits.empty())
+    {
+        FastRandomContext rand(true);
+        for (size_t i = 0; i < NUM_TXS; i++)
+        {
+            CMutableTransaction tx;
+            tx.vin.resize(1);
+            tx.vin[0].prevout = COutPoint(rand.rand256(), 0);
+            tx.vout.resize(1);
+            tx.vout[0].nValue = i;
+            CTxCommitData data;
+            data.entry = CTxMemPoolEntry(MakeTransactionRef(tx), 0, 0, 0.0, 1, false, 0, false, 1, LockPoints());
+            data.hash = data.entry.GetTx().GetHash();
+            vCommits.push_back(data);
+        }
+    }
+    return vCommits;
+}
+
+static void TxCommitBatchRecycled(benchmark::State &state)
+{
+    const std::vector<CTxCommitData> &vCommits = SyntheticCommits();
+    CTxCommitBatch *batch = new CTxCommitBatch();
+    while (state.KeepRunning())
+    {
+        for (const CTxCommitData &data : vCommits)
+        {
+            CTxCommitData copy = data;
+            batch->insert(std::move(copy));
+        }
+        size_t nFound = 0;
+        for (const CTxCommitData &data : vCommits)
+            nFound += batch->count(data.hash);
+        for (const CTxCommitData &data : *batch)
+            nFound += data.entry.GetTxSize() != 0;
+        assert(nFound == 2 * vCommits.size());
+        batch->clear();
+    }
+    delete batch;
+}
+
+// The heap allocated map that CTxCommitBatch replaced, for comparison
+static void TxCommitBatchMap(benchmark::State &state)
+{
+    const std::vector<CTxCommitData> &vCommits = SyntheticCommits();
+    while (state.KeepRunning())
+    {
+        std::map<uint256, CTxCommitData> *batch = new std::map<uint256, CTxCommitData>();
+        for (const CTxCommitData &data : vCommits)
+            batch->emplace(data.hash, data);
+        size_t nFound = 0;
+        for (const CTxCommitData &data : vCommits)
+            nFound += batch->count(data.hash);
+        for (const auto &it : *batch)
+            nFound += it.second.entry.GetTxSize() != 0;
+        assert(nFound == 2 * vCommits.size());
+        delete batch;
+    }
+}
+
+BENCHMARK(TxCommitBatchRecycled, 50);
+BENCHMARK(TxCommitBatchMap, 50);
@@ -9,7 +9,9 @@
 #include "script/bitcoinconsensus.h"
 #endif
 #include "script/script.h"
+#include "script/sigcache.h"
 #include "script/sign.h"
+#include "script/standard.h"
 #include "streams.h"
 
 #include <array>
@@ -97,3 +99,69 @@ static void VerifyScriptBench(benchmark::State &state)
 }
 
 BENCHMARK(VerifyScriptBench, 6300);
+
+/**
+ * Verify the scripts of a block of nInputs P2PKH spends, each signed with Schnorr by a different key, either one
+ * signature at a time or handing the signatures to a CSchnorrBatch as the parallel script checks do.
+ */
+static void VerifyScriptSchnorrBlock(benchmark::State &state, bool fBatch)
+{
+    const ECCVerifyHandle verify_handle;
+    ECC_Start();
+    static bool fSigCache = false;
+    if (!fSigCache)
+    {
+        // the checkers consult the signature cache, which needs to be set up before use
+        InitSignatureCache();
+        fSigCache = true;
+    }
+
+    const int nInputs = 1000;
+    const uint32_t flags =
+        SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_STRICTENC | SCRIPT_VERIFY_NULLFAIL | SCRIPT_ENABLE_SIGHASH_FORKID;
+    const uint32_t nHashType = SIGHASH_ALL | SIGHASH_FORKID;
+
+    std::vector<CMutableTransaction> vCredit;
+    std::vector<CTransaction> vSpend;
+    for (int i = 0; i < nInputs; i++)
+    {
+        CKey key;
+        std::array<unsigned char, 32> vchKey = {};
+        vchKey[30] = (i + 1) >> 8;
+        vchKey[31] = (i + 1) & 0xff;
+        key.Set(vchKey.begin(), vchKey.end(), true);
+        CPubKey pubkey = key.GetPubKey();
+        CScript scriptPubKey = GetScriptForDestination(pubkey.GetID());
+        vCredit.push_back(BuildCreditingTransaction(scriptPubKey));
+        CMutableTransaction txSpend = BuildSpendingTransaction(CScript(), vCredit.back());
+        uint256 sighash = SignatureHash(scriptPubKey, txSpend, 0, nHashType, vCredit.back().vout[0].nValue);
+        std::vector<unsigned char> vchSig;
+        key.SignSchnorr(sighash, vchSig);
+        vchSig.push_back(static_cast<unsigned char>(nHashType));
+        txSpend.vin[0].scriptSig = CScript() << vchSig << ToByteVector(pubkey);
+        vSpend.push_back(CTransaction(txSpend));
+    }
+
+    while (state.KeepRunning())
+    {
+        CSchnorrBatch batch;
+        for (int i = 0; i < nInputs; i++)
+        {
+            ScriptError err;
+            bool success = VerifyScript(vSpend[i].vin[0].scriptSig, vCredit[i].vout[0].scriptPubKey, flags,
+                MAX_OPS_PER_SCRIPT, CBatchingTransactionSignatureChecker(&vSpend[i], 0, vCredit[i].vout[0].nValue,
+                                        flags, false, fBatch ? &batch : nullptr),
+                &err);
+            assert(err == SCRIPT_ERR_OK);
+            assert(success);
+        }
+        bool fValid = batch.Flush();
+        assert(fValid);
+    }
+    ECC_Stop();
+}
+
+static void VerifyScriptSchnorrBlockSingle(benchmark::State &state) { VerifyScriptSchnorrBlock(state, false); }
+static void VerifyScriptSchnorrBlockBatched(benchmark::State &state) { VerifyScriptSchnorrBlock(state, true); }
+BENCHMARK(VerifyScriptSchnorrBlockSingle, 10);
+BENCHMARK(VerifyScriptSchnorrBlockBatched, 10);
@@ -16,6 +16,11 @@
 // of nodes is connecting.
 static unsigned int NODE_PADDING = 5;
 
+// How long, in microseconds, we remember a missing transaction request that was sent to more than one peer.
+// Responses that arrive after the first one are dropped silently for this long rather than being treated
+// as unrequested.
+static const int64_t MISSING_TX_FETCH_EXPIRY = 60 * 1000000;
+
 bool IsThinBlockEnabled();
 bool IsGrapheneBlockEnabled();
 bool IsCompactBlocksEnabled();
@@ -422,3 +427,51 @@ void ThinTypeRelay::ClearAllBlockData(CNode *pnode, const uint256 &hash)
     ClearBlockToReconstruct(pnode->GetId(), hash);
     ClearBlockInFlight(pnode->GetId(), hash);
 }
+
+void ThinTypeRelay::AddMissingTxFetch(NodeId announcer, const uint256 &hash, const std::set<NodeId> &setOtherPeers)
+{
+    int64_t nNow = GetTimeMicros();
+
+    LOCK(cs_missingtxfetch);
+    // Remove any old entries. There can only be a few thin type blocks in flight at a time so this map is small.
+    for (auto it = mapMissingTxFetch.begin(); it != mapMissingTxFetch.end();)
+    {
+        if (nNow - it->second.nRequestTime > MISSING_TX_FETCH_EXPIRY)
+            it = mapMissingTxFetch.erase(it);
+        else
+            it++;
+    }
+    mapMissingTxFetch[hash] = CMissingTxFetch{announcer, setOtherPeers, nNow, false};
+}
+
+bool ThinTypeRelay::GetMissingTxFetchAnnouncer(NodeId id, const uint256 &hash, NodeId &announcer)
+{
+    // Return the announcing peer if this node was one of the other peers we also sent the request to.
+    LOCK(cs_missingtxfetch);
+    auto it = mapMissingTxFetch.find(hash);
+    if (it == mapMissingTxFetch.end() || !it->second.setOtherPeers.count(id))
+        return false;
+
+    announcer = it->second.announcer;
+    return true;
+}
+
+bool ThinTypeRelay::IsMissingTxFetchAnswered(const uint256 &hash)
+{
+    LOCK(cs_missingtxfetch);
+    auto it = mapMissingTxFetch.find(hash);
+    return (it != mapMissingTxFetch.end() && it->second.fAnswered);
+}
+
+bool ThinTypeRelay::ClaimMissingTxFetch(const uint256 &hash, CMissingTxFetch &fetch)
+{
+    // The first response to claim the request is the one used for reconstruction, all others are dropped.
+    LOCK(cs_missingtxfetch);
+    auto it = mapMissingTxFetch.find(hash);
+    if (it == mapMissingTxFetch.end() || it->second.fAnswered)
+        return false;
+
+    it->second.fAnswered = true;
+    fetch = it->second;
+    return true;
+}
@@ -15,6 +15,8 @@ class CNode;
 class uint256;
 class CBlockThinRelay;
 
+extern CTweak<unsigned int> missingTxFetchPeers;
+
 struct CThinTypeBlockInFlight
 {
     uint256 hash;
@@ -32,6 +34,16 @@ struct CThinTypeBlockInFlight
     }
 };
 
+// A missing transaction request that was sent to the announcing peer and, speculatively, to other peers
+// that have the same block.
+struct CMissingTxFetch
+{
+    NodeId announcer;
+    std::set<NodeId> setOtherPeers;
+    int64_t nRequestTime; // in microseconds
+    bool fAnswered;
+};
+
 
 class ThinTypeRelay
 {
@@ -56,6 +68,10 @@ private:
     std::map<NodeId, std::map<uint256, std::shared_ptr<CBlockThinRelay> > > mapBlocksReconstruct GUARDED_BY(
         cs_reconstruct);
 
+    // missing transaction requests that were sent to more than one peer, by block hash.
+    CCriticalSection cs_missingtxfetch;
+    std::map<uint256, CMissingTxFetch> mapMissingTxFetch GUARDED_BY(cs_missingtxfetch);
+
     // Counters for how many of each peer are currently connected.  We use the set to store the
     // nodeid so that we can then get a unique count of peers with with to update the atomic counters.
     CCriticalSection cs_addpeers;
@@ -103,6 +119,12 @@ public:
     void AddBlockBytes(uint64_t bytes, std::shared_ptr<CBlockThinRelay> pblock);
     uint64_t GetMaxAllowedBlockSize();
 
+    // Accessor methods for missing transaction requests that were sent to more than one peer.
+    void AddMissingTxFetch(NodeId announcer, const uint256 &hash, const std::set<NodeId> &setOtherPeers);
+    bool GetMissingTxFetchAnnouncer(NodeId id, const uint256 &hash, NodeId &announcer);
+    bool IsMissingTxFetchAnswered(const uint256 &hash);
+    bool ClaimMissingTxFetch(const uint256 &hash, CMissingTxFetch &fetch);
+
     // Clear all block data
     void ClearAllBlockData(CNode *pnode, const uint256 &hash);
 };
@@ -0,0 +1,191 @@
+// Copyright (c) 2019 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKRELAY_STATS_H
+#define BITCOIN_BLOCKRELAY_STATS_H
+
+#include <algorithm>
+#include <atomic>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+/**
+ * A fixed size time series covering the last 24 hours, used by the block relay statistics
+ * (CThinBlockData, CCompactBlockData and CGrapheneBlockData).
+ *
+ * Samples are aggregated into one bucket per minute and each bucket keeps a running sample count
+ * and a running sum for each of the NUM_VALUES tracked values. All fields are updated with relaxed
+ * atomics so the relay threads that record samples and the RPC/UI threads that read the 24 hour
+ * summaries never block each other, and a summary costs a walk over the fixed number of buckets
+ * no matter how many samples were recorded.
+ *
+ * Buckets are reused in place: the first writer to touch a bucket in a new minute claims it and
+ * resets the sums. A sample that races with that rollover may be dropped, which is acceptable for
+ * statistics that are only used for display.
+ */
+template <typename T, size_t NUM_VALUES = 1>
+class CRollingStatRing
+{
+public:
+    static const int64_t BUCKET_MILLIS = 60 * 1000;
+    static const size_t NUM_BUCKETS = 24 * 60;
+
+private:
+    struct Bucket
+    {
+        //! The minute (time in millis / BUCKET_MILLIS) that this bucket currently holds, -1 if unused
+        std::atomic<int64_t> nMinute{-1};
+        std::atomic<uint64_t> nCount{0};
+        std::atomic<T> sum[NUM_VALUES];
+    };
+    Bucket buckets[NUM_BUCKETS];
+
+    static void AtomicAdd(std::atomic<T> &var, T value)
+    {
+        T cur = var.load(std::memory_order_relaxed);
+        while (!var.compare_exchange_weak(cur, cur + value, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    //! Return the bucket for nNowMillis, claiming and resetting it if it still holds an expired minute
+    Bucket &GetCurrentBucket(int64_t nNowMillis)
+    {
+        const int64_t nMinute = nNowMillis / BUCKET_MILLIS;
+        Bucket &b = buckets[nMinute % NUM_BUCKETS];
+        int64_t nOld = b.nMinute.load(std::memory_order_relaxed);
+        while (nOld < nMinute)
+        {
+            if (b.nMinute.compare_exchange_weak(nOld, nMinute, std::memory_order_relaxed))
+            {
+                b.nCount.store(0, std::memory_order_relaxed);
+                for (size_t i = 0; i < NUM_VALUES; i++)
+                    b.sum[i].store(T(), std::memory_order_relaxed);
+                break;
+            }
+        }
+        return b;
+    }
+
+    //! True if the bucket holds a minute that is within the 24 hour window ending at nNowMillis
+    static bool IsLive(const Bucket &b, int64_t nNowMillis)
+    {
+        const int64_t nMinute = b.nMinute.load(std::memory_order_relaxed);
+        const int64_t nNowMinute = nNowMillis / BUCKET_MILLIS;
+        return nMinute >= 0 && nMinute <= nNowMinute && nNowMinute - nMinute < (int64_t)NUM_BUCKETS;
+    }
+
+public:
+    CRollingStatRing() { Clear(); }
+    /** Record one sample at time nNowMillis. */
+    void Add(int64_t nNowMillis, T value)
+    {
+        static_assert(NUM_VALUES == 1, "Add(time, value) is only valid for single value series");
+        Bucket &b = GetCurrentBucket(nNowMillis);
+        AtomicAdd(b.sum[0], value);
+        b.nCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /** Record one sample made of two related values, such as a thin block size and its original size. */
+    void Add(int64_t nNowMillis, T first, T second)
+    {
+        static_assert(NUM_VALUES == 2, "Add(time, first, second) is only valid for two value series");
+        Bucket &b = GetCurrentBucket(nNowMillis);
+        AtomicAdd(b.sum[0], first);
+        AtomicAdd(b.sum[1], second);
+        b.nCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /** Number of samples recorded in the 24 hours ending at nNowMillis. */
+    uint64_t Count(int64_t nNowMillis) const
+    {
+        uint64_t nCount = 0;
+        for (const Bucket &b : buckets)
+        {
+            if (IsLive(b, nNowMillis))
+                nCount += b.nCount.load(std::memory_order_relaxed);
+        }
+        return nCount;
+    }
+
+    /** Sum of value nIndex over the 24 hours ending at nNowMillis. */
+    T Sum(int64_t nNowMillis, size_t nIndex = 0) const
+    {
+        T total = T();
+        for (const Bucket &b : buckets)
+        {
+            if (IsLive(b, nNowMillis))
+                total += b.sum[nIndex].load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    /** Average of value nIndex over the 24 hours ending at nNowMillis. Return 0 for no entries. */
+    double Average(int64_t nNowMillis, size_t nIndex = 0) const
+    {
+        uint64_t nCount = 0;
+        double total = 0;
+        for (const Bucket &b : buckets)
+        {
+            if (IsLive(b, nNowMillis))
+            {
+                nCount += b.nCount.load(std::memory_order_relaxed);
+                total += b.sum[nIndex].load(std::memory_order_relaxed);
+            }
+        }
+        if (nCount == 0)
+            return 0.0;
+        return total / nCount;
+    }
+
+    /**
+     * Approximate percentile (0 < fraction <= 1) of value nIndex over the 24 hours ending at nNowMillis.
+     * Every sample in a bucket is represented by the bucket average, so the result is exact whenever
+     * no more than one sample was recorded per minute, which is the normal case for block statistics.
+     * Return 0 for no entries.
+     */
+    double Percentile(int64_t nNowMillis, double fraction, size_t nIndex = 0) const
+    {
+        std::vector<std::pair<double, uint64_t> > vBuckets;
+        uint64_t nTotal = 0;
+        for (const Bucket &b : buckets)
+        {
+            if (!IsLive(b, nNowMillis))
+                continue;
+            const uint64_t nCount = b.nCount.load(std::memory_order_relaxed);
+            if (nCount == 0)
+                continue;
+            vBuckets.emplace_back((double)b.sum[nIndex].load(std::memory_order_relaxed) / nCount, nCount);
+            nTotal += nCount;
+        }
+        if (nTotal == 0)
+            return 0.0;
+
+        std::sort(vBuckets.begin(), vBuckets.end());
+        const uint64_t nElement = std::max(static_cast<int64_t>((nTotal * fraction) + 0.5) - 1, (int64_t)0);
+        uint64_t nSeen = 0;
+        for (const auto &entry : vBuckets)
+        {
+            nSeen += entry.second;
+            if (nSeen > nElement)
+                return entry.first;
+        }
+        return vBuckets.back().first;
+    }
+
+    /** Discard all samples. Not atomic with respect to concurrent writers. */
+    void Clear()
+    {
+        for (Bucket &b : buckets)
+        {
+            b.nMinute.store(-1, std::memory_order_relaxed);
+            b.nCount.store(0, std::memory_order_relaxed);
+            for (size_t i = 0; i < NUM_VALUES; i++)
+                b.sum[i].store(T(), std::memory_order_relaxed);
+        }
+    }
+};
+
+#endif // BITCOIN_BLOCKRELAY_STATS_H
@@ -23,6 +23,7 @@
 #include "hashwrapper.h"
 #include "main.h"
 #include "net.h"
+#include "nodestate.h"
 #include "parallel.h"
 #include "policy/policy.h"
 #include "pow.h"
@@ -43,6 +44,11 @@ static bool ReconstructBlock(CNode *pfrom,
     int &missingCount,
     int &unnecessaryCount,
     std::shared_ptr<CBlockThinRelay> pblock);
+static void RequestMissingTransactions(CNode *pfrom, const CompactReRequest &compactReRequest);
+static bool ProcessCompactReReqResponse(const CompactReReqResponse &compactReReqResponse,
+    size_t msgSize,
+    CNode *pfrom,
+    CNode *presponder);
 
 
 uint64_t GetShortID(const uint64_t &shorttxidk0, const uint64_t &shorttxidk1, const uint256 &txhash)
@@ -125,9 +131,16 @@ void validateCompactBlock(std::shared_ptr<CompactBlock> cmpctblock)
 /**
  * Handle an incoming compactblock.  The block is fully validated, and if any
  * transactions are missing we re-request them.
+ * If cut-through relay is enabled the compact block is forwarded to our expedited peers, with a hop count of nHops,
+ * as soon as its header is accepted.
  */
-bool CompactBlock::HandleMessage(CDataStream &vRecv, CNode *pfrom)
+bool CompactBlock::HandleMessage(CDataStream &vRecv, CNode *pfrom, unsigned nHops)
 {
+    // Keep the serialized compactblock so it can be forwarded to expedited peers as is
+    std::vector<unsigned char> vPayload;
+    if (expeditedCutThrough.Value())
+        vPayload.assign(vRecv.begin(), vRecv.end());
+
     // Deserialize compactblock and store a block to reconstruct
     CompactBlock tmp;
     vRecv >> tmp;
@@ -168,8 +181,18 @@ bool CompactBlock::HandleMessage(CDataStream &vRecv, CNode *pfrom)
     LOG(CMPCT, "received compact block %s from peer %s of %d bytes\n", inv.hash.ToString(), pfrom->GetLogName(),
         compactBlock->GetSize());
 
-    // Ban a node for sending unrequested compact blocks
-    if (!thinrelay.IsBlockInFlight(pfrom, NetMsgType::CMPCTBLOCK, inv.hash))
+    // If this is an expedited block then add an entry to the blocks in flight, otherwise
+    // ban a node for sending unrequested compact blocks
+    if (nHops > 0 && connmgr->IsExpeditedUpstream(pfrom))
+    {
+        // If we can't add this compact block then we've already requested it
+        if (!thinrelay.AddBlockInFlight(pfrom, inv.hash, NetMsgType::CMPCTBLOCK))
+            return true;
+
+        LOG(CMPCT, "Received new expedited compact block %s from peer %s hop %d\n", inv.hash.ToString(),
+            pfrom->GetLogName(), nHops);
+    }
+    else if (!thinrelay.IsBlockInFlight(pfrom, NetMsgType::CMPCTBLOCK, inv.hash))
     {
         dosMan.Misbehaving(pfrom, 100);
         return error("unrequested compact block from peer %s", pfrom->GetLogName());
@@ -186,6 +209,9 @@ bool CompactBlock::HandleMessage(CDataStream &vRecv, CNode *pfrom)
         return true;
     }
 
+    // Cut-through relay: forward the compact block before reconstructing and validating it.
+    SendExpeditedBlock(*compactBlock, vPayload, nHops, pfrom);
+
     return compactBlock->process(pfrom, pblock);
 }
 
@@ -275,8 +301,8 @@ bool CompactBlock::process(CNode *pfrom, std::shared_ptr<CBlockThinRelay> pblock
             READLOCK(orphanpool.cs_orphanpool);
             for (auto &mi : orphanpool.mapOrphanTransactions)
             {
-                uint64_t cheapHash = GetShortID(mi.first);
-                mapPartialTxHash[cheapHash] = mi.first;
+                uint64_t cheapHash = GetShortID(mi.ptx->GetHash());
+                mapPartialTxHash[cheapHash] = mi.ptx->GetHash();
             }
         }
         mempool.queryHashes(memPoolHashes);
@@ -384,7 +410,7 @@ bool CompactBlock::process(CNode *pfrom, std::shared_ptr<CBlockThinRelay> pblock
         compactReRequest.blockhash = header.GetHash();
         compactReRequest.indexes = vIndexesToRequest;
         logFile(vIndexesToRequest, pblock->cmpctblock->header.GetHash().ToString(), pfrom->GetLogName(), ::GetSerializeSize(compactReRequest, SER_NETWORK, PROTOCOL_VERSION));
-        pfrom->PushMessage(NetMsgType::GETBLOCKTXN, compactReRequest);
+        RequestMissingTransactions(pfrom, compactReRequest);
 
         // Update run-time statistics of compact block bandwidth savings
         compactdata.UpdateInBoundReRequestedTx(nWaitingForTxns);
@@ -420,6 +446,56 @@ bool CompactBlock::process(CNode *pfrom, std::shared_ptr<CBlockThinRelay> pblock
     return true;
 }
 
+// Send the request for missing transactions to the announcing peer and, if net.missingTxFetchPeers is set, also
+// to that many other compact block peers that have the block. A getblocktxn request refers to transactions by
+// their index in the block so any peer that has the block can answer it, and we use whichever answer arrives
+// first rather than waiting for a slow announcing peer to time out.
+static void RequestMissingTransactions(CNode *pfrom, const CompactReRequest &compactReRequest)
+{
+    pfrom->PushMessage(NetMsgType::GETBLOCKTXN, compactReRequest);
+
+    std::set<NodeId> setOtherPeers;
+    const unsigned int nMaxOtherPeers = missingTxFetchPeers.Value();
+    CBlockIndex *pindex = LookupBlockIndex(compactReRequest.blockhash);
+    if (nMaxOtherPeers > 0 && pindex != nullptr)
+    {
+        // We can't hold cs_vNodes while taking the node state so make a copy of vNodes here.
+        std::vector<CNode *> vNodesCopy;
+        {
+            LOCK(cs_vNodes);
+            vNodesCopy = vNodes;
+            for (CNode *pnode : vNodesCopy)
+                pnode->AddRef();
+        }
+
+        for (CNode *pnode : vNodesCopy)
+        {
+            if (setOtherPeers.size() < nMaxOtherPeers && pnode != pfrom && pnode->CompactBlockCapable() &&
+                pnode->fSuccessfullyConnected && !pnode->fDisconnect)
+            {
+                // Only ask peers that have told us they have this block.
+                requester.ProcessBlockAvailability(pnode->GetId());
+                bool fHasBlock = false;
+                {
+                    CNodeStateAccessor state(nodestate, pnode->GetId());
+                    fHasBlock = (state != nullptr && state->pindexBestKnownBlock != nullptr &&
+                                 state->pindexBestKnownBlock->GetAncestor(pindex->nHeight) == pindex);
+                }
+                if (fHasBlock)
+                {
+                    pnode->PushMessage(NetMsgType::GETBLOCKTXN, compactReRequest);
+                    setOtherPeers.insert(pnode->GetId());
+                    LOG(CMPCT, "Also requesting %d missing txs for %s from peer=%s\n", compactReRequest.indexes.size(),
+                        compactReRequest.blockhash.ToString(), pnode->GetLogName());
+                }
+            }
+            pnode->Release();
+        }
+    }
+
+    thinrelay.AddMissingTxFetch(pfrom->GetId(), compactReRequest.blockhash, setOtherPeers);
+}
+
 bool CompactReRequest::HandleMessage(CDataStream &vRecv, CNode *pfrom)
 {
     CompactReRequest compactReRequest;
@@ -468,13 +544,11 @@ bool CompactReRequest::HandleMessage(CDataStream &vRecv, CNode *pfrom)
 
 bool CompactReReqResponse::HandleMessage(CDataStream &vRecv, CNode *pfrom)
 {
-    std::string strCommand = NetMsgType::BLOCKTXN;
     size_t msgSize = vRecv.size();
     CompactReReqResponse compactReReqResponse;
     vRecv >> compactReReqResponse;
 
     // Message consistency checking
-    CInv inv(MSG_CMPCT_BLOCK, compactReReqResponse.blockhash);
     if (compactReReqResponse.txn.empty() || compactReReqResponse.blockhash.IsNull())
     {
         dosMan.Misbehaving(pfrom, 100);
@@ -482,11 +556,54 @@ bool CompactReReqResponse::HandleMessage(CDataStream &vRecv, CNode *pfrom)
             "incorrectly constructed compactReReqResponse or inconsistent compactblock data received.  Banning peer=%s",
             pfrom->GetLogName());
     }
-    LOG(CMPCT, "received compactReReqResponse for %s peer=%s\n", inv.hash.ToString(), pfrom->GetLogName());
+    LOG(CMPCT, "received compactReReqResponse for %s peer=%s\n", compactReReqResponse.blockhash.ToString(),
+        pfrom->GetLogName());
+
+    // If the missing transactions were requested from more than one peer then only the first response is used.
+    if (thinrelay.IsMissingTxFetchAnswered(compactReReqResponse.blockhash))
+    {
+        LOG(CMPCT, "Dropping compactReReqResponse for %s, already answered by another peer, peer=%s\n",
+            compactReReqResponse.blockhash.ToString(), pfrom->GetLogName());
+        return true;
+    }
+
+    // A response from one of the other peers we also asked is processed on behalf of the announcing peer, since
+    // that is where the block in flight and the block being reconstructed are tracked.
+    NodeId announcer;
+    if (thinrelay.GetMissingTxFetchAnnouncer(pfrom->GetId(), compactReReqResponse.blockhash, announcer))
+    {
+        CNodeRef pannouncer(connmgr->FindNodeFromId(announcer));
+        if (!pannouncer)
+            return error(CMPCT, "Announcing peer for %s has disconnected, dropping compactReReqResponse from peer=%s",
+                compactReReqResponse.blockhash.ToString(), pfrom->GetLogName());
+
+        // We already hold pfrom->cs_thintype so only try for the announcing peer's lock, otherwise two responses
+        // being processed at the same time could deadlock. If it is busy then the announcing peer is most likely
+        // processing its own response already.
+        TRY_LOCK(pannouncer->cs_thintype, lockAnnouncer);
+        if (!lockAnnouncer)
+            return true;
+        return ProcessCompactReReqResponse(compactReReqResponse, msgSize, pannouncer.get(), pfrom);
+    }
+
+    return ProcessCompactReReqResponse(compactReReqResponse, msgSize, pfrom, pfrom);
+}
+
+static bool ProcessCompactReReqResponse(const CompactReReqResponse &compactReReqResponse,
+    size_t msgSize,
+    CNode *pfrom,
+    CNode *presponder)
+{
+    std::string strCommand = NetMsgType::BLOCKTXN;
+    CInv inv(MSG_CMPCT_BLOCK, compactReReqResponse.blockhash);
     {
         // Do not process unrequested xblocktx unless from an expedited node.
         if (!thinrelay.IsBlockInFlight(pfrom, NetMsgType::CMPCTBLOCK, inv.hash) && !connmgr->IsExpeditedUpstream(pfrom))
         {
+            // The block may have been finished or timed out while one of the other peers we asked was answering.
+            if (presponder != pfrom)
+                return true;
+
             dosMan.Misbehaving(pfrom, 10);
             return error("Received compactReReqResponse %s from peer %s but was unrequested", inv.hash.ToString(),
                 pfrom->GetLogName());
@@ -497,6 +614,17 @@ bool CompactReReqResponse::HandleMessage(CDataStream &vRecv, CNode *pfrom)
     if (pblock == nullptr)
         return error("No block available to reconstruct for blocktxn");
     std::shared_ptr<CompactBlock> cmpctBlock = pblock->cmpctblock;
+
+    // This is the first response to our request for the missing transactions so any later ones will be dropped.
+    CMissingTxFetch fetch;
+    if (thinrelay.ClaimMissingTxFetch(inv.hash, fetch))
+    {
+        compactdata.UpdateMissingTxFetchTime((double)(GetTimeMicros() - fetch.nRequestTime) / 1000.0,
+            !fetch.setOtherPeers.empty(), presponder != pfrom);
+        if (presponder != pfrom)
+            LOG(CMPCT, "Using missing txs for %s from peer=%s instead of announcing peer=%s\n", inv.hash.ToString(),
+                presponder->GetLogName(), pfrom->GetLogName());
+    }
     logFile("CMPCTMTXRECV -- received response for missing transactions of size " + std::to_string(::GetSerializeSize(compactReReqResponse, SER_NETWORK, PROTOCOL_VERSION)) + " for block " + pblock->GetHash().ToString() + " from " + pfrom->GetLogName());
 
     // Check if we've already received this block and have it on disk
@@ -513,8 +641,7 @@ bool CompactReReqResponse::HandleMessage(CDataStream &vRecv, CNode *pfrom)
 
     // Create the mapMissingTx from all the supplied tx's in the compactblock
     for (const CTransaction &tx : compactReReqResponse.txn)
-        cmpctBlock->mapMissingTx[GetShortID(pfrom->shorttxidk0.load(), pfrom->shorttxidk1.load(), tx.GetHash())] =
-            MakeTransactionRef(tx);
+        cmpctBlock->mapMissingTx[cmpctBlock->GetShortID(tx.GetHash())] = MakeTransactionRef(tx);
 
     // Get the full hashes from the compactReReqResponse and add them to the compactBlockHashes vector.  These should
     // be all the missing or null hashes that we re-requested.
@@ -661,12 +788,11 @@ static bool ReconstructBlock(CNode *pfrom,
                 else
                 {
                     READLOCK(orphanpool.cs_orphanpool);
-                    std::map<uint256, CTxOrphanPool::COrphanTx>::iterator iter2 =
-                        orphanpool.mapOrphanTransactions.find(hash);
+                    CTxOrphanPool::indexed_orphan_set::iterator iter2 = orphanpool.mapOrphanTransactions.find(hash);
                     if (iter2 != orphanpool.mapOrphanTransactions.end())
                     {
                         inOrphanCache = true;
-                        ptx = iter2->second.ptx;
+                        ptx = iter2->ptx;
                     }
                 }
 
@@ -708,53 +834,6 @@ static bool ReconstructBlock(CNode *pfrom,
 }
 
 
-template <class T>
-void CCompactBlockData::expireStats(std::map<int64_t, T> &statsMap)
-{
-    AssertLockHeld(cs_compactblockstats);
-    // Delete any entries that are more than 24 hours old
-    int64_t nTimeCutoff = getTimeForStats() - 60 * 60 * 24 * 1000;
-
-    typename std::map<int64_t, T>::iterator iter = statsMap.begin();
-    while (iter != statsMap.end())
-    {
-        // increment to avoid iterator becoming invalid when erasing below
-        typename std::map<int64_t, T>::iterator mi = iter++;
-
-        if (mi->first < nTimeCutoff)
-            statsMap.erase(mi);
-    }
-}
-
-template <class T>
-void CCompactBlockData::updateStats(std::map<int64_t, T> &statsMap, T value)
-{
-    AssertLockHeld(cs_compactblockstats);
-    statsMap[getTimeForStats()] = value;
-    expireStats(statsMap);
-}
-
-
-//  Calculate average of values in map. Return 0 for no entries.
-// Expires values before calculation.
-double CCompactBlockData::average(std::map<int64_t, uint64_t> &map)
-{
-    AssertLockHeld(cs_compactblockstats);
-
-    expireStats(map);
-
-    if (map.size() == 0)
-        return 0.0;
-
-    uint64_t accum = 0U;
-    for (std::pair<int64_t, uint64_t> const &ref : map)
-    {
-        // avoid wraparounds
-        accum = std::max(accum, accum + ref.second);
-    }
-    return (double)accum / map.size();
-}
-
 double CCompactBlockData::computeTotalBandwidthSavingsInternal() EXCLUSIVE_LOCKS_REQUIRED(cs_compactblockstats)
 {
     AssertLockHeld(cs_compactblockstats);
@@ -762,21 +841,12 @@ double CCompactBlockData::computeTotalBandwidthSavingsInternal() EXCLUSIVE_LOCKS
     return double(nOriginalSize() - nCompactSize());
 }
 
-double CCompactBlockData::compute24hAverageCompressionInternal(
-    std::map<int64_t, std::pair<uint64_t, uint64_t> > &mapCompactBlocks) EXCLUSIVE_LOCKS_REQUIRED(cs_compactblockstats)
+double CCompactBlockData::compute24hAverageCompression(int64_t nNow,
+    const CRollingStatRing<uint64_t, 2> &ringCompactBlocks) const
 {
-    AssertLockHeld(cs_compactblockstats);
-
-    expireStats(mapCompactBlocks);
-
     double nCompressionRate = 0;
-    uint64_t nCompactSizeTotal = 0;
-    uint64_t nOriginalSizeTotal = 0;
-    for (const auto &mi : mapCompactBlocks)
-    {
-        nCompactSizeTotal += mi.second.first;
-        nOriginalSizeTotal += mi.second.second;
-    }
+    uint64_t nCompactSizeTotal = ringCompactBlocks.Sum(nNow, 0);
+    uint64_t nOriginalSizeTotal = ringCompactBlocks.Sum(nNow, 1);
 
     if (nOriginalSizeTotal > 0)
         nCompressionRate = 100 - (100 * (double)(nCompactSizeTotal) / nOriginalSizeTotal);
@@ -784,75 +854,61 @@ double CCompactBlockData::compute24hAverageCompressionInternal(
     return nCompressionRate;
 }
 
-double CCompactBlockData::compute24hInboundRerequestTxPercentInternal() EXCLUSIVE_LOCKS_REQUIRED(cs_compactblockstats)
+double CCompactBlockData::compute24hInboundRerequestTxPercent(int64_t nNow) const
 {
-    AssertLockHeld(cs_compactblockstats);
-
-    expireStats(mapCompactBlocksInBoundReRequestedTx);
-    expireStats(mapCompactBlocksInBound);
-
     double nReRequestRate = 0;
-    uint64_t nTotalReRequests = 0;
-    uint64_t nTotalReRequestedTxs = 0;
-    for (const auto &mi : mapCompactBlocksInBoundReRequestedTx)
-    {
-        nTotalReRequests += 1;
-        nTotalReRequestedTxs += mi.second;
-    }
+    uint64_t nTotalReRequests = ringCompactBlocksInBoundReRequestedTx.Count(nNow);
+    uint64_t nTotalInBound = ringCompactBlocksInBound.Count(nNow);
 
-    if (mapCompactBlocksInBound.size() > 0)
-        nReRequestRate = 100 * (double)nTotalReRequests / mapCompactBlocksInBound.size();
+    if (nTotalInBound > 0)
+        nReRequestRate = 100 * (double)nTotalReRequests / nTotalInBound;
 
     return nReRequestRate;
 }
 
 void CCompactBlockData::UpdateInBound(uint64_t nCompactBlockSize, uint64_t nOriginalBlockSize)
 {
+    ringCompactBlocksInBound.Add(getTimeForStats(), nCompactBlockSize, nOriginalBlockSize);
+
     LOCK(cs_compactblockstats);
     // Update InBound compactblock tracking information
     nOriginalSize += nOriginalBlockSize;
     nCompactSize += nCompactBlockSize;
     nInBoundBlocks += 1;
-    updateStats(mapCompactBlocksInBound, std::pair<uint64_t, uint64_t>(nCompactBlockSize, nOriginalBlockSize));
 }
 
 void CCompactBlockData::UpdateOutBound(uint64_t nCompactBlockSize, uint64_t nOriginalBlockSize)
 {
+    ringCompactBlocksOutBound.Add(getTimeForStats(), nCompactBlockSize, nOriginalBlockSize);
+
     LOCK(cs_compactblockstats);
     nOriginalSize += nOriginalBlockSize;
     nCompactSize += nCompactBlockSize;
     nOutBoundBlocks += 1;
-    updateStats(mapCompactBlocksOutBound, std::pair<uint64_t, uint64_t>(nCompactBlockSize, nOriginalBlockSize));
 }
 
 void CCompactBlockData::UpdateResponseTime(double nResponseTime)
 {
-    LOCK(cs_compactblockstats);
-
     // only update stats if IBD is complete
     if (IsChainNearlySyncd() && IsCompactBlocksEnabled())
     {
-        updateStats(mapCompactBlockResponseTime, nResponseTime);
+        ringCompactBlockResponseTime.Add(getTimeForStats(), nResponseTime);
     }
 }
 
 void CCompactBlockData::UpdateValidationTime(double nValidationTime)
 {
-    LOCK(cs_compactblockstats);
-
     // only update stats if IBD is complete
     if (IsChainNearlySyncd() && IsCompactBlocksEnabled())
     {
-        updateStats(mapCompactBlockValidationTime, nValidationTime);
+        ringCompactBlockValidationTime.Add(getTimeForStats(), nValidationTime);
     }
 }
 
 void CCompactBlockData::UpdateInBoundReRequestedTx(int nReRequestedTx)
 {
-    LOCK(cs_compactblockstats);
-
     // Update InBound compactblock tracking information
-    updateStats(mapCompactBlocksInBoundReRequestedTx, nReRequestedTx);
+    ringCompactBlocksInBoundReRequestedTx.Add(getTimeForStats(), nReRequestedTx);
 }
 
 void CCompactBlockData::UpdateMempoolLimiterBytesSaved(unsigned int nBytesSaved)
@@ -863,16 +919,31 @@ void CCompactBlockData::UpdateMempoolLimiterBytesSaved(unsigned int nBytesSaved)
 
 void CCompactBlockData::UpdateCompactBlock(uint64_t nCompactBlockSize)
 {
+    ringCompactBlock.Add(getTimeForStats(), nCompactBlockSize);
+
     LOCK(cs_compactblockstats);
     nTotalCompactBlockBytes += nCompactBlockSize;
-    updateStats(mapCompactBlock, nCompactBlockSize);
 }
 
 void CCompactBlockData::UpdateFullTx(uint64_t nFullTxSize)
 {
+    ringFullTx.Add(getTimeForStats(), nFullTxSize);
+
     LOCK(cs_compactblockstats);
     nTotalCompactBlockBytes += nFullTxSize;
-    updateStats(mapFullTx, nFullTxSize);
+}
+
+void CCompactBlockData::UpdateMissingTxFetchTime(double nFetchTime,
+    bool fOtherPeersAsked,
+    bool fOtherPeerAnswered)
+{
+    // only update stats if IBD is complete
+    if (IsChainNearlySyncd() && IsCompactBlocksEnabled())
+    {
+        int64_t nNow = getTimeForStats();
+        ringMissingTxFetchTime.Add(nNow, nFetchTime);
+        ringMissingTxFetchOtherPeers.Add(nNow, fOtherPeersAsked ? 1 : 0, fOtherPeerAnswered ? 1 : 0);
+    }
 }
 
 std::string CCompactBlockData::ToString()
@@ -888,16 +959,12 @@ std::string CCompactBlockData::ToString()
 // Calculate the percentage compression over the last 24 hours for inbound blocks
 std::string CCompactBlockData::InBoundPercentToString()
 {
-    LOCK(cs_compactblockstats);
-
-    double nCompressionRate = compute24hAverageCompressionInternal(mapCompactBlocksInBound);
+    int64_t nNow = getTimeForStats();
+    double nCompressionRate = compute24hAverageCompression(nNow, ringCompactBlocksInBound);
 
-    // NOTE: Potential gotcha, compute24hAverageCompressionInternal has a side-effect of calling
-    //       expireStats which modifies the contents of mapCompactBlocksInBound
-    // We currently rely on this side-effect for the string produced below
     std::ostringstream ss;
     ss << std::fixed << std::setprecision(1);
-    ss << "Compression for " << mapCompactBlocksInBound.size()
+    ss << "Compression for " << ringCompactBlocksInBound.Count(nNow)
        << " Inbound  compactblocks (last 24hrs): " << nCompressionRate << "%";
     return ss.str();
 }
@@ -905,16 +972,12 @@ std::string CCompactBlockData::InBoundPercentToString()
 // Calculate the percentage compression over the last 24 hours for outbound blocks
 std::string CCompactBlockData::OutBoundPercentToString()
 {
-    LOCK(cs_compactblockstats);
-
-    double nCompressionRate = compute24hAverageCompressionInternal(mapCompactBlocksOutBound);
+    int64_t nNow = getTimeForStats();
+    double nCompressionRate = compute24hAverageCompression(nNow, ringCompactBlocksOutBound);
 
-    // NOTE: Potential gotcha, compute24hAverageCompressionInternal has a side-effect of calling
-    //       expireStats which modifies the contents of mapCompactBlocksOutBound
-    // We currently rely on this side-effect for the string produced below
     std::ostringstream ss;
     ss << std::fixed << std::setprecision(1);
-    ss << "Compression for " << mapCompactBlocksOutBound.size()
+    ss << "Compression for " << ringCompactBlocksOutBound.Count(nNow)
        << " Outbound compactblocks (last 24hrs): " << nCompressionRate << "%";
     return ss.str();
 }
@@ -922,32 +985,9 @@ std::string CCompactBlockData::OutBoundPercentToString()
 // Calculate the average response time over the last 24 hours
 std::string CCompactBlockData::ResponseTimeToString()
 {
-    LOCK(cs_compactblockstats);
-
-    expireStats(mapCompactBlockResponseTime);
-
-    std::vector<double> vResponseTime;
-
-    double nResponseTimeAverage = 0;
-    double nPercentile = 0;
-    double nTotalResponseTime = 0;
-    double nTotalEntries = 0;
-    for (const auto &mi : mapCompactBlockResponseTime)
-    {
-        nTotalEntries += 1;
-        nTotalResponseTime += mi.second;
-        vResponseTime.push_back(mi.second);
-    }
-
-    if (nTotalEntries > 0)
-    {
-        nResponseTimeAverage = (double)nTotalResponseTime / nTotalEntries;
-
-        // Calculate the 95th percentile
-        uint64_t nPercentileElement = static_cast<int>((nTotalEntries * 0.95) + 0.5) - 1;
-        sort(vResponseTime.begin(), vResponseTime.end());
-        nPercentile = vResponseTime[nPercentileElement];
-    }
+    int64_t nNow = getTimeForStats();
+    double nResponseTimeAverage = ringCompactBlockResponseTime.Average(nNow);
+    double nPercentile = ringCompactBlockResponseTime.Percentile(nNow, 0.95);
 
     std::ostringstream ss;
     ss << std::fixed << std::setprecision(2);
@@ -958,32 +998,9 @@ std::string CCompactBlockData::ResponseTimeToString()
 // Calculate the average validation time over the last 24 hours
 std::string CCompactBlockData::ValidationTimeToString()
 {
-    LOCK(cs_compactblockstats);
-
-    expireStats(mapCompactBlockValidationTime);
-
-    std::vector<double> vValidationTime;
-
-    double nValidationTimeAverage = 0;
-    double nPercentile = 0;
-    double nTotalValidationTime = 0;
-    double nTotalEntries = 0;
-    for (const auto &mi : mapCompactBlockValidationTime)
-    {
-        nTotalEntries += 1;
-        nTotalValidationTime += mi.second;
-        vValidationTime.push_back(mi.second);
-    }
-
-    if (nTotalEntries > 0)
-    {
-        nValidationTimeAverage = (double)nTotalValidationTime / nTotalEntries;
-
-        // Calculate the 95th percentile
-        uint64_t nPercentileElement = static_cast<int>((nTotalEntries * 0.95) + 0.5) - 1;
-        sort(vValidationTime.begin(), vValidationTime.end());
-        nPercentile = vValidationTime[nPercentileElement];
-    }
+    int64_t nNow = getTimeForStats();
+    double nValidationTimeAverage = ringCompactBlockValidationTime.Average(nNow);
+    double nPercentile = ringCompactBlockValidationTime.Percentile(nNow, 0.95);
 
     std::ostringstream ss;
     ss << std::fixed << std::setprecision(2);
@@ -994,17 +1011,13 @@ std::string CCompactBlockData::ValidationTimeToString()
 // Calculate the transaction re-request ratio and counter over the last 24 hours
 std::string CCompactBlockData::ReRequestedTxToString()
 {
-    LOCK(cs_compactblockstats);
-
-    double nReRequestRate = compute24hInboundRerequestTxPercentInternal();
+    int64_t nNow = getTimeForStats();
+    double nReRequestRate = compute24hInboundRerequestTxPercent(nNow);
 
-    // NOTE: Potential gotcha, compute24hInboundRerequestTxPercentInternal has a side-effect of calling
-    //       expireStats which modifies the contents of mapCompactBlocksInBoundReRequestedTx
-    // We currently rely on this side-effect for the string produced below
     std::ostringstream ss;
     ss << std::fixed << std::setprecision(1);
     ss << "Tx re-request rate (last 24hrs): " << nReRequestRate
-       << "% Total re-requests:" << mapCompactBlocksInBoundReRequestedTx.size();
+       << "% Total re-requests:" << ringCompactBlocksInBoundReRequestedTx.Count(nNow);
     return ss.str();
 }
 
@@ -1020,8 +1033,7 @@ std::string CCompactBlockData::MempoolLimiterBytesSavedToString()
 // Calculate the average compact block size
 std::string CCompactBlockData::CompactBlockToString()
 {
-    LOCK(cs_compactblockstats);
-    double avgCompactBlockSize = average(mapCompactBlock);
+    double avgCompactBlockSize = ringCompactBlock.Average(getTimeForStats());
     std::ostringstream ss;
     ss << "CompactBlock size (last 24hrs) AVG: " << formatInfoUnit(avgCompactBlockSize);
     return ss.str();
@@ -1030,13 +1042,27 @@ std::string CCompactBlockData::CompactBlockToString()
 // Calculate the average size of all full txs sent with block
 std::string CCompactBlockData::FullTxToString()
 {
-    LOCK(cs_compactblockstats);
-    double avgFullTxSize = average(mapFullTx);
+    double avgFullTxSize = ringFullTx.Average(getTimeForStats());
     std::ostringstream ss;
     ss << "compactblock full transactions size (last 24hrs) AVG: " << formatInfoUnit(avgFullTxSize);
     return ss.str();
 }
 
+// Calculate the average time to get the missing transactions of a compact block over the last 24 hours
+std::string CCompactBlockData::MissingTxFetchTimeToString()
+{
+    int64_t nNow = getTimeForStats();
+    double nFetchTimeAverage = ringMissingTxFetchTime.Average(nNow);
+    double nPercentile = ringMissingTxFetchTime.Percentile(nNow, 0.95);
+
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(2);
+    ss << "Missing tx fetch time (last 24hrs) AVG:" << nFetchTimeAverage << "ms, 95th pcntl:" << nPercentile
+       << "ms, sent to other peers:" << ringMissingTxFetchOtherPeers.Sum(nNow, 0)
+       << ", answered by other peers:" << ringMissingTxFetchOtherPeers.Sum(nNow, 1);
+    return ss.str();
+}
+
 void CCompactBlockData::ClearCompactBlockStats()
 {
     LOCK(cs_compactblockstats);
@@ -1049,13 +1075,15 @@ void CCompactBlockData::ClearCompactBlockStats()
     nTotalCompactBlockBytes.Clear();
     nTotalFullTxBytes.Clear();
 
-    mapCompactBlocksInBound.clear();
-    mapCompactBlocksOutBound.clear();
-    mapCompactBlockResponseTime.clear();
-    mapCompactBlockValidationTime.clear();
-    mapCompactBlocksInBoundReRequestedTx.clear();
-    mapCompactBlock.clear();
-    mapFullTx.clear();
+    ringCompactBlocksInBound.Clear();
+    ringCompactBlocksOutBound.Clear();
+    ringCompactBlockResponseTime.Clear();
+    ringCompactBlockValidationTime.Clear();
+    ringCompactBlocksInBoundReRequestedTx.Clear();
+    ringCompactBlock.Clear();
+    ringFullTx.Clear();
+    ringMissingTxFetchTime.Clear();
+    ringMissingTxFetchOtherPeers.Clear();
 }
 
 void CCompactBlockData::FillCompactBlockQuickStats(CompactBlockQuickStats &stats)
@@ -1063,21 +1091,18 @@ void CCompactBlockData::FillCompactBlockQuickStats(CompactBlockQuickStats &stats
     if (!IsCompactBlocksEnabled())
         return;
 
-    LOCK(cs_compactblockstats);
+    int64_t nNow = getTimeForStats();
+    stats.fLast24hInboundCompression = compute24hAverageCompression(nNow, ringCompactBlocksInBound);
+    stats.nLast24hInbound = ringCompactBlocksInBound.Count(nNow);
+    stats.fLast24hOutboundCompression = compute24hAverageCompression(nNow, ringCompactBlocksOutBound);
+    stats.nLast24hOutbound = ringCompactBlocksOutBound.Count(nNow);
+    stats.fLast24hRerequestTxPercent = compute24hInboundRerequestTxPercent(nNow);
+    stats.nLast24hRerequestTx = ringCompactBlocksInBoundReRequestedTx.Count(nNow);
 
+    LOCK(cs_compactblockstats);
     stats.nTotalInbound = nInBoundBlocks();
     stats.nTotalOutbound = nOutBoundBlocks();
     stats.nTotalBandwidthSavings = computeTotalBandwidthSavingsInternal();
-
-    // NOTE: The following calls rely on the side-effect of the compute*Internal
-    //       calls also calling expireStats on the associated statistics maps
-    //       This is why we set the % value first, then the count second for compression values
-    stats.fLast24hInboundCompression = compute24hAverageCompressionInternal(mapCompactBlocksInBound);
-    stats.nLast24hInbound = mapCompactBlocksInBound.size();
-    stats.fLast24hOutboundCompression = compute24hAverageCompressionInternal(mapCompactBlocksOutBound);
-    stats.nLast24hOutbound = mapCompactBlocksOutBound.size();
-    stats.fLast24hRerequestTxPercent = compute24hInboundRerequestTxPercentInternal();
-    stats.nLast24hRerequestTx = mapCompactBlocksInBoundReRequestedTx.size();
 }
 
 bool IsCompactBlocksEnabled() { return GetBoolArg("-use-compactblocks", true); }
@@ -5,6 +5,7 @@
 #ifndef BITCOIN_COMPACTBLOCK_H
 #define BITCOIN_COMPACTBLOCK_H
 
+#include "blockrelay/blockrelay_stats.h"
 #include "bloom.h"
 #include "consensus/validation.h"
 #include "fastfilter.h"
@@ -226,9 +227,10 @@ public:
      * transactions are missing we re-request them.
      * @param[in] vRecv        The raw binary message
      * @param[in] pFrom        The node the message was from
+     * @param[in] nHops        The number of expedited hops this block has travelled, 0 if not expedited
      * @return True if handling succeeded
      */
-    static bool HandleMessage(CDataStream &vRecv, CNode *pfrom);
+    static bool HandleMessage(CDataStream &vRecv, CNode *pfrom, unsigned nHops = 0);
     bool process(CNode *pfrom, std::shared_ptr<CBlockThinRelay> pblock);
     CInv GetInv() { return CInv(MSG_BLOCK, header.GetHash()); }
     uint64_t GetShortID(const uint256 &txhash) const;
@@ -317,7 +319,7 @@ struct CompactBlockQuickStats
 class CCompactBlockData
 {
 private:
-    CCriticalSection cs_compactblockstats; // locks everything below this point
+    CCriticalSection cs_compactblockstats; // locks the lifetime totals below
 
     CStatHistory<uint64_t> nOriginalSize;
     CStatHistory<uint64_t> nCompactSize;
@@ -326,33 +328,18 @@ private:
     CStatHistory<uint64_t> nMempoolLimiterBytesSaved;
     CStatHistory<uint64_t> nTotalCompactBlockBytes;
     CStatHistory<uint64_t> nTotalFullTxBytes;
-    std::map<int64_t, std::pair<uint64_t, uint64_t> > mapCompactBlocksInBound;
-    std::map<int64_t, std::pair<uint64_t, uint64_t> > mapCompactBlocksOutBound;
-    std::map<int64_t, double> mapCompactBlockResponseTime;
-    std::map<int64_t, double> mapCompactBlockValidationTime;
-    std::map<int64_t, int> mapCompactBlocksInBoundReRequestedTx;
-    std::map<int64_t, uint64_t> mapCompactBlock;
-    std::map<int64_t, uint64_t> mapFullTx;
-
-    /**
-        Add new entry to statistics array; also removes old timestamps
-        from statistics array using expireStats() below.
-        @param [statsMap] a statistics array
-        @param [value] the value to insert for the current time
-     */
-    template <class T>
-    void updateStats(std::map<int64_t, T> &statsMap, T value);
-
-    /**
-       Expire old statistics in given array (currently after one day).
-       Uses getTimeForStats() virtual method for timing. */
-    template <class T>
-    void expireStats(std::map<int64_t, T> &statsMap);
 
-    /**
-      Calculate average of long long values in given map. Return 0 for no entries.
-      Expires values before calculation. */
-    double average(std::map<int64_t, uint64_t> &map);
+    // Last 24 hour statistics. These are lock free and do not require cs_compactblockstats.
+    CRollingStatRing<uint64_t, 2> ringCompactBlocksInBound;
+    CRollingStatRing<uint64_t, 2> ringCompactBlocksOutBound;
+    CRollingStatRing<double> ringCompactBlockResponseTime;
+    CRollingStatRing<double> ringCompactBlockValidationTime;
+    CRollingStatRing<int> ringCompactBlocksInBoundReRequestedTx;
+    CRollingStatRing<uint64_t> ringCompactBlock;
+    CRollingStatRing<uint64_t> ringFullTx;
+    CRollingStatRing<double> ringMissingTxFetchTime;
+    // per fetch: whether other peers were also asked, and whether one of them answered first
+    CRollingStatRing<uint64_t, 2> ringMissingTxFetchOtherPeers;
 
     /**
       Calculate total bandwidth savings.
@@ -361,24 +348,15 @@ private:
 
     /**
       Calculate last 24-hour "compression" percentage
-      Requires lock on cs_compactblockstats be held external to this call.
-
-      NOTE: The thinblock and bloom filter maps should be from opposite directions
-            For example inbound block map paired wtih outbound bloom filter map
 
-      Side-effect: This method calls expireStats() on mapCompactBlocks
-
-      @param [mapCompactBlocks] a statistics array of inbound/outbound XThin blocks
+      @param [nNow] the time at the end of the 24 hour window
+      @param [ringCompactBlocks] a statistics ring of inbound/outbound compact blocks
      */
-    double compute24hAverageCompressionInternal(std::map<int64_t, std::pair<uint64_t, uint64_t> > &mapCompactBlocks)
-        EXCLUSIVE_LOCKS_REQUIRED(cs_compactblockstats);
+    double compute24hAverageCompression(int64_t nNow, const CRollingStatRing<uint64_t, 2> &ringCompactBlocks) const;
 
     /**
-      Calculate last 24-hour transaction re-request percent for inbound compactblock
-      Requires lock on cs_compactblockstats be held external to this call.
-
-      Side-effect: This method calls expireStats() on mapCompactBlocksInBoundReRequestedTx */
-    double compute24hInboundRerequestTxPercentInternal() EXCLUSIVE_LOCKS_REQUIRED(cs_compactblockstats);
+      Calculate last 24-hour transaction re-request percent for inbound compactblock */
+    double compute24hInboundRerequestTxPercent(int64_t nNow) const;
 
 protected:
     //! Virtual method so it can be overridden for better unit testing
@@ -392,6 +370,7 @@ public:
     void UpdateMempoolLimiterBytesSaved(unsigned int nBytesSaved);
     void UpdateCompactBlock(uint64_t nCompactBlockSize);
     void UpdateFullTx(uint64_t nFullTxSize);
+    void UpdateMissingTxFetchTime(double nFetchTime, bool fOtherPeersAsked, bool fOtherPeerAnswered);
     std::string ToString();
     std::string InBoundPercentToString();
     std::string OutBoundPercentToString();
@@ -401,6 +380,7 @@ public:
     std::string MempoolLimiterBytesSavedToString();
     std::string CompactBlockToString();
     std::string FullTxToString();
+    std::string MissingTxFetchTimeToString();
 
     /** Reset compact block tracking data */
     void ClearCompactBlockStats();
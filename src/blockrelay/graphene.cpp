@@ -80,6 +80,32 @@ void CGrapheneBlock::FillShortTxIDSelector()
     shorttxidk1 = shorttxidhash.GetUint64(1);
 }
 
+void CGrapheneBlock::StartFailureRecoveryRequest(const std::vector<uint256> &vSenderFilterPositiveHashes)
+{
+    // The task only uses the copies captured here, so it is safe for it to run alongside Reconcile() and for
+    // this block to be copied or released before it finishes.
+    uint256 blockhash = header.GetHash();
+    std::shared_ptr<CGrapheneSet> pSet = pGrapheneSet;
+    uint64_t nItems = nBlockTxs;
+    double senderBloomFpr = fpr;
+    uint64_t nReceiverUniverseItems = std::max((uint64_t)vSenderFilterPositiveHashes.size(),
+        GetGrapheneMempoolInfo().nTx); // the sender filter positives could be larger when it contains the coinbase
+
+    try
+    {
+        futureRecoveryRequest = std::async(std::launch::async,
+            [vSenderFilterPositiveHashes, blockhash, pSet, nItems, senderBloomFpr, nReceiverUniverseItems]() {
+                return std::make_shared<CRequestGrapheneReceiverRecover>(
+                    vSenderFilterPositiveHashes, blockhash, pSet, nItems, senderBloomFpr, nReceiverUniverseItems);
+            }).share();
+    }
+    catch (const std::system_error &e)
+    {
+        // If no thread is available then the request is built when it is needed.
+        LOG(GRAPHENE, "Could not start building failure recovery request: %s\n", e.what());
+    }
+}
+
 void CGrapheneBlock::AddNewTransactions(std::vector<CTransaction> vMissingTx, CNode *pfrom)
 {
     if (vMissingTx.size() == 0)
@@ -503,10 +529,10 @@ void CGrapheneBlock::FillTxMapFromPools(std::map<uint64_t, CTransactionRef> &map
 {
     {
         boost::unique_lock<boost::mutex> lock(csCommitQ);
-        for (auto &kv : *txCommitQ)
+        for (const CTxCommitData &data : *txCommitQ)
         {
-            uint64_t cheapHash = GetShortID(shorttxidk0, shorttxidk1, kv.first, version);
-            auto shTx = kv.second.entry.GetSharedTx();
+            uint64_t cheapHash = GetShortID(shorttxidk0, shorttxidk1, data.hash, version);
+            auto shTx = data.entry.GetSharedTx();
             if (shTx != nullptr)
                 mapTxFromPools.insert(std::make_pair(cheapHash, shTx));
         }
@@ -516,8 +542,8 @@ void CGrapheneBlock::FillTxMapFromPools(std::map<uint64_t, CTransactionRef> &map
         READLOCK(orphanpool.cs_orphanpool);
         for (auto &kv : orphanpool.mapOrphanTransactions)
         {
-            uint64_t cheapHash = GetShortID(shorttxidk0, shorttxidk1, kv.first, version);
-            auto shTx = kv.second.ptx;
+            uint64_t cheapHash = GetShortID(shorttxidk0, shorttxidk1, kv.ptx->GetHash(), version);
+            auto shTx = kv.ptx;
             if (shTx != nullptr)
                 mapTxFromPools.insert(std::make_pair(cheapHash, shTx));
         }
@@ -629,6 +655,7 @@ bool CGrapheneBlock::process(CNode *pfrom, std::string strCommand, std::shared_p
 
     // Create a map of all 8 bytes tx hashes pointing to their full tx hash counterpart
     bool fRequestFailureRecovery = false;
+    uint64_t nDecodeStartTime = GetStopwatchMicros();
     std::set<uint256> passingTxHashes;
     std::map<uint64_t, CTransactionRef> mapPartialTxHash;
     std::set<uint64_t> setHashesToRequest;
@@ -686,6 +713,11 @@ bool CGrapheneBlock::process(CNode *pfrom, std::string strCommand, std::shared_p
                 }
             }
 
+            // Decoding fails for a small fraction of blocks. Build the failure recovery request alongside
+            // the decode so that, if it does fail, the request can go out without a further delay.
+            grapheneBlock->StartFailureRecoveryRequest(vSenderFilterPositiveHahses);
+            nDecodeStartTime = GetStopwatchMicros();
+
             std::vector<uint64_t> blockCheapHashes = pGrapheneSet->Reconcile(setSenderFilterPositiveCheapHashes);
             setHashesToRequest = grapheneBlock->UpdateResolvedTxsAndIdentifyMissing(
                 mapPartialTxHash, blockCheapHashes, NegotiateGrapheneVersion(pfrom));
@@ -752,6 +784,7 @@ bool CGrapheneBlock::process(CNode *pfrom, std::string strCommand, std::shared_p
     if (fRequestFailureRecovery)
     {
         int reqSize = RequestFailureRecovery(pfrom, grapheneBlock, vSenderFilterPositiveHahses);
+        graphenedata.UpdateFailureRecoveryTime((double)(GetStopwatchMicros() - nDecodeStartTime) / 1000.0);
         logFile("GRPHNBLCKREQFAILREC -- requesting failure recovery of size " + std::to_string(reqSize) + " (bytes) for block: " + pblock->grapheneblock->header.GetHash().ToString() + " from " + pfrom->GetLogName());
         return true;
     }
@@ -845,7 +878,7 @@ static bool ReconstructBlock(CNode *pfrom,
         READLOCK(orphanpool.cs_orphanpool);
         for (auto &kv : orphanpool.mapOrphanTransactions)
         {
-            toVerify.insert(kv.first);
+            toVerify.insert(kv.ptx->GetHash());
         }
     }
     for (auto &tx : grapheneBlock->vAdditionalTxs)
@@ -908,53 +941,6 @@ static bool ReconstructBlock(CNode *pfrom,
     return true;
 }
 
-template <class T>
-void CGrapheneBlockData::expireStats(std::map<int64_t, T> &statsMap)
-{
-    AssertLockHeld(cs_graphenestats);
-    // Delete any entries that are more than 24 hours old
-    int64_t nTimeCutoff = getTimeForStats() - 60 * 60 * 24 * 1000;
-
-    typename std::map<int64_t, T>::iterator iter = statsMap.begin();
-    while (iter != statsMap.end())
-    {
-        // increment to avoid iterator becoming invalid when erasing below
-        typename std::map<int64_t, T>::iterator mi = iter++;
-
-        if (mi->first < nTimeCutoff)
-            statsMap.erase(mi);
-    }
-}
-
-template <class T>
-void CGrapheneBlockData::updateStats(std::map<int64_t, T> &statsMap, T value)
-{
-    AssertLockHeld(cs_graphenestats);
-    statsMap[getTimeForStats()] = value;
-    expireStats(statsMap);
-}
-
-/**
-   Calculate average of values in map. Return 0 for no entries.
-   Expires values before calculation. */
-double CGrapheneBlockData::average(std::map<int64_t, uint64_t> &map)
-{
-    AssertLockHeld(cs_graphenestats);
-
-    expireStats(map);
-
-    if (map.size() == 0)
-        return 0.0;
-
-    uint64_t accum = 0U;
-    for (std::pair<int64_t, uint64_t> p : map)
-    {
-        // avoid wraparounds
-        accum = std::max(accum, accum + p.second);
-    }
-    return (double)accum / map.size();
-}
-
 double CGrapheneBlockData::computeTotalBandwidthSavingsInternal() EXCLUSIVE_LOCKS_REQUIRED(cs_graphenestats)
 {
     AssertLockHeld(cs_graphenestats);
@@ -962,30 +948,17 @@ double CGrapheneBlockData::computeTotalBandwidthSavingsInternal() EXCLUSIVE_LOCK
     return double(nOriginalSize() - nGrapheneSize() - nTotalMemPoolInfoBytes());
 }
 
-double CGrapheneBlockData::compute24hAverageCompressionInternal(
-    std::map<int64_t, std::pair<uint64_t, uint64_t> > &mapGrapheneBlocks,
-    std::map<int64_t, uint64_t> &mapMemPoolInfo) EXCLUSIVE_LOCKS_REQUIRED(cs_graphenestats)
+double CGrapheneBlockData::compute24hAverageCompression(int64_t nNow,
+    const CRollingStatRing<uint64_t, 2> &ringGrapheneBlocks,
+    const CRollingStatRing<uint64_t> &ringMemPoolInfo) const
 {
-    AssertLockHeld(cs_graphenestats);
-
-    expireStats(mapGrapheneBlocks);
-    expireStats(mapMemPoolInfo);
-
     double nCompressionRate = 0;
-    uint64_t nGrapheneSizeTotal = 0;
-    uint64_t nOriginalSizeTotal = 0;
-    for (const auto &mi : mapGrapheneBlocks)
-    {
-        nGrapheneSizeTotal += mi.second.first;
-        nOriginalSizeTotal += mi.second.second;
-    }
+    uint64_t nGrapheneSizeTotal = ringGrapheneBlocks.Sum(nNow, 0);
+    uint64_t nOriginalSizeTotal = ringGrapheneBlocks.Sum(nNow, 1);
+
     // We count up the CMemPoolInfo sizes from the opposite direction as the blocks.
     // Outbound CMemPoolInfo sizes go with Inbound graphene blocks and vice versa.
-    uint64_t nMemPoolInfoSize = 0;
-    for (const auto &mi : mapMemPoolInfo)
-    {
-        nMemPoolInfoSize += mi.second;
-    }
+    uint64_t nMemPoolInfoSize = ringMemPoolInfo.Sum(nNow);
 
     if (nOriginalSizeTotal > 0)
         nCompressionRate = 100 - (100 * (double)(nGrapheneSizeTotal + nMemPoolInfoSize) / nOriginalSizeTotal);
@@ -993,24 +966,14 @@ double CGrapheneBlockData::compute24hAverageCompressionInternal(
     return nCompressionRate;
 }
 
-double CGrapheneBlockData::compute24hInboundRerequestTxPercentInternal() EXCLUSIVE_LOCKS_REQUIRED(cs_graphenestats)
+double CGrapheneBlockData::compute24hInboundRerequestTxPercent(int64_t nNow) const
 {
-    AssertLockHeld(cs_graphenestats);
-
-    expireStats(mapGrapheneBlocksInBoundReRequestedTx);
-    expireStats(mapGrapheneBlocksInBound);
-
     double nReRequestRate = 0;
-    uint64_t nTotalReRequests = 0;
-    uint64_t nTotalReRequestedTxs = 0;
-    for (const auto &mi : mapGrapheneBlocksInBoundReRequestedTx)
-    {
-        nTotalReRequests += 1;
-        nTotalReRequestedTxs += mi.second;
-    }
+    uint64_t nTotalReRequests = ringGrapheneBlocksInBoundReRequestedTx.Count(nNow);
+    uint64_t nTotalInBound = ringGrapheneBlocksInBound.Count(nNow);
 
-    if (mapGrapheneBlocksInBound.size() > 0)
-        nReRequestRate = 100 * (double)nTotalReRequests / mapGrapheneBlocksInBound.size();
+    if (nTotalInBound > 0)
+        nReRequestRate = 100 * (double)nTotalReRequests / nTotalInBound;
 
     return nReRequestRate;
 }
@@ -1023,96 +986,106 @@ void CGrapheneBlockData::IncrementDecodeFailures()
 
 void CGrapheneBlockData::UpdateInBound(uint64_t nGrapheneBlockSize, uint64_t nOriginalBlockSize)
 {
+    ringGrapheneBlocksInBound.Add(getTimeForStats(), nGrapheneBlockSize, nOriginalBlockSize);
+
     LOCK(cs_graphenestats);
     // Update InBound graphene block tracking information
     nOriginalSize += nOriginalBlockSize;
     nGrapheneSize += nGrapheneBlockSize;
     nInBoundBlocks += 1;
-    updateStats(mapGrapheneBlocksInBound, std::pair<uint64_t, uint64_t>(nGrapheneBlockSize, nOriginalBlockSize));
 }
 
 void CGrapheneBlockData::UpdateOutBound(uint64_t nGrapheneBlockSize, uint64_t nOriginalBlockSize)
 {
+    ringGrapheneBlocksOutBound.Add(getTimeForStats(), nGrapheneBlockSize, nOriginalBlockSize);
+
     LOCK(cs_graphenestats);
     nOriginalSize += nOriginalBlockSize;
     nGrapheneSize += nGrapheneBlockSize;
     nOutBoundBlocks += 1;
-    updateStats(mapGrapheneBlocksOutBound, std::pair<uint64_t, uint64_t>(nGrapheneBlockSize, nOriginalBlockSize));
 }
 
 void CGrapheneBlockData::UpdateOutBoundMemPoolInfo(uint64_t nMemPoolInfoSize)
 {
+    ringMemPoolInfoOutBound.Add(getTimeForStats(), nMemPoolInfoSize);
+
     LOCK(cs_graphenestats);
     nTotalMemPoolInfoBytes += nMemPoolInfoSize;
-    updateStats(mapMemPoolInfoOutBound, nMemPoolInfoSize);
 }
 
 void CGrapheneBlockData::UpdateInBoundMemPoolInfo(uint64_t nMemPoolInfoSize)
 {
+    ringMemPoolInfoInBound.Add(getTimeForStats(), nMemPoolInfoSize);
+
     LOCK(cs_graphenestats);
     nTotalMemPoolInfoBytes += nMemPoolInfoSize;
-    updateStats(mapMemPoolInfoInBound, nMemPoolInfoSize);
 }
 
 void CGrapheneBlockData::UpdateFilter(uint64_t nFilterSize)
 {
+    ringFilter.Add(getTimeForStats(), nFilterSize);
+
     LOCK(cs_graphenestats);
     nTotalFilterBytes += nFilterSize;
-    updateStats(mapFilter, nFilterSize);
 }
 
 void CGrapheneBlockData::UpdateIblt(uint64_t nIbltSize)
 {
+    ringIblt.Add(getTimeForStats(), nIbltSize);
+
     LOCK(cs_graphenestats);
     nTotalIbltBytes += nIbltSize;
-    updateStats(mapIblt, nIbltSize);
 }
 
 void CGrapheneBlockData::UpdateRank(uint64_t nRankSize)
 {
+    ringRank.Add(getTimeForStats(), nRankSize);
+
     LOCK(cs_graphenestats);
     nTotalRankBytes += nRankSize;
-    updateStats(mapRank, nRankSize);
 }
 
 void CGrapheneBlockData::UpdateGrapheneBlock(uint64_t nGrapheneBlockSize)
 {
+    ringGrapheneBlock.Add(getTimeForStats(), nGrapheneBlockSize);
+
     LOCK(cs_graphenestats);
     nTotalGrapheneBlockBytes += nGrapheneBlockSize;
-    updateStats(mapGrapheneBlock, nGrapheneBlockSize);
 }
 
 void CGrapheneBlockData::UpdateAdditionalTx(uint64_t nAdditionalTxSize)
 {
+    ringAdditionalTx.Add(getTimeForStats(), nAdditionalTxSize);
+
     LOCK(cs_graphenestats);
     nTotalAdditionalTxBytes += nAdditionalTxSize;
-    updateStats(mapAdditionalTx, nAdditionalTxSize);
 }
 
 void CGrapheneBlockData::UpdateResponseTime(double nResponseTime)
 {
-    LOCK(cs_graphenestats);
-
     // only update stats if IBD is complete
     if (IsChainNearlySyncd() && IsGrapheneBlockEnabled())
-        updateStats(mapGrapheneBlockResponseTime, nResponseTime);
+        ringGrapheneBlockResponseTime.Add(getTimeForStats(), nResponseTime);
 }
 
 void CGrapheneBlockData::UpdateValidationTime(double nValidationTime)
 {
-    LOCK(cs_graphenestats);
-
     // only update stats if IBD is complete
     if (IsChainNearlySyncd() && IsGrapheneBlockEnabled())
-        updateStats(mapGrapheneBlockValidationTime, nValidationTime);
+        ringGrapheneBlockValidationTime.Add(getTimeForStats(), nValidationTime);
 }
 
 void CGrapheneBlockData::UpdateInBoundReRequestedTx(int nReRequestedTx)
 {
-    LOCK(cs_graphenestats);
-
     // Update InBound graphene block tracking information
-    updateStats(mapGrapheneBlocksInBoundReRequestedTx, nReRequestedTx);
+    ringGrapheneBlocksInBoundReRequestedTx.Add(getTimeForStats(), nReRequestedTx);
+}
+
+void CGrapheneBlockData::UpdateFailureRecoveryTime(double nFailureRecoveryTime)
+{
+    // only update stats if IBD is complete
+    if (IsChainNearlySyncd() && IsGrapheneBlockEnabled())
+        ringFailureRecoveryTime.Add(getTimeForStats(), nFailureRecoveryTime);
 }
 
 std::string CGrapheneBlockData::ToString()
@@ -1130,16 +1103,12 @@ std::string CGrapheneBlockData::ToString()
 // Calculate the graphene percentage compression over the last 24 hours
 std::string CGrapheneBlockData::InBoundPercentToString()
 {
-    LOCK(cs_graphenestats);
-
-    double nCompressionRate = compute24hAverageCompressionInternal(mapGrapheneBlocksInBound, mapMemPoolInfoOutBound);
+    int64_t nNow = getTimeForStats();
+    double nCompressionRate = compute24hAverageCompression(nNow, ringGrapheneBlocksInBound, ringMemPoolInfoOutBound);
 
-    // NOTE: Potential gotcha, compute24hInboundCompressionInternal has a side-effect of calling
-    //       expireStats which modifies the contents of mapGrapheneBlocksInBound
-    // We currently rely on this side-effect for the string produced below
     std::ostringstream ss;
     ss << std::fixed << std::setprecision(1);
-    ss << "Compression for " << mapGrapheneBlocksInBound.size()
+    ss << "Compression for " << ringGrapheneBlocksInBound.Count(nNow)
        << " Inbound graphene blocks (last 24hrs): " << nCompressionRate << "%";
 
     return ss.str();
@@ -1148,16 +1117,12 @@ std::string CGrapheneBlockData::InBoundPercentToString()
 // Calculate the graphene percentage compression over the last 24 hours
 std::string CGrapheneBlockData::OutBoundPercentToString()
 {
-    LOCK(cs_graphenestats);
-
-    double nCompressionRate = compute24hAverageCompressionInternal(mapGrapheneBlocksOutBound, mapMemPoolInfoInBound);
+    int64_t nNow = getTimeForStats();
+    double nCompressionRate = compute24hAverageCompression(nNow, ringGrapheneBlocksOutBound, ringMemPoolInfoInBound);
 
-    // NOTE: Potential gotcha, compute24hOutboundCompressionInternal has a side-effect of calling
-    //       expireStats which modifies the contents of mapGrapheneBlocksOutBound
-    // We currently rely on this side-effect for the string produced below
     std::ostringstream ss;
     ss << std::fixed << std::setprecision(1);
-    ss << "Compression for " << mapGrapheneBlocksOutBound.size()
+    ss << "Compression for " << ringGrapheneBlocksOutBound.Count(nNow)
        << " Outbound graphene blocks (last 24hrs): " << nCompressionRate << "%";
     return ss.str();
 }
@@ -1165,8 +1130,7 @@ std::string CGrapheneBlockData::OutBoundPercentToString()
 // Calculate the average inbound graphene CMemPoolInfo size
 std::string CGrapheneBlockData::InBoundMemPoolInfoToString()
 {
-    LOCK(cs_graphenestats);
-    double avgMemPoolInfoSize = average(mapMemPoolInfoInBound);
+    double avgMemPoolInfoSize = ringMemPoolInfoInBound.Average(getTimeForStats());
     std::ostringstream ss;
     ss << "Inbound CMemPoolInfo size (last 24hrs) AVG: " << formatInfoUnit(avgMemPoolInfoSize);
     return ss.str();
@@ -1175,8 +1139,7 @@ std::string CGrapheneBlockData::InBoundMemPoolInfoToString()
 // Calculate the average outbound graphene CMemPoolInfo size
 std::string CGrapheneBlockData::OutBoundMemPoolInfoToString()
 {
-    LOCK(cs_graphenestats);
-    double avgMemPoolInfoSize = average(mapMemPoolInfoOutBound);
+    double avgMemPoolInfoSize = ringMemPoolInfoOutBound.Average(getTimeForStats());
     std::ostringstream ss;
     ss << "Outbound CMemPoolInfo size (last 24hrs) AVG: " << formatInfoUnit(avgMemPoolInfoSize);
     return ss.str();
@@ -1184,8 +1147,7 @@ std::string CGrapheneBlockData::OutBoundMemPoolInfoToString()
 
 std::string CGrapheneBlockData::FilterToString()
 {
-    LOCK(cs_graphenestats);
-    double avgFilterSize = average(mapFilter);
+    double avgFilterSize = ringFilter.Average(getTimeForStats());
     std::ostringstream ss;
     ss << "Bloom filter size (last 24hrs) AVG: " << formatInfoUnit(avgFilterSize);
     return ss.str();
@@ -1193,8 +1155,7 @@ std::string CGrapheneBlockData::FilterToString()
 
 std::string CGrapheneBlockData::IbltToString()
 {
-    LOCK(cs_graphenestats);
-    double avgIbltSize = average(mapIblt);
+    double avgIbltSize = ringIblt.Average(getTimeForStats());
     std::ostringstream ss;
     ss << "IBLT size (last 24hrs) AVG: " << formatInfoUnit(avgIbltSize);
     return ss.str();
@@ -1202,8 +1163,7 @@ std::string CGrapheneBlockData::IbltToString()
 
 std::string CGrapheneBlockData::RankToString()
 {
-    LOCK(cs_graphenestats);
-    double avgRankSize = average(mapRank);
+    double avgRankSize = ringRank.Average(getTimeForStats());
     std::ostringstream ss;
     ss << "Rank size (last 24hrs) AVG: " << formatInfoUnit(avgRankSize);
     return ss.str();
@@ -1211,8 +1171,7 @@ std::string CGrapheneBlockData::RankToString()
 
 std::string CGrapheneBlockData::GrapheneBlockToString()
 {
-    LOCK(cs_graphenestats);
-    double avgGrapheneBlockSize = average(mapGrapheneBlock);
+    double avgGrapheneBlockSize = ringGrapheneBlock.Average(getTimeForStats());
     std::ostringstream ss;
     ss << "Graphene block size (last 24hrs) AVG: " << formatInfoUnit(avgGrapheneBlockSize);
     return ss.str();
@@ -1220,8 +1179,7 @@ std::string CGrapheneBlockData::GrapheneBlockToString()
 
 std::string CGrapheneBlockData::AdditionalTxToString()
 {
-    LOCK(cs_graphenestats);
-    double avgAdditionalTxSize = average(mapAdditionalTx);
+    double avgAdditionalTxSize = ringAdditionalTx.Average(getTimeForStats());
     std::ostringstream ss;
     ss << "Graphene size additional txs (last 24hrs) AVG: " << formatInfoUnit(avgAdditionalTxSize);
     return ss.str();
@@ -1230,32 +1188,9 @@ std::string CGrapheneBlockData::AdditionalTxToString()
 // Calculate the graphene average response time over the last 24 hours
 std::string CGrapheneBlockData::ResponseTimeToString()
 {
-    LOCK(cs_graphenestats);
-
-    expireStats(mapGrapheneBlockResponseTime);
-
-    std::vector<double> vResponseTime;
-
-    double nResponseTimeAverage = 0;
-    double nPercentile = 0;
-    double nTotalResponseTime = 0;
-    double nTotalEntries = 0;
-    for (const auto &mi : mapGrapheneBlockResponseTime)
-    {
-        nTotalEntries += 1;
-        nTotalResponseTime += mi.second;
-        vResponseTime.push_back(mi.second);
-    }
-
-    if (nTotalEntries > 0)
-    {
-        nResponseTimeAverage = (double)nTotalResponseTime / nTotalEntries;
-
-        // Calculate the 95th percentile
-        uint64_t nPercentileElement = static_cast<int>((nTotalEntries * 0.95) + 0.5) - 1;
-        sort(vResponseTime.begin(), vResponseTime.end());
-        nPercentile = vResponseTime[nPercentileElement];
-    }
+    int64_t nNow = getTimeForStats();
+    double nResponseTimeAverage = ringGrapheneBlockResponseTime.Average(nNow);
+    double nPercentile = ringGrapheneBlockResponseTime.Percentile(nNow, 0.95);
 
     std::ostringstream ss;
     ss << std::fixed << std::setprecision(2);
@@ -1266,30 +1201,9 @@ std::string CGrapheneBlockData::ResponseTimeToString()
 // Calculate the graphene average block validation time over the last 24 hours
 std::string CGrapheneBlockData::ValidationTimeToString()
 {
-    LOCK(cs_graphenestats);
-    expireStats(mapGrapheneBlockValidationTime);
-
-    std::vector<double> vValidationTime;
-    double nValidationTimeAverage = 0;
-    double nPercentile = 0;
-    double nTotalValidationTime = 0;
-    double nTotalEntries = 0;
-    for (const auto &mi : mapGrapheneBlockValidationTime)
-    {
-        nTotalEntries += 1;
-        nTotalValidationTime += mi.second;
-        vValidationTime.push_back(mi.second);
-    }
-
-    if (nTotalEntries > 0)
-    {
-        nValidationTimeAverage = (double)nTotalValidationTime / nTotalEntries;
-
-        // Calculate the 95th percentile
-        uint64_t nPercentileElement = static_cast<int>((nTotalEntries * 0.95) + 0.5) - 1;
-        sort(vValidationTime.begin(), vValidationTime.end());
-        nPercentile = vValidationTime[nPercentileElement];
-    }
+    int64_t nNow = getTimeForStats();
+    double nValidationTimeAverage = ringGrapheneBlockValidationTime.Average(nNow);
+    double nPercentile = ringGrapheneBlockValidationTime.Percentile(nNow, 0.95);
 
     std::ostringstream ss;
     ss << std::fixed << std::setprecision(2);
@@ -1300,16 +1214,28 @@ std::string CGrapheneBlockData::ValidationTimeToString()
 // Calculate the graphene average tx re-requested ratio over the last 24 hours
 std::string CGrapheneBlockData::ReRequestedTxToString()
 {
-    LOCK(cs_graphenestats);
-    double nReRequestRate = compute24hInboundRerequestTxPercentInternal();
+    int64_t nNow = getTimeForStats();
+    double nReRequestRate = compute24hInboundRerequestTxPercent(nNow);
 
-    // NOTE: Potential gotcha, compute24hInboundRerequestTxPercentInternal has a side-effect of calling
-    //       expireStats which modifies the contents of mapGrapheneBlocksInBoundReRequestedTx
-    // We currently rely on this side-effect for the string produced below
     std::ostringstream ss;
     ss << std::fixed << std::setprecision(1);
     ss << "Tx re-request rate (last 24hrs): " << nReRequestRate
-       << "% Total re-requests:" << mapGrapheneBlocksInBoundReRequestedTx.size();
+       << "% Total re-requests:" << ringGrapheneBlocksInBoundReRequestedTx.Count(nNow);
+    return ss.str();
+}
+
+// Calculate the average time from starting to decode a graphene block until the failure recovery request is sent,
+// for blocks that could not be decoded, over the last 24 hours
+std::string CGrapheneBlockData::FailureRecoveryTimeToString()
+{
+    int64_t nNow = getTimeForStats();
+    double nFailureRecoveryTimeAverage = ringFailureRecoveryTime.Average(nNow);
+    double nPercentile = ringFailureRecoveryTime.Percentile(nNow, 0.95);
+
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(2);
+    ss << "Failure recovery request time (last 24hrs) AVG:" << nFailureRecoveryTimeAverage
+       << "ms, 95th pcntl:" << nPercentile << "ms, Total failure recoveries:" << ringFailureRecoveryTime.Count(nNow);
     return ss.str();
 }
 
@@ -1328,17 +1254,18 @@ void CGrapheneBlockData::ClearGrapheneBlockStats()
     nTotalRankBytes.Clear();
     nTotalGrapheneBlockBytes.Clear();
 
-    mapGrapheneBlocksInBound.clear();
-    mapGrapheneBlocksOutBound.clear();
-    mapMemPoolInfoOutBound.clear();
-    mapMemPoolInfoInBound.clear();
-    mapFilter.clear();
-    mapIblt.clear();
-    mapRank.clear();
-    mapGrapheneBlock.clear();
-    mapGrapheneBlockResponseTime.clear();
-    mapGrapheneBlockValidationTime.clear();
-    mapGrapheneBlocksInBoundReRequestedTx.clear();
+    ringGrapheneBlocksInBound.Clear();
+    ringGrapheneBlocksOutBound.Clear();
+    ringMemPoolInfoOutBound.Clear();
+    ringMemPoolInfoInBound.Clear();
+    ringFilter.Clear();
+    ringIblt.Clear();
+    ringRank.Clear();
+    ringGrapheneBlock.Clear();
+    ringGrapheneBlockResponseTime.Clear();
+    ringGrapheneBlockValidationTime.Clear();
+    ringGrapheneBlocksInBoundReRequestedTx.Clear();
+    ringFailureRecoveryTime.Clear();
 }
 
 void CGrapheneBlockData::FillGrapheneQuickStats(GrapheneQuickStats &stats)
@@ -1346,23 +1273,21 @@ void CGrapheneBlockData::FillGrapheneQuickStats(GrapheneQuickStats &stats)
     if (!IsGrapheneBlockEnabled())
         return;
 
+    int64_t nNow = getTimeForStats();
+    stats.fLast24hInboundCompression =
+        compute24hAverageCompression(nNow, ringGrapheneBlocksInBound, ringMemPoolInfoOutBound);
+    stats.nLast24hInbound = ringGrapheneBlocksInBound.Count(nNow);
+    stats.fLast24hOutboundCompression =
+        compute24hAverageCompression(nNow, ringGrapheneBlocksOutBound, ringMemPoolInfoInBound);
+    stats.nLast24hOutbound = ringGrapheneBlocksOutBound.Count(nNow);
+    stats.fLast24hRerequestTxPercent = compute24hInboundRerequestTxPercent(nNow);
+    stats.nLast24hRerequestTx = ringGrapheneBlocksInBoundReRequestedTx.Count(nNow);
+
     LOCK(cs_graphenestats);
     stats.nTotalInbound = nInBoundBlocks();
     stats.nTotalOutbound = nOutBoundBlocks();
     stats.nTotalDecodeFailures = nDecodeFailures();
     stats.nTotalBandwidthSavings = computeTotalBandwidthSavingsInternal();
-
-    // NOTE: The following calls rely on the side-effect of the compute*Internal
-    //       calls also calling expireStats on the associated statistics maps
-    //       This is why we set the % value first, then the count second for compression values
-    stats.fLast24hInboundCompression =
-        compute24hAverageCompressionInternal(mapGrapheneBlocksInBound, mapMemPoolInfoOutBound);
-    stats.nLast24hInbound = mapGrapheneBlocksInBound.size();
-    stats.fLast24hOutboundCompression =
-        compute24hAverageCompressionInternal(mapGrapheneBlocksOutBound, mapMemPoolInfoInBound);
-    stats.nLast24hOutbound = mapGrapheneBlocksOutBound.size();
-    stats.fLast24hRerequestTxPercent = compute24hInboundRerequestTxPercentInternal();
-    stats.nLast24hRerequestTx = mapGrapheneBlocksInBoundReRequestedTx.size();
 }
 
 bool IsGrapheneBlockEnabled() { return GetBoolArg("-use-grapheneblocks", DEFAULT_USE_GRAPHENE_BLOCKS); }
@@ -1632,21 +1557,19 @@ bool HandleGrapheneBlockRecoveryResponse(CDataStream &vRecv, CNode *pfrom, const
     return true;
 }
 
-CRequestGrapheneReceiverRecover::CRequestGrapheneReceiverRecover(std::vector<uint256> &relevantHashes,
-    CGrapheneBlock &grapheneBlock,
-    uint64_t _nSenderFilterPositives)
+CRequestGrapheneReceiverRecover::CRequestGrapheneReceiverRecover(const std::vector<uint256> &relevantHashes,
+    const uint256 &_blockhash,
+    std::shared_ptr<CGrapheneSet> pGrapheneSet,
+    uint64_t nItems,
+    double senderBloomFpr,
+    uint64_t nReceiverUniverseItems)
 {
     uint64_t grapheneSetVersion = CGrapheneBlock::GetGrapheneSetVersion(GRAPHENE_MAX_VERSION_SUPPORTED);
-    nSenderFilterPositives = _nSenderFilterPositives;
-    blockhash = grapheneBlock.header.GetHash();
-    uint64_t nReceiverUniverseItems = (uint64_t)std::max(_nSenderFilterPositives,
-        GetGrapheneMempoolInfo().nTx); // _nSenderFilterPositives could be larger when it contains the coinbase
-    uint64_t nItems = grapheneBlock.nBlockTxs;
+    nSenderFilterPositives = relevantHashes.size();
+    blockhash = _blockhash;
     pReceiverFilter = std::make_shared<CVariableFastFilter>(
-        grapheneBlock.pGrapheneSet->FailureRecoveryFilter(relevantHashes, nItems, nSenderFilterPositives,
-            nReceiverUniverseItems, FAILURE_RECOVERY_SUCCESS_RATE, grapheneBlock.fpr, grapheneSetVersion));
-
-    graphenedata.UpdateFilter(::GetSerializeSize(*pReceiverFilter, SER_NETWORK, PROTOCOL_VERSION));
+        pGrapheneSet->FailureRecoveryFilter(relevantHashes, nItems, nSenderFilterPositives, nReceiverUniverseItems,
+            FAILURE_RECOVERY_SUCCESS_RATE, senderBloomFpr, grapheneSetVersion));
 }
 
 CGrapheneReceiverRecover::CGrapheneReceiverRecover(CVariableFastFilter &receiverFilter,
@@ -1697,11 +1620,31 @@ int RequestFailureRecovery(CNode *pfrom,
     std::shared_ptr<CGrapheneBlock> grapheneBlock,
     std::vector<uint256> vSenderFilterPositiveHahses)
 {
-    CRequestGrapheneReceiverRecover recoveryRequest = CRequestGrapheneReceiverRecover(
-        vSenderFilterPositiveHahses, *grapheneBlock, vSenderFilterPositiveHahses.size());
+    // Use the request that was built while the graphene set was being decoded, if there is one.
+    std::shared_ptr<CRequestGrapheneReceiverRecover> pRecoveryRequest = nullptr;
+    if (grapheneBlock->futureRecoveryRequest.valid())
+    {
+        try
+        {
+            pRecoveryRequest = grapheneBlock->futureRecoveryRequest.get();
+        }
+        catch (const std::exception &e)
+        {
+            LOG(GRAPHENE, "Could not build failure recovery request in advance: %s\n", e.what());
+        }
+    }
+    if (pRecoveryRequest == nullptr)
+    {
+        uint64_t nReceiverUniverseItems = std::max((uint64_t)vSenderFilterPositiveHahses.size(),
+            GetGrapheneMempoolInfo().nTx); // the sender filter positives could be larger when it contains the coinbase
+        pRecoveryRequest = std::make_shared<CRequestGrapheneReceiverRecover>(vSenderFilterPositiveHahses,
+            grapheneBlock->header.GetHash(), grapheneBlock->pGrapheneSet, grapheneBlock->nBlockTxs,
+            grapheneBlock->fpr, nReceiverUniverseItems);
+    }
 
-    pfrom->PushMessage(NetMsgType::GET_GRAPHENE_RECOVERY, recoveryRequest);
-    return ::GetSerializeSize(recoveryRequest, SER_NETWORK, PROTOCOL_VERSION);
+    pfrom->PushMessage(NetMsgType::GET_GRAPHENE_RECOVERY, *pRecoveryRequest);
+    graphenedata.UpdateFilter(::GetSerializeSize(*pRecoveryRequest->pReceiverFilter, SER_NETWORK, PROTOCOL_VERSION));
+    return ::GetSerializeSize(*pRecoveryRequest, SER_NETWORK, PROTOCOL_VERSION);
 }
 
 void RequestFailoverBlock(CNode *pfrom, std::shared_ptr<CBlockThinRelay> pblock)
@@ -1730,7 +1673,7 @@ void RequestFailoverBlock(CNode *pfrom, std::shared_ptr<CBlockThinRelay> pblock)
         {
             READLOCK(orphanpool.cs_orphanpool);
             for (auto &mi : orphanpool.mapOrphanTransactions)
-                vOrphanHashes.emplace_back(mi.first);
+                vOrphanHashes.emplace_back(mi.ptx->GetHash());
         }
         BuildSeededBloomFilter(filterMemPool, vOrphanHashes, inv.hash, pfrom);
         ss << inv;
@@ -6,6 +6,7 @@
 #define BITCOIN_GRAPHENE_H
 
 #include "blockrelay/blockrelay_common.h"
+#include "blockrelay/blockrelay_stats.h"
 #include "blockrelay/graphene_set.h"
 #include "bloom.h"
 #include "config.h"
@@ -21,6 +22,7 @@
 #include "unlimited.h"
 
 #include <atomic>
+#include <future>
 #include <vector>
 
 enum FastFilterSupport
@@ -39,6 +41,7 @@ const double FAILURE_RECOVERY_SUCCESS_RATE = 0.999;
 
 class CDataStream;
 class CNode;
+class CRequestGrapheneReceiverRecover;
 
 class CMemPoolInfo
 {
@@ -78,6 +81,8 @@ public:
     std::vector<CTransactionRef> vAdditionalTxs; // vector of transactions receiver probably does not have
     std::set<CTransactionRef> vRecoveredTxs; // set of transactions collected during failure recovery
     std::map<uint64_t, uint32_t> mapHashOrderIndex;
+    // failure recovery request built while the graphene set is being decoded
+    std::shared_future<std::shared_ptr<CRequestGrapheneReceiverRecover> > futureRecoveryRequest;
 
 public:
     // These describe, in two parts, the 128-bit secret key used for SipHash
@@ -116,6 +121,10 @@ public:
     // Note that this must be called any time members header or sipHashNonce are changed
     void FillShortTxIDSelector();
 
+    // Start building the failure recovery request on another thread so that it is ready to be sent
+    // right away if the graphene set can not be decoded
+    void StartFailureRecoveryRequest(const std::vector<uint256> &vSenderFilterPositiveHashes);
+
     // Adds a new set of transactins after rerequesting or during failure recovery
     void AddNewTransactions(std::vector<CTransaction> vMissingTx, CNode *pfrom);
 
@@ -301,7 +310,7 @@ struct GrapheneQuickStats
 class CGrapheneBlockData
 {
 private:
-    CCriticalSection cs_graphenestats; // locks everything below this point
+    CCriticalSection cs_graphenestats; // locks the lifetime totals below
 
     CStatHistory<uint64_t> nOriginalSize;
     CStatHistory<uint64_t> nGrapheneSize;
@@ -314,38 +323,21 @@ private:
     CStatHistory<uint64_t> nTotalRankBytes;
     CStatHistory<uint64_t> nTotalGrapheneBlockBytes;
     CStatHistory<uint64_t> nTotalAdditionalTxBytes;
-    std::map<int64_t, std::pair<uint64_t, uint64_t> > mapGrapheneBlocksInBound;
-    std::map<int64_t, std::pair<uint64_t, uint64_t> > mapGrapheneBlocksOutBound;
-    std::map<int64_t, uint64_t> mapMemPoolInfoOutBound;
-    std::map<int64_t, uint64_t> mapMemPoolInfoInBound;
-    std::map<int64_t, uint64_t> mapFilter;
-    std::map<int64_t, uint64_t> mapIblt;
-    std::map<int64_t, uint64_t> mapRank;
-    std::map<int64_t, uint64_t> mapGrapheneBlock;
-    std::map<int64_t, uint64_t> mapAdditionalTx;
-    std::map<int64_t, double> mapGrapheneBlockResponseTime;
-    std::map<int64_t, double> mapGrapheneBlockValidationTime;
-    std::map<int64_t, int> mapGrapheneBlocksInBoundReRequestedTx;
-
-    /**
-        Add new entry to statistics array; also removes old timestamps
-        from statistics array using expireStats() below.
-        @param [statsMap] a statistics array
-        @param [value] the value to insert for the current time
-     */
-    template <class T>
-    void updateStats(std::map<int64_t, T> &statsMap, T value);
-
-    /**
-       Expire old statistics in given array (currently after one day).
-       Uses getTimeForStats() virtual method for timing. */
-    template <class T>
-    void expireStats(std::map<int64_t, T> &statsMap);
 
-    /**
-      Calculate average of long long values in given map. Return 0 for no entries.
-      Expires values before calculation. */
-    double average(std::map<int64_t, uint64_t> &map);
+    // Last 24 hour statistics. These are lock free and do not require cs_graphenestats.
+    CRollingStatRing<uint64_t, 2> ringGrapheneBlocksInBound;
+    CRollingStatRing<uint64_t, 2> ringGrapheneBlocksOutBound;
+    CRollingStatRing<uint64_t> ringMemPoolInfoOutBound;
+    CRollingStatRing<uint64_t> ringMemPoolInfoInBound;
+    CRollingStatRing<uint64_t> ringFilter;
+    CRollingStatRing<uint64_t> ringIblt;
+    CRollingStatRing<uint64_t> ringRank;
+    CRollingStatRing<uint64_t> ringGrapheneBlock;
+    CRollingStatRing<uint64_t> ringAdditionalTx;
+    CRollingStatRing<double> ringGrapheneBlockResponseTime;
+    CRollingStatRing<double> ringGrapheneBlockValidationTime;
+    CRollingStatRing<int> ringGrapheneBlocksInBoundReRequestedTx;
+    CRollingStatRing<double> ringFailureRecoveryTime;
 
     /**
       Calculate total bandwidth savings for using Graphene.
@@ -354,25 +346,21 @@ private:
 
     /**
       Calculate last 24-hour "compression" percent for graphene
-      Requires lock on cs_graphenestats be held external to this call.
-
-      NOTE: The graphene block and mempool info maps should be from opposite directions
-            For example inbound block map paired wtih outbound mempool info map
 
-      Side-effect: This method calls expireStats() on mapGrapheneBlocks and mapMemPoolInfo
+      NOTE: The graphene block and mempool info rings should be from opposite directions
+            For example inbound block ring paired wtih outbound mempool info ring
 
-      @param [mapGrapheneBlocks] a statistics array of inbound/outbound graphene blocks
-      @param [mapMemPoolInfo] a statistics array of outbound/inbound graphene mempool info
+      @param [nNow] the time at the end of the 24 hour window
+      @param [ringGrapheneBlocks] a statistics ring of inbound/outbound graphene blocks
+      @param [ringMemPoolInfo] a statistics ring of outbound/inbound graphene mempool info
      */
-    double compute24hAverageCompressionInternal(std::map<int64_t, std::pair<uint64_t, uint64_t> > &mapGrapheneBlocks,
-        std::map<int64_t, uint64_t> &mapMemPoolInfo) EXCLUSIVE_LOCKS_REQUIRED(cs_graphenestats);
+    double compute24hAverageCompression(int64_t nNow,
+        const CRollingStatRing<uint64_t, 2> &ringGrapheneBlocks,
+        const CRollingStatRing<uint64_t> &ringMemPoolInfo) const;
 
     /**
-      Calculate last 24-hour transaction re-request percent for inbound graphene blocks
-      Requires lock on cs_graphenestats be held external to this call.
-
-      Side-effect: This method calls expireStats() on mapGrapheneBlocksInBoundReRequestedTx */
-    double compute24hInboundRerequestTxPercentInternal() EXCLUSIVE_LOCKS_REQUIRED(cs_graphenestats);
+      Calculate last 24-hour transaction re-request percent for inbound graphene blocks */
+    double compute24hInboundRerequestTxPercent(int64_t nNow) const;
 
 protected:
     //! Virtual method so it can be overridden for better unit testing
@@ -391,6 +379,7 @@ public:
     void UpdateResponseTime(double nResponseTime);
     void UpdateValidationTime(double nValidationTime);
     void UpdateInBoundReRequestedTx(int nReRequestedTx);
+    void UpdateFailureRecoveryTime(double nFailureRecoveryTime);
     std::string ToString();
     std::string InBoundPercentToString();
     std::string OutBoundPercentToString();
@@ -404,6 +393,7 @@ public:
     std::string ResponseTimeToString();
     std::string ValidationTimeToString();
     std::string ReRequestedTxToString();
+    std::string FailureRecoveryTimeToString();
 
     void ClearGrapheneBlockStats();
 
@@ -425,9 +415,12 @@ public:
     uint256 blockhash;
 
 public:
-    CRequestGrapheneReceiverRecover(std::vector<uint256> &relevantHashes,
-        CGrapheneBlock &grapheneBlock,
-        uint64_t _nSenderFilterPositives);
+    CRequestGrapheneReceiverRecover(const std::vector<uint256> &relevantHashes,
+        const uint256 &_blockhash,
+        std::shared_ptr<CGrapheneSet> pGrapheneSet,
+        uint64_t nItems,
+        double senderBloomFpr,
+        uint64_t nReceiverUniverseItems);
     CRequestGrapheneReceiverRecover() {}
     ~CRequestGrapheneReceiverRecover() { pReceiverFilter = nullptr; }
     /**
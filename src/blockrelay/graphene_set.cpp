@@ -459,7 +459,7 @@ uint64_t CGrapheneSet::UpperBoundFalsePositives(uint64_t nTargetItems,
         (1 + margin) * (nReceiverUniverseItems - nLowerBoundTruePositives) * senderBloomFpr);
 }
 
-CVariableFastFilter CGrapheneSet::FailureRecoveryFilter(std::vector<uint256> &relevantHashes,
+CVariableFastFilter CGrapheneSet::FailureRecoveryFilter(const std::vector<uint256> &relevantHashes,
     uint64_t nItems,
     uint64_t nSenderFilterPositiveItems,
     uint64_t nReceiverRevisedUniverseItems,
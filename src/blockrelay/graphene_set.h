@@ -214,7 +214,7 @@ public:
         double senderBloomFpr,
         double successRate);
 
-    CVariableFastFilter FailureRecoveryFilter(std::vector<uint256> &relevantHashes,
+    CVariableFastFilter FailureRecoveryFilter(const std::vector<uint256> &relevantHashes,
         uint64_t nItems,
         uint64_t nSenderFilterPositiveItems,
         uint64_t nReceiverRevisedUniverseItems,
@@ -292,11 +292,10 @@ bool CRequestMempoolSyncTx::HandleMessage(CDataStream &vRecv, CNode *pfrom)
             {
                 READLOCK(orphanpool.cs_orphanpool);
 
-                std::map<uint256, CTxOrphanPool::COrphanTx>::iterator iter =
-                    orphanpool.mapOrphanTransactions.find(hash);
+                CTxOrphanPool::indexed_orphan_set::iterator iter = orphanpool.mapOrphanTransactions.find(hash);
                 if (iter != orphanpool.mapOrphanTransactions.end())
                 {
-                    vTx.push_back(iter->second.ptx);
+                    vTx.push_back(iter->ptx);
                 }
             }
         }
@@ -371,9 +370,9 @@ void GetMempoolTxHashes(std::vector<uint256> &mempoolTxHashes)
 {
     {
         boost::unique_lock<boost::mutex> lock(csCommitQ);
-        for (auto &kv : *txCommitQ)
+        for (const CTxCommitData &data : *txCommitQ)
         {
-            mempoolTxHashes.push_back(kv.first);
+            mempoolTxHashes.push_back(data.hash);
         }
     }
 
@@ -381,7 +380,7 @@ void GetMempoolTxHashes(std::vector<uint256> &mempoolTxHashes)
         READLOCK(orphanpool.cs_orphanpool);
         for (auto &kv : orphanpool.mapOrphanTransactions)
         {
-            mempoolTxHashes.push_back(kv.first);
+            mempoolTxHashes.push_back(kv.ptx->GetHash());
         }
     }
 
@@ -485,6 +485,9 @@ bool CXThinBlock::CheckBlockHeader(const CBlockHeader &block, CValidationState &
  */
 bool CXThinBlock::HandleMessage(CDataStream &vRecv, CNode *pfrom, std::string strCommand, unsigned nHops)
 {
+    // Keep the serialized xthinblock so it can be forwarded to expedited peers as is
+    std::vector<unsigned char> vPayload(vRecv.begin(), vRecv.end());
+
     // Deserialize xthinblock and store a block to reconstruct
     CXThinBlock tmp;
     vRecv >> tmp;
@@ -581,8 +584,9 @@ bool CXThinBlock::HandleMessage(CDataStream &vRecv, CNode *pfrom, std::string st
         }
     }
 
-    // Send expedited block without checking merkle root.
-    SendExpeditedBlock(*thinBlock, nHops, pfrom);
+    // Send expedited block without checking merkle root. The header was accepted above and extends the
+    // chain tip, so the xthin can be forwarded as received without re-serializing it.
+    ForwardExpeditedBlock(inv.hash, EXPEDITED_MSG_XTHIN, nHops, vPayload, pfrom);
 
     return thinBlock->process(pfrom, strCommand, pblock);
 }
@@ -641,10 +645,10 @@ bool CXThinBlock::process(CNode *pfrom, std::string strCommand, std::shared_ptr<
             READLOCK(orphanpool.cs_orphanpool);
             for (auto &mi : orphanpool.mapOrphanTransactions)
             {
-                uint64_t cheapHash = mi.first.GetCheapHash();
+                uint64_t cheapHash = mi.ptx->GetHash().GetCheapHash();
                 if (mapPartialTxHash.count(cheapHash)) // Check for collisions
                     _collision = true;
-                mapPartialTxHash[cheapHash] = mi.first;
+                mapPartialTxHash[cheapHash] = mi.ptx->GetHash();
             }
 
             mempool.queryHashes(memPoolHashes);
@@ -843,12 +847,11 @@ static bool ReconstructBlock(CNode *pfrom,
                 else
                 {
                     READLOCK(orphanpool.cs_orphanpool);
-                    std::map<uint256, CTxOrphanPool::COrphanTx>::iterator iter2 =
-                        orphanpool.mapOrphanTransactions.find(hash);
+                    CTxOrphanPool::indexed_orphan_set::iterator iter2 = orphanpool.mapOrphanTransactions.find(hash);
                     if (iter2 != orphanpool.mapOrphanTransactions.end())
                     {
                         inOrphanCache = true;
-                        ptx = iter2->second.ptx;
+                        ptx = iter2->ptx;
                     }
                 }
 
@@ -887,53 +890,6 @@ static bool ReconstructBlock(CNode *pfrom,
     return true;
 }
 
-template <class T>
-void CThinBlockData::expireStats(std::map<int64_t, T> &statsMap)
-{
-    AssertLockHeld(cs_thinblockstats);
-    // Delete any entries that are more than 24 hours old
-    int64_t nTimeCutoff = getTimeForStats() - 60 * 60 * 24 * 1000;
-
-    typename std::map<int64_t, T>::iterator iter = statsMap.begin();
-    while (iter != statsMap.end())
-    {
-        // increment to avoid iterator becoming invalid when erasing below
-        typename std::map<int64_t, T>::iterator mi = iter++;
-
-        if (mi->first < nTimeCutoff)
-            statsMap.erase(mi);
-    }
-}
-
-template <class T>
-void CThinBlockData::updateStats(std::map<int64_t, T> &statsMap, T value)
-{
-    AssertLockHeld(cs_thinblockstats);
-    statsMap[getTimeForStats()] = value;
-    expireStats(statsMap);
-}
-
-/**
-   Calculate average of values in map. Return 0 for no entries.
-   Expires values before calculation. */
-double CThinBlockData::average(std::map<int64_t, uint64_t> &map)
-{
-    AssertLockHeld(cs_thinblockstats);
-
-    expireStats(map);
-
-    if (map.size() == 0)
-        return 0.0;
-
-    uint64_t accum = 0U;
-    for (std::pair<int64_t, uint64_t> const &ref : map)
-    {
-        // avoid wraparounds
-        accum = std::max(accum, accum + ref.second);
-    }
-    return (double)accum / map.size();
-}
-
 double CThinBlockData::computeTotalBandwidthSavingsInternal() EXCLUSIVE_LOCKS_REQUIRED(cs_thinblockstats)
 {
     AssertLockHeld(cs_thinblockstats);
@@ -941,30 +897,17 @@ double CThinBlockData::computeTotalBandwidthSavingsInternal() EXCLUSIVE_LOCKS_RE
     return double(nOriginalSize() - nThinSize() - nTotalBloomFilterBytes());
 }
 
-double CThinBlockData::compute24hAverageCompressionInternal(
-    std::map<int64_t, std::pair<uint64_t, uint64_t> > &mapThinBlocks,
-    std::map<int64_t, uint64_t> &mapBloomFilters) EXCLUSIVE_LOCKS_REQUIRED(cs_thinblockstats)
+double CThinBlockData::compute24hAverageCompression(int64_t nNow,
+    const CRollingStatRing<uint64_t, 2> &ringThinBlocks,
+    const CRollingStatRing<uint64_t> &ringBloomFilters) const
 {
-    AssertLockHeld(cs_thinblockstats);
-
-    expireStats(mapThinBlocks);
-    expireStats(mapBloomFilters);
-
     double nCompressionRate = 0;
-    uint64_t nThinSizeTotal = 0;
-    uint64_t nOriginalSizeTotal = 0;
-    for (const auto &mi : mapThinBlocks)
-    {
-        nThinSizeTotal += mi.second.first;
-        nOriginalSizeTotal += mi.second.second;
-    }
+    uint64_t nThinSizeTotal = ringThinBlocks.Sum(nNow, 0);
+    uint64_t nOriginalSizeTotal = ringThinBlocks.Sum(nNow, 1);
+
     // We count up the bloom filters from the opposite direction as the blocks.
     // Outbound bloom filters go with Inbound XThins and vice versa.
-    uint64_t nBloomFilterSize = 0;
-    for (const auto &mi : mapBloomFilters)
-    {
-        nBloomFilterSize += mi.second;
-    }
+    uint64_t nBloomFilterSize = ringBloomFilters.Sum(nNow);
 
     if (nOriginalSizeTotal > 0)
         nCompressionRate = 100 - (100 * (double)(nThinSizeTotal + nBloomFilterSize) / nOriginalSizeTotal);
@@ -972,89 +915,77 @@ double CThinBlockData::compute24hAverageCompressionInternal(
     return nCompressionRate;
 }
 
-double CThinBlockData::compute24hInboundRerequestTxPercentInternal() EXCLUSIVE_LOCKS_REQUIRED(cs_thinblockstats)
+double CThinBlockData::compute24hInboundRerequestTxPercent(int64_t nNow) const
 {
-    AssertLockHeld(cs_thinblockstats);
-
-    expireStats(mapThinBlocksInBoundReRequestedTx);
-    expireStats(mapThinBlocksInBound);
-
     double nReRequestRate = 0;
-    uint64_t nTotalReRequests = 0;
-    uint64_t nTotalReRequestedTxs = 0;
-    for (const auto &mi : mapThinBlocksInBoundReRequestedTx)
-    {
-        nTotalReRequests += 1;
-        nTotalReRequestedTxs += mi.second;
-    }
+    uint64_t nTotalReRequests = ringThinBlocksInBoundReRequestedTx.Count(nNow);
+    uint64_t nTotalInBound = ringThinBlocksInBound.Count(nNow);
 
-    if (mapThinBlocksInBound.size() > 0)
-        nReRequestRate = 100 * (double)nTotalReRequests / mapThinBlocksInBound.size();
+    if (nTotalInBound > 0)
+        nReRequestRate = 100 * (double)nTotalReRequests / nTotalInBound;
 
     return nReRequestRate;
 }
 
 void CThinBlockData::UpdateInBound(uint64_t nThinBlockSize, uint64_t nOriginalBlockSize)
 {
+    ringThinBlocksInBound.Add(getTimeForStats(), nThinBlockSize, nOriginalBlockSize);
+
     LOCK(cs_thinblockstats);
     // Update InBound thinblock tracking information
     nOriginalSize += nOriginalBlockSize;
     nThinSize += nThinBlockSize;
     nInBoundBlocks += 1;
-    updateStats(mapThinBlocksInBound, std::pair<uint64_t, uint64_t>(nThinBlockSize, nOriginalBlockSize));
 }
 
 void CThinBlockData::UpdateOutBound(uint64_t nThinBlockSize, uint64_t nOriginalBlockSize)
 {
+    ringThinBlocksOutBound.Add(getTimeForStats(), nThinBlockSize, nOriginalBlockSize);
+
     LOCK(cs_thinblockstats);
     nOriginalSize += nOriginalBlockSize;
     nThinSize += nThinBlockSize;
     nOutBoundBlocks += 1;
-    updateStats(mapThinBlocksOutBound, std::pair<uint64_t, uint64_t>(nThinBlockSize, nOriginalBlockSize));
 }
 
 void CThinBlockData::UpdateOutBoundBloomFilter(uint64_t nBloomFilterSize)
 {
+    ringBloomFiltersOutBound.Add(getTimeForStats(), nBloomFilterSize);
+
     LOCK(cs_thinblockstats);
     nTotalBloomFilterBytes += nBloomFilterSize;
-    updateStats(mapBloomFiltersOutBound, nBloomFilterSize);
 }
 
 void CThinBlockData::UpdateInBoundBloomFilter(uint64_t nBloomFilterSize)
 {
+    ringBloomFiltersInBound.Add(getTimeForStats(), nBloomFilterSize);
+
     LOCK(cs_thinblockstats);
     nTotalBloomFilterBytes += nBloomFilterSize;
-    updateStats(mapBloomFiltersInBound, nBloomFilterSize);
 }
 
 void CThinBlockData::UpdateResponseTime(double nResponseTime)
 {
-    LOCK(cs_thinblockstats);
-
     // only update stats if IBD is complete
     if (IsChainNearlySyncd() && IsThinBlocksEnabled())
     {
-        updateStats(mapThinBlockResponseTime, nResponseTime);
+        ringThinBlockResponseTime.Add(getTimeForStats(), nResponseTime);
     }
 }
 
 void CThinBlockData::UpdateValidationTime(double nValidationTime)
 {
-    LOCK(cs_thinblockstats);
-
     // only update stats if IBD is complete
     if (IsChainNearlySyncd() && IsThinBlocksEnabled())
     {
-        updateStats(mapThinBlockValidationTime, nValidationTime);
+        ringThinBlockValidationTime.Add(getTimeForStats(), nValidationTime);
     }
 }
 
 void CThinBlockData::UpdateInBoundReRequestedTx(int nReRequestedTx)
 {
-    LOCK(cs_thinblockstats);
-
     // Update InBound thinblock tracking information
-    updateStats(mapThinBlocksInBoundReRequestedTx, nReRequestedTx);
+    ringThinBlocksInBoundReRequestedTx.Add(getTimeForStats(), nReRequestedTx);
 }
 
 void CThinBlockData::UpdateMempoolLimiterBytesSaved(unsigned int nBytesSaved)
@@ -1065,16 +996,18 @@ void CThinBlockData::UpdateMempoolLimiterBytesSaved(unsigned int nBytesSaved)
 
 void CThinBlockData::UpdateThinBlock(uint64_t nThinBlockSize)
 {
+    ringThinBlock.Add(getTimeForStats(), nThinBlockSize);
+
     LOCK(cs_thinblockstats);
     nTotalThinBlockBytes += nThinBlockSize;
-    updateStats(mapThinBlock, nThinBlockSize);
 }
 
 void CThinBlockData::UpdateFullTx(uint64_t nFullTxSize)
 {
+    ringFullTx.Add(getTimeForStats(), nFullTxSize);
+
     LOCK(cs_thinblockstats);
     nTotalThinBlockBytes += nFullTxSize;
-    updateStats(mapFullTx, nFullTxSize);
 }
 
 std::string CThinBlockData::ToString()
@@ -1090,33 +1023,25 @@ std::string CThinBlockData::ToString()
 // Calculate the xthin percentage compression over the last 24 hours for inbound blocks
 std::string CThinBlockData::InBoundPercentToString()
 {
-    LOCK(cs_thinblockstats);
+    int64_t nNow = getTimeForStats();
+    double nCompressionRate = compute24hAverageCompression(nNow, ringThinBlocksInBound, ringBloomFiltersOutBound);
 
-    double nCompressionRate = compute24hAverageCompressionInternal(mapThinBlocksInBound, mapBloomFiltersOutBound);
-
-    // NOTE: Potential gotcha, compute24hAverageCompressionInternal has a side-effect of calling
-    //       expireStats which modifies the contents of mapThinBlocksInBound
-    // We currently rely on this side-effect for the string produced below
     std::ostringstream ss;
     ss << std::fixed << std::setprecision(1);
-    ss << "Compression for " << mapThinBlocksInBound.size() << " Inbound  thinblocks (last 24hrs): " << nCompressionRate
-       << "%";
+    ss << "Compression for " << ringThinBlocksInBound.Count(nNow)
+       << " Inbound  thinblocks (last 24hrs): " << nCompressionRate << "%";
     return ss.str();
 }
 
 // Calculate the xthin percentage compression over the last 24 hours for outbound blocks
 std::string CThinBlockData::OutBoundPercentToString()
 {
-    LOCK(cs_thinblockstats);
-
-    double nCompressionRate = compute24hAverageCompressionInternal(mapThinBlocksOutBound, mapBloomFiltersInBound);
+    int64_t nNow = getTimeForStats();
+    double nCompressionRate = compute24hAverageCompression(nNow, ringThinBlocksOutBound, ringBloomFiltersInBound);
 
-    // NOTE: Potential gotcha, compute24hAverageCompressionInternal has a side-effect of calling
-    //       expireStats which modifies the contents of mapThinBlocksOutBound
-    // We currently rely on this side-effect for the string produced below
     std::ostringstream ss;
     ss << std::fixed << std::setprecision(1);
-    ss << "Compression for " << mapThinBlocksOutBound.size()
+    ss << "Compression for " << ringThinBlocksOutBound.Count(nNow)
        << " Outbound thinblocks (last 24hrs): " << nCompressionRate << "%";
     return ss.str();
 }
@@ -1124,8 +1049,7 @@ std::string CThinBlockData::OutBoundPercentToString()
 // Calculate the average inbound xthin bloom filter size
 std::string CThinBlockData::InBoundBloomFiltersToString()
 {
-    LOCK(cs_thinblockstats);
-    double avgBloomSize = average(mapBloomFiltersInBound);
+    double avgBloomSize = ringBloomFiltersInBound.Average(getTimeForStats());
     std::ostringstream ss;
     ss << "Inbound bloom filter size (last 24hrs) AVG: " << formatInfoUnit(avgBloomSize);
     return ss.str();
@@ -1134,8 +1058,7 @@ std::string CThinBlockData::InBoundBloomFiltersToString()
 // Calculate the average inbound xthin bloom filter size
 std::string CThinBlockData::OutBoundBloomFiltersToString()
 {
-    LOCK(cs_thinblockstats);
-    double avgBloomSize = average(mapBloomFiltersOutBound);
+    double avgBloomSize = ringBloomFiltersOutBound.Average(getTimeForStats());
     std::ostringstream ss;
     ss << "Outbound bloom filter size (last 24hrs) AVG: " << formatInfoUnit(avgBloomSize);
     return ss.str();
@@ -1143,32 +1066,9 @@ std::string CThinBlockData::OutBoundBloomFiltersToString()
 // Calculate the xthin average response time over the last 24 hours
 std::string CThinBlockData::ResponseTimeToString()
 {
-    LOCK(cs_thinblockstats);
-
-    expireStats(mapThinBlockResponseTime);
-
-    std::vector<double> vResponseTime;
-
-    double nResponseTimeAverage = 0;
-    double nPercentile = 0;
-    double nTotalResponseTime = 0;
-    double nTotalEntries = 0;
-    for (const auto &mi : mapThinBlockResponseTime)
-    {
-        nTotalEntries += 1;
-        nTotalResponseTime += mi.second;
-        vResponseTime.push_back(mi.second);
-    }
-
-    if (nTotalEntries > 0)
-    {
-        nResponseTimeAverage = (double)nTotalResponseTime / nTotalEntries;
-
-        // Calculate the 95th percentile
-        uint64_t nPercentileElement = static_cast<int>((nTotalEntries * 0.95) + 0.5) - 1;
-        sort(vResponseTime.begin(), vResponseTime.end());
-        nPercentile = vResponseTime[nPercentileElement];
-    }
+    int64_t nNow = getTimeForStats();
+    double nResponseTimeAverage = ringThinBlockResponseTime.Average(nNow);
+    double nPercentile = ringThinBlockResponseTime.Percentile(nNow, 0.95);
 
     std::ostringstream ss;
     ss << std::fixed << std::setprecision(2);
@@ -1179,32 +1079,9 @@ std::string CThinBlockData::ResponseTimeToString()
 // Calculate the xthin average validation time over the last 24 hours
 std::string CThinBlockData::ValidationTimeToString()
 {
-    LOCK(cs_thinblockstats);
-
-    expireStats(mapThinBlockValidationTime);
-
-    std::vector<double> vValidationTime;
-
-    double nValidationTimeAverage = 0;
-    double nPercentile = 0;
-    double nTotalValidationTime = 0;
-    double nTotalEntries = 0;
-    for (const auto &mi : mapThinBlockValidationTime)
-    {
-        nTotalEntries += 1;
-        nTotalValidationTime += mi.second;
-        vValidationTime.push_back(mi.second);
-    }
-
-    if (nTotalEntries > 0)
-    {
-        nValidationTimeAverage = (double)nTotalValidationTime / nTotalEntries;
-
-        // Calculate the 95th percentile
-        uint64_t nPercentileElement = static_cast<int>((nTotalEntries * 0.95) + 0.5) - 1;
-        sort(vValidationTime.begin(), vValidationTime.end());
-        nPercentile = vValidationTime[nPercentileElement];
-    }
+    int64_t nNow = getTimeForStats();
+    double nValidationTimeAverage = ringThinBlockValidationTime.Average(nNow);
+    double nPercentile = ringThinBlockValidationTime.Percentile(nNow, 0.95);
 
     std::ostringstream ss;
     ss << std::fixed << std::setprecision(2);
@@ -1215,17 +1092,13 @@ std::string CThinBlockData::ValidationTimeToString()
 // Calculate the xthin transaction re-request ratio and counter over the last 24 hours
 std::string CThinBlockData::ReRequestedTxToString()
 {
-    LOCK(cs_thinblockstats);
+    int64_t nNow = getTimeForStats();
+    double nReRequestRate = compute24hInboundRerequestTxPercent(nNow);
 
-    double nReRequestRate = compute24hInboundRerequestTxPercentInternal();
-
-    // NOTE: Potential gotcha, compute24hInboundRerequestTxPercentInternal has a side-effect of calling
-    //       expireStats which modifies the contents of mapThinBlocksInBoundReRequestedTx
-    // We currently rely on this side-effect for the string produced below
     std::ostringstream ss;
     ss << std::fixed << std::setprecision(1);
     ss << "Tx re-request rate (last 24hrs): " << nReRequestRate
-       << "% Total re-requests:" << mapThinBlocksInBoundReRequestedTx.size();
+       << "% Total re-requests:" << ringThinBlocksInBoundReRequestedTx.Count(nNow);
     return ss.str();
 }
 
@@ -1241,8 +1114,7 @@ std::string CThinBlockData::MempoolLimiterBytesSavedToString()
 // Calculate the average xthin block size
 std::string CThinBlockData::ThinBlockToString()
 {
-    LOCK(cs_thinblockstats);
-    double avgThinBlockSize = average(mapThinBlock);
+    double avgThinBlockSize = ringThinBlock.Average(getTimeForStats());
     std::ostringstream ss;
     ss << "Thinblock size (last 24hrs) AVG: " << formatInfoUnit(avgThinBlockSize);
     return ss.str();
@@ -1251,8 +1123,7 @@ std::string CThinBlockData::ThinBlockToString()
 // Calculate the average size of all full txs sent with block
 std::string CThinBlockData::FullTxToString()
 {
-    LOCK(cs_thinblockstats);
-    double avgFullTxSize = average(mapFullTx);
+    double avgFullTxSize = ringFullTx.Average(getTimeForStats());
     std::ostringstream ss;
     ss << "Thinblock full transactions size (last 24hrs) AVG: " << formatInfoUnit(avgFullTxSize);
     return ss.str();
@@ -1271,15 +1142,15 @@ void CThinBlockData::ClearThinBlockStats()
     nTotalThinBlockBytes.Clear();
     nTotalFullTxBytes.Clear();
 
-    mapThinBlocksInBound.clear();
-    mapThinBlocksOutBound.clear();
-    mapBloomFiltersOutBound.clear();
-    mapBloomFiltersInBound.clear();
-    mapThinBlockResponseTime.clear();
-    mapThinBlockValidationTime.clear();
-    mapThinBlocksInBoundReRequestedTx.clear();
-    mapThinBlock.clear();
-    mapFullTx.clear();
+    ringThinBlocksInBound.Clear();
+    ringThinBlocksOutBound.Clear();
+    ringBloomFiltersOutBound.Clear();
+    ringBloomFiltersInBound.Clear();
+    ringThinBlockResponseTime.Clear();
+    ringThinBlockValidationTime.Clear();
+    ringThinBlocksInBoundReRequestedTx.Clear();
+    ringThinBlock.Clear();
+    ringFullTx.Clear();
 }
 
 void CThinBlockData::FillThinBlockQuickStats(ThinBlockQuickStats &stats)
@@ -1287,23 +1158,20 @@ void CThinBlockData::FillThinBlockQuickStats(ThinBlockQuickStats &stats)
     if (!IsThinBlocksEnabled())
         return;
 
-    LOCK(cs_thinblockstats);
+    int64_t nNow = getTimeForStats();
+    stats.fLast24hInboundCompression =
+        compute24hAverageCompression(nNow, ringThinBlocksInBound, ringBloomFiltersOutBound);
+    stats.nLast24hInbound = ringThinBlocksInBound.Count(nNow);
+    stats.fLast24hOutboundCompression =
+        compute24hAverageCompression(nNow, ringThinBlocksOutBound, ringBloomFiltersInBound);
+    stats.nLast24hOutbound = ringThinBlocksOutBound.Count(nNow);
+    stats.fLast24hRerequestTxPercent = compute24hInboundRerequestTxPercent(nNow);
+    stats.nLast24hRerequestTx = ringThinBlocksInBoundReRequestedTx.Count(nNow);
 
+    LOCK(cs_thinblockstats);
     stats.nTotalInbound = nInBoundBlocks();
     stats.nTotalOutbound = nOutBoundBlocks();
     stats.nTotalBandwidthSavings = computeTotalBandwidthSavingsInternal();
-
-    // NOTE: The following calls rely on the side-effect of the compute*Internal
-    //       calls also calling expireStats on the associated statistics maps
-    //       This is why we set the % value first, then the count second for compression values
-    stats.fLast24hInboundCompression =
-        compute24hAverageCompressionInternal(mapThinBlocksInBound, mapBloomFiltersOutBound);
-    stats.nLast24hInbound = mapThinBlocksInBound.size();
-    stats.fLast24hOutboundCompression =
-        compute24hAverageCompressionInternal(mapThinBlocksOutBound, mapBloomFiltersInBound);
-    stats.nLast24hOutbound = mapThinBlocksOutBound.size();
-    stats.fLast24hRerequestTxPercent = compute24hInboundRerequestTxPercentInternal();
-    stats.nLast24hRerequestTx = mapThinBlocksInBoundReRequestedTx.size();
 }
 
 bool IsThinBlocksEnabled() { return GetBoolArg("-use-thinblocks", true); }
@@ -1637,9 +1505,9 @@ void BuildSeededBloomFilter(CBloomFilter &filterMemPool,
     // Also add all the transaction hashes currently in the txCommitQ
     {
         boost::unique_lock<boost::mutex> lock(csCommitQ);
-        for (auto &it : *txCommitQ)
+        for (const CTxCommitData &data : *txCommitQ)
         {
-            setHighScoreMemPoolHashes.insert(it.first);
+            setHighScoreMemPoolHashes.insert(data.hash);
         }
     }
 
@@ -5,6 +5,7 @@
 #ifndef BITCOIN_THINBLOCK_H
 #define BITCOIN_THINBLOCK_H
 
+#include "blockrelay/blockrelay_stats.h"
 #include "bloom.h"
 #include "consensus/validation.h"
 #include "primitives/block.h"
@@ -220,7 +221,7 @@ struct ThinBlockQuickStats
 class CThinBlockData
 {
 private:
-    CCriticalSection cs_thinblockstats; // locks everything below this point
+    CCriticalSection cs_thinblockstats; // locks the lifetime totals below
 
     CStatHistory<uint64_t> nOriginalSize;
     CStatHistory<uint64_t> nThinSize;
@@ -230,35 +231,17 @@ private:
     CStatHistory<uint64_t> nTotalBloomFilterBytes;
     CStatHistory<uint64_t> nTotalThinBlockBytes;
     CStatHistory<uint64_t> nTotalFullTxBytes;
-    std::map<int64_t, std::pair<uint64_t, uint64_t> > mapThinBlocksInBound;
-    std::map<int64_t, std::pair<uint64_t, uint64_t> > mapThinBlocksOutBound;
-    std::map<int64_t, uint64_t> mapBloomFiltersOutBound;
-    std::map<int64_t, uint64_t> mapBloomFiltersInBound;
-    std::map<int64_t, double> mapThinBlockResponseTime;
-    std::map<int64_t, double> mapThinBlockValidationTime;
-    std::map<int64_t, int> mapThinBlocksInBoundReRequestedTx;
-    std::map<int64_t, uint64_t> mapThinBlock;
-    std::map<int64_t, uint64_t> mapFullTx;
 
-    /**
-        Add new entry to statistics array; also removes old timestamps
-        from statistics array using expireStats() below.
-        @param [statsMap] a statistics array
-        @param [value] the value to insert for the current time
-     */
-    template <class T>
-    void updateStats(std::map<int64_t, T> &statsMap, T value);
-
-    /**
-       Expire old statistics in given array (currently after one day).
-       Uses getTimeForStats() virtual method for timing. */
-    template <class T>
-    void expireStats(std::map<int64_t, T> &statsMap);
-
-    /**
-      Calculate average of long long values in given map. Return 0 for no entries.
-      Expires values before calculation. */
-    double average(std::map<int64_t, uint64_t> &map);
+    // Last 24 hour statistics. These are lock free and do not require cs_thinblockstats.
+    CRollingStatRing<uint64_t, 2> ringThinBlocksInBound;
+    CRollingStatRing<uint64_t, 2> ringThinBlocksOutBound;
+    CRollingStatRing<uint64_t> ringBloomFiltersOutBound;
+    CRollingStatRing<uint64_t> ringBloomFiltersInBound;
+    CRollingStatRing<double> ringThinBlockResponseTime;
+    CRollingStatRing<double> ringThinBlockValidationTime;
+    CRollingStatRing<int> ringThinBlocksInBoundReRequestedTx;
+    CRollingStatRing<uint64_t> ringThinBlock;
+    CRollingStatRing<uint64_t> ringFullTx;
 
     /**
       Calculate total bandwidth savings for using XThin.
@@ -267,25 +250,21 @@ private:
 
     /**
       Calculate last 24-hour "compression" percent for XThin
-      Requires lock on cs_thinblockstats be held external to this call.
 
-      NOTE: The thinblock and bloom filter maps should be from opposite directions
-            For example inbound block map paired wtih outbound bloom filter map
+      NOTE: The thinblock and bloom filter rings should be from opposite directions
+            For example inbound block ring paired wtih outbound bloom filter ring
 
-      Side-effect: This method calls expireStats() on mapThinBlocks and mapBloomFilters
-
-      @param [mapThinBlocks] a statistics array of inbound/outbound XThin blocks
-      @param [mapBloomFilters] a statistics array of outbound/inbound XThin bloom filters
+      @param [nNow] the time at the end of the 24 hour window
+      @param [ringThinBlocks] a statistics ring of inbound/outbound XThin blocks
+      @param [ringBloomFilters] a statistics ring of outbound/inbound XThin bloom filters
      */
-    double compute24hAverageCompressionInternal(std::map<int64_t, std::pair<uint64_t, uint64_t> > &mapThinBlocks,
-        std::map<int64_t, uint64_t> &mapBloomFilters) EXCLUSIVE_LOCKS_REQUIRED(cs_thinblockstats);
+    double compute24hAverageCompression(int64_t nNow,
+        const CRollingStatRing<uint64_t, 2> &ringThinBlocks,
+        const CRollingStatRing<uint64_t> &ringBloomFilters) const;
 
     /**
-      Calculate last 24-hour transaction re-request percent for inbound XThin
-      Requires lock on cs_thinblockstats be held external to this call.
-
-      Side-effect: This method calls expireStats() on mapThinBlocksInBoundReRequestedTx */
-    double compute24hInboundRerequestTxPercentInternal() EXCLUSIVE_LOCKS_REQUIRED(cs_thinblockstats);
+      Calculate last 24-hour transaction re-request percent for inbound XThin */
+    double compute24hInboundRerequestTxPercent(int64_t nNow) const;
 
 protected:
     //! Virtual method so it can be overridden for better unit testing
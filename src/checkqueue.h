@@ -8,6 +8,7 @@
 
 #include <algorithm>
 #include <atomic>
+#include <deque>
 #include <vector>
 
 #include <boost/thread/condition_variable.hpp>
@@ -26,12 +27,33 @@ class CCheckQueueControl;
   * onto the queue, where they are processed by N-1 worker threads. When
   * the master is done adding work, it temporarily joins the worker pool
   * as an N'th worker, until all jobs are done.
+  *
+  * Each worker has its own deque of checks.  The master spreads every batch it adds over the workers' deques,
+  * a worker takes checks from the back of its own deque, and when that is empty it steals from the front of the
+  * others.  A deque's lock is only contended when its checks are being stolen, and the queue wide mutex is only
+  * taken by threads that have run out of work and by the master to wake them.
   */
 template <typename T>
 class CCheckQueue
 {
+public:
+    //! Workers beyond this many share a deque
+    static const size_t MAX_WORKER_QUEUES = 64;
+
 private:
-    //! Mutex to protect the inner state
+    struct WorkerQueue
+    {
+        boost::mutex mutex;
+        std::deque<T> checks;
+    };
+
+    //! One deque per worker
+    WorkerQueue queues[MAX_WORKER_QUEUES];
+
+    //! Passed to Loop() by the master, which has no deque of its own and only steals
+    static const size_t NO_QUEUE = MAX_WORKER_QUEUES;
+
+    //! Mutex that idle threads wait with
     boost::mutex mutex;
 
     //! Worker threads block on this when out of work
@@ -40,25 +62,24 @@ private:
     //! Master thread blocks on this when out of work
     boost::condition_variable condMaster;
 
-    //! The queue of elements to be processed.
-    //! As the order of booleans doesn't matter, it is used as a LIFO (stack)
-    std::vector<T> queue;
-
-    //! The number of workers (including the master) that are idle.
-    int nIdle;
+    //! The number of workers that have started
+    std::atomic<size_t> nWorkers;
 
-    //! The total number of workers (including the master).
-    int nTotal;
+    //! The deque that the next added batch starts at
+    std::atomic<size_t> nNextQueue;
 
     //! The temporary evaluation result.
-    bool fAllOk;
+    std::atomic<bool> fAllOk;
 
     /**
      * Number of verifications that haven't completed yet.
      * This includes elements that are no longer queued, but still in the
      * worker's own batches.
      */
-    unsigned int nTodo;
+    std::atomic<unsigned int> nTodo;
+
+    //! Number of verifications that are still in a deque
+    std::atomic<unsigned int> nQueued;
 
     //! Whether we're shutting down this round of parallel validation
     std::atomic<bool> fQuit;
@@ -69,91 +90,114 @@ private:
     //! The maximum number of elements to be processed in one batch
     unsigned int nBatchSize;
 
+    //! Number of deques that checks are spread over
+    size_t QueueCount() const
+    {
+        const size_t nCount = nWorkers.load();
+        return nCount == 0 ? 1 : (nCount < MAX_WORKER_QUEUES ? nCount : MAX_WORKER_QUEUES);
+    }
+
+    /**
+     * Move a batch of checks into vChecks, from the back of our own deque or else from the front of another.
+     * Batches are half of what is left in a deque, up to nBatchSize, so that all workers finish at about the
+     * same time.
+     */
+    bool Take(size_t nSelf, std::vector<T> &vChecks)
+    {
+        const size_t nQueues = QueueCount();
+        const size_t nStart = (nSelf == NO_QUEUE) ? 0 : nSelf;
+        for (size_t i = 0; i < nQueues; i++)
+        {
+            const size_t nQueue = (nStart + i) % nQueues;
+            const bool fOwn = (nQueue == nSelf);
+            WorkerQueue &queue = queues[nQueue];
+            boost::unique_lock<boost::mutex> lock(queue.mutex);
+            if (queue.checks.empty())
+                continue;
+            const size_t nNow = std::max<size_t>(1, std::min<size_t>(nBatchSize, queue.checks.size() / 2));
+            vChecks.resize(nNow);
+            for (T &check : vChecks)
+            {
+                // swap rather than copy, to keep the deque locked for as short a time as possible
+                if (fOwn)
+                {
+                    check.swap(queue.checks.back());
+                    queue.checks.pop_back();
+                }
+                else
+                {
+                    check.swap(queue.checks.front());
+                    queue.checks.pop_front();
+                }
+            }
+            nQueued -= nNow;
+            return true;
+        }
+        return false;
+    }
+
     /** Internal function that does bulk of the verification work. */
     bool Loop(bool fMaster = false)
     {
-        boost::condition_variable &cond = fMaster ? condMaster : condWorker;
+        const size_t nSelf = fMaster ? NO_QUEUE : (nWorkers++ % MAX_WORKER_QUEUES);
         std::vector<T> vChecks;
         vChecks.reserve(nBatchSize);
-        unsigned int nNow = 0;
-        bool fOk = true;
         do
         {
+            if (!Take(nSelf, vChecks))
             {
                 boost::unique_lock<boost::mutex> lock(mutex);
-                // first do the clean-up of the previous loop run (allowing us to do it in the same critsect)
-                if (nNow)
-                {
-                    fAllOk &= fOk;
-                    if (nTodo >= nNow)
-                        nTodo -= nNow;
-                    if (nTodo == 0 && !fMaster)
-                    {
-                        // We processed the last element; inform the master it can exit and return the result
-                        queue.clear();
-                        condMaster.notify_one();
-                    }
-                    if (fQuit && !fMaster)
-                    {
-                        nTodo -= queue.size();
-                        queue.clear();
-                        condMaster.notify_one();
-                    }
-                }
-                else
-                {
-                    // first iteration
-                    nTotal++;
-                }
-                // logically, the do loop starts here
-                while (queue.empty())
+                if (fMaster)
                 {
-                    if (fExit)
-                        return fAllOk;
-                    if ((fMaster) && nTodo == 0)
+                    while (nQueued == 0 && nTodo != 0 && !fExit)
+                        condMaster.wait(lock);
+                    if (nTodo == 0 || fExit)
                     {
-                        nTotal--;
                         bool fRet = fAllOk;
                         // reset the status for new work later
-                        if (fMaster)
-                            fAllOk = true;
-                        // return the current status
+                        fAllOk = true;
                         fQuit = false; // reset the flag before returning
                         return fRet;
                     }
-                    nIdle++;
-                    cond.wait(lock); // wait
-                    nIdle--;
                 }
-                // Decide how many work units to process now.
-                // * Do not try to do everything at once, but aim for increasingly smaller batches so
-                //   all workers finish approximately simultaneously.
-                // * Try to account for idle jobs which will instantly start helping.
-                // * Don't do batches smaller than 1 (duh), or larger than nBatchSize.
-                nNow = std::max(1U, std::min(nBatchSize, (unsigned int)queue.size() / (nTotal + nIdle + 1)));
-                vChecks.resize(nNow);
-                for (unsigned int i = 0; i < nNow; i++)
+                else
                 {
-                    // We want the lock on the mutex to be as short as possible, so swap jobs from the global
-                    // queue to the local batch vector instead of copying.
-                    vChecks[i].swap(queue.back());
-                    queue.pop_back();
+                    while (nQueued == 0)
+                    {
+                        if (fExit)
+                            return fAllOk;
+                        condWorker.wait(lock); // wait
+                    }
                 }
-                // Check whether we need to do work at all
-                fOk = fAllOk;
+                continue;
             }
-            // execute work
+
+            // execute work, skipping whatever is left once a check has failed or the round has been quit
+            bool fOk = true;
             for (T &check : vChecks)
-                if (fOk)
-                    fOk = check();
+            {
+                if (!fOk || fQuit || !fAllOk)
+                    break;
+                fOk = check();
+            }
+            if (!fOk)
+                fAllOk = false;
+            const unsigned int nNow = vChecks.size();
             vChecks.clear();
+            if (nTodo.fetch_sub(nNow) == nNow)
+            {
+                // We processed the last element; inform the master it can exit and return the result
+                boost::unique_lock<boost::mutex> lock(mutex);
+                condMaster.notify_one();
+            }
         } while (true);
     }
 
 public:
     //! Create a new check queue
     CCheckQueue(unsigned int nBatchSizeIn)
-        : nIdle(0), nTotal(0), fAllOk(true), nTodo(0), fQuit(false), fExit(false), nBatchSize(nBatchSizeIn)
+        : nWorkers(0), nNextQueue(0), fAllOk(true), nTodo(0), nQueued(0), fQuit(false), fExit(false),
+          nBatchSize(nBatchSizeIn)
     {
     }
 
@@ -166,6 +210,7 @@ public:
     //! All threads exit
     void Shutdown()
     {
+        boost::unique_lock<boost::mutex> lock(mutex);
         fExit = true;
         condWorker.notify_all();
         condMaster.notify_all();
@@ -173,25 +218,40 @@ public:
     //! Add a batch of checks to the queue
     void Add(std::vector<T> &vChecks)
     {
-        boost::unique_lock<boost::mutex> lock(mutex);
-        for (T &check : vChecks)
+        if (vChecks.empty())
+            return;
+        nTodo += vChecks.size();
+
+        // Spread the batch over the deques in contiguous runs, starting where the last batch left off
+        const size_t nQueues = QueueCount();
+        const size_t nRun = (vChecks.size() + nQueues - 1) / nQueues;
+        size_t nQueue = nNextQueue++ % nQueues;
+        for (size_t nBegin = 0; nBegin < vChecks.size(); nBegin += nRun, nQueue = (nQueue + 1) % nQueues)
         {
-            queue.push_back(T());
-            check.swap(queue.back());
+            const size_t nEnd = std::min(vChecks.size(), nBegin + nRun);
+            WorkerQueue &queue = queues[nQueue];
+            boost::unique_lock<boost::mutex> lock(queue.mutex);
+            for (size_t i = nBegin; i < nEnd; i++)
+            {
+                queue.checks.push_back(T());
+                vChecks[i].swap(queue.checks.back());
+            }
+            nQueued += nEnd - nBegin;
         }
-        nTodo += vChecks.size();
-        if (vChecks.size() == 1)
-            condWorker.notify_one();
-        else if (vChecks.size() > 1)
+
+        // Wake no more workers than there are new checks for, rather than every worker for every transaction
+        boost::unique_lock<boost::mutex> lock(mutex);
+        if (vChecks.size() >= nWorkers.load())
             condWorker.notify_all();
+        else
+        {
+            for (size_t i = 0; i < vChecks.size(); i++)
+                condWorker.notify_one();
+        }
     }
 
     ~CCheckQueue() {}
-    bool IsIdle()
-    {
-        boost::unique_lock<boost::mutex> lock(mutex);
-        return (nTotal == nIdle && nTodo == 0 && fAllOk == true);
-    }
+    bool IsIdle() { return (nTodo == 0 && nQueued == 0 && fAllOk == true); }
 };
 
 /**
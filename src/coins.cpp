@@ -44,7 +44,8 @@ SaltedOutpointHasher::SaltedOutpointHasher()
 {
 }
 
-CCoinsViewCache::CCoinsViewCache(CCoinsView *baseIn) : CCoinsViewBacked(baseIn), nBestCoinHeight(0), cachedCoinsUsage(0)
+CCoinsViewCache::CCoinsViewCache(CCoinsView *baseIn)
+    : CCoinsViewBacked(baseIn), nBestCoinHeight(0), cachedCoinsUsage(0), nFlushes(0)
 {
 }
 
@@ -200,25 +201,35 @@ bool CCoinsViewCache::HaveCoin(const COutPoint &outpoint) const
 
 bool CCoinsViewCache::GetCoinFromDB(const COutPoint &outpoint) const
 {
+    const uint64_t nFlushesBefore = nFlushes.load();
     Coin coin;
-    if (!base->GetCoin(outpoint, coin))
-        return false;
+    bool fFound = base->GetCoin(outpoint, coin);
 
     WRITELOCK(cs_utxo);
-    CCoinsMap::iterator ret =
-        cacheCoins
-            .emplace(std::piecewise_construct, std::forward_as_tuple(outpoint), std::forward_as_tuple(std::move(coin)))
-            .first;
-    if (ret->second.coin.IsSpent())
+    // If we were flushed while reading, the coin may have been spent in the base since, so read it again.
+    if (nFlushes.load() != nFlushesBefore)
+        fFound = base->GetCoin(outpoint, coin);
+    if (!fFound)
+        return false;
+
+    // A coin that is already cached may have been modified, so it is kept as it is
+    CCoinsMap::iterator ret;
+    bool inserted;
+    std::tie(ret, inserted) = cacheCoins.emplace(
+        std::piecewise_construct, std::forward_as_tuple(outpoint), std::forward_as_tuple(std::move(coin)));
+    if (inserted)
     {
-        // The parent only has an empty entry for this outpoint; we can consider our
-        // version as fresh.
-        ret->second.flags = CCoinsCacheEntry::FRESH;
-    }
-    cachedCoinsUsage += ret->second.coin.DynamicMemoryUsage();
+        if (ret->second.coin.IsSpent())
+        {
+            // The parent only has an empty entry for this outpoint; we can consider our
+            // version as fresh.
+            ret->second.flags = CCoinsCacheEntry::FRESH;
+        }
+        cachedCoinsUsage += ret->second.coin.DynamicMemoryUsage();
 
-    if (nBestCoinHeight < ret->second.coin.nHeight)
-        nBestCoinHeight = ret->second.coin.nHeight;
+        if (nBestCoinHeight < ret->second.coin.nHeight)
+            nBestCoinHeight = ret->second.coin.nHeight;
+    }
 
     return !ret->second.coin.IsSpent();
 }
@@ -333,6 +344,7 @@ bool CCoinsViewCache::Flush()
 {
     WRITELOCK(cs_utxo);
     bool fOk = base->BatchWrite(cacheCoins, hashBlock, nBestCoinHeight, cachedCoinsUsage);
+    nFlushes++;
     return fOk;
 }
 
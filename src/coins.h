@@ -7,6 +7,7 @@
 #ifndef BITCOIN_COINS_H
 #define BITCOIN_COINS_H
 
+#include "arenamap.h"
 #include "compressor.h"
 #include "core_memusage.h"
 #include "hashwrapper.h"
@@ -16,6 +17,7 @@
 #include "uint256.h"
 
 #include <assert.h>
+#include <atomic>
 #include <stdint.h>
 
 #include <boost/thread/locks.hpp>
@@ -131,7 +133,12 @@ struct CCoinsCacheEntry
     explicit CCoinsCacheEntry(Coin &&coin_) : coin(std::move(coin_)), flags(0) {}
 };
 
-typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsMap;
+/**
+ * The coins cache keeps its entries in an arena rather than in one heap node per coin, which keeps large caches
+ * compact and lets their memory usage be accounted exactly.  Iterating is not disturbed by erasing entries, which
+ * BatchWrite and Trim do as they go.
+ */
+typedef arenamap<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsMap;
 
 /** Cursor for iterating over CoinsView state */
 class CCoinsViewCursor
@@ -276,6 +283,8 @@ protected:
     mutable CSharedCriticalSection csCacheInsert;
     /* Cached dynamic memory usage for the inner Coin objects. */
     mutable size_t cachedCoinsUsage;
+    /* Number of times this cache has been flushed to its base. */
+    std::atomic<uint64_t> nFlushes;
 
 
 public:
@@ -294,8 +303,9 @@ public:
 
     /**
      * Check if we have the given utxo on disk and load it into cache.
-     * The semantics are the same as HaveCoin(), but no calls to
-     * the backing CCoinsView are made.
+     * The semantics are the same as HaveCoin(), but the backing CCoinsView
+     * is read without holding cs_utxo, so any number of threads can load
+     * coins at once.
      */
     bool GetCoinFromDB(const COutPoint &outpoint) const;
 
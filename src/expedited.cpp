@@ -14,8 +14,14 @@
 
 #define NUM_XPEDITED_STORE 10
 
-// Just save the last few expedited sent blocks so we don't resend (uint256)
-static uint256 xpeditedBlkSent[NUM_XPEDITED_STORE];
+struct CExpeditedSent
+{
+    uint256 hash;
+    unsigned char msgType = 0;
+};
+
+// Just save the last few expedited sent blocks, and the form they were sent in, so we don't resend
+static CExpeditedSent xpeditedBlkSent[NUM_XPEDITED_STORE];
 
 // zeros on construction)
 static int xpeditedBlkSendPos = 0;
@@ -80,15 +86,28 @@ bool HandleExpeditedRequest(CDataStream &vRecv, CNode *pfrom)
     return true;
 }
 
-static inline bool IsRecentlyExpeditedAndStore(const uint256 &hash)
+/**
+ * Return true if this block was already expedited in a form that covers msgType. An xthin goes to every expedited
+ * peer while a compact block only goes to compact block capable peers, so after a compact block cut-through the
+ * xthin is still sent, but only to the remaining peers (fSkipCompactPeers is set).
+ */
+static inline bool IsRecentlyExpeditedAndStore(const uint256 &hash, unsigned char msgType, bool &fSkipCompactPeers)
 {
     AssertLockHeld(connmgr->cs_expedited);
 
+    fSkipCompactPeers = false;
     for (int i = 0; i < NUM_XPEDITED_STORE; i++)
-        if (xpeditedBlkSent[i] == hash)
+    {
+        if (xpeditedBlkSent[i].hash != hash)
+            continue;
+        if (xpeditedBlkSent[i].msgType == msgType || xpeditedBlkSent[i].msgType == EXPEDITED_MSG_XTHIN)
             return true;
+        if (xpeditedBlkSent[i].msgType == EXPEDITED_MSG_CMPCT)
+            fSkipCompactPeers = true;
+    }
 
-    xpeditedBlkSent[xpeditedBlkSendPos] = hash;
+    xpeditedBlkSent[xpeditedBlkSendPos].hash = hash;
+    xpeditedBlkSent[xpeditedBlkSendPos].msgType = msgType;
     xpeditedBlkSendPos++;
     if (xpeditedBlkSendPos >= NUM_XPEDITED_STORE)
         xpeditedBlkSendPos = 0;
@@ -109,6 +128,12 @@ bool HandleExpeditedBlock(CDataStream &vRecv, CNode *pfrom)
     {
         return CXThinBlock::HandleMessage(vRecv, pfrom, NetMsgType::XPEDITEDBLK, hops + 1);
     }
+    else if (msgType == EXPEDITED_MSG_CMPCT)
+    {
+        if (!IsCompactBlocksEnabled())
+            return true;
+        return CompactBlock::HandleMessage(vRecv, pfrom, hops + 1);
+    }
     else
     {
         return error(
@@ -116,8 +141,17 @@ bool HandleExpeditedBlock(CDataStream &vRecv, CNode *pfrom)
     }
 }
 
-static void ActuallySendExpeditedBlock(CXThinBlock &thinBlock, unsigned char hops, const CNode *pskip)
+static void ActuallySendExpeditedBlock(const uint256 &hash,
+    unsigned char msgType,
+    unsigned char hops,
+    const std::vector<unsigned char> &vPayload,
+    const CNode *pskip,
+    bool fSkipCompactPeers)
 {
+    // The payload was serialized once, either by us or by the peer we received it from, and is pushed as is
+    // to every expedited peer.
+    CFlatData payload((void *)vPayload.data(), (void *)(vPayload.data() + vPayload.size()));
+
     VNodeRefs vNodeRefs(connmgr->ExpeditedBlockNodes());
     for (CNodeRef &nodeRef : vNodeRefs)
     {
@@ -129,48 +163,72 @@ static void ActuallySendExpeditedBlock(CXThinBlock &thinBlock, unsigned char hop
         }
         else if (pnode != pskip) // Don't send back to the sending node to avoid looping
         {
-            LOG(THIN, "Sending expedited block %s to %s\n", thinBlock.header.GetHash().ToString(), pnode->GetLogName());
+            if (msgType == EXPEDITED_MSG_CMPCT && !pnode->CompactBlockCapable())
+                continue;
+            if (fSkipCompactPeers && pnode->CompactBlockCapable())
+                continue;
+
+            LOG(THIN, "Sending expedited block %s to %s\n", hash.ToString(), pnode->GetLogName());
 
-            pnode->PushMessage(NetMsgType::XPEDITEDBLK, (unsigned char)EXPEDITED_MSG_XTHIN, hops, thinBlock);
+            pnode->PushMessage(NetMsgType::XPEDITEDBLK, msgType, hops, payload);
             pnode->blocksSent += 1;
         }
     }
 }
 
-void SendExpeditedBlock(CXThinBlock &thinBlock, unsigned char hops, CNode *pskip)
+void ForwardExpeditedBlock(const uint256 &hash,
+    unsigned char msgType,
+    unsigned char hops,
+    const std::vector<unsigned char> &vPayload,
+    CNode *pskip)
 {
+    LOCK(connmgr->cs_expedited);
+    bool fSkipCompactPeers = false;
+    if (!IsRecentlyExpeditedAndStore(hash, msgType, fSkipCompactPeers))
     {
-        LOCK(cs_main);
+        ActuallySendExpeditedBlock(hash, msgType, hops, vPayload, pskip, fSkipCompactPeers);
+    }
+    // else nothing else to do
+}
 
-        // Check we have a valid header with correct timestamp
-        CValidationState state;
-        CBlockIndex *pindex = nullptr;
-        if (!AcceptBlockHeader(thinBlock.header, state, Params(), &pindex))
-        {
-            LOGA("Received an invalid expedited header from peer %s\n", pskip ? pskip->GetLogName() : "none");
-            return;
-        }
+/** Accept the header and check that it extends the chain tip. Return false if the block should not be expedited. */
+static bool CanExpediteHeader(const CBlockHeader &header, CNode *pskip)
+{
+    LOCK(cs_main);
 
-        // Validate that the header has enough proof of work to advance the chain or at least be equal
-        // to the current chain tip in case of a re-org.
-        if (!pindex || pindex->nChainWork < chainActive.Tip()->nChainWork)
-        {
-            // Don't print out a log message here. We can sometimes get them during IBD which during
-            // periods where the chain is almost syncd but really isn't. This typically happens in regtest
-            // and is can be confusing to see this in the logs when trying to debug other issues.
-            //
-            // LOGA("Not sending expedited block %s from peer %s, does not extend longest chain\n",
-            //    thinBlock.header.GetHash().ToString(), pskip ? pskip->GetLogName() : "none");
-            return;
-        }
+    // Check we have a valid header with correct timestamp
+    CValidationState state;
+    CBlockIndex *pindex = nullptr;
+    if (!AcceptBlockHeader(header, state, Params(), &pindex))
+    {
+        LOGA("Received an invalid expedited header from peer %s\n", pskip ? pskip->GetLogName() : "none");
+        return false;
     }
 
-    LOCK(connmgr->cs_expedited);
-    if (!IsRecentlyExpeditedAndStore(thinBlock.header.GetHash()))
+    // Validate that the header has enough proof of work to advance the chain or at least be equal
+    // to the current chain tip in case of a re-org.
+    if (!pindex || pindex->nChainWork < chainActive.Tip()->nChainWork)
     {
-        ActuallySendExpeditedBlock(thinBlock, hops, pskip);
+        // Don't print out a log message here. We can sometimes get them during IBD which during
+        // periods where the chain is almost syncd but really isn't. This typically happens in regtest
+        // and is can be confusing to see this in the logs when trying to debug other issues.
+        //
+        // LOGA("Not sending expedited block %s from peer %s, does not extend longest chain\n",
+        //    header.GetHash().ToString(), pskip ? pskip->GetLogName() : "none");
+        return false;
     }
-    // else nothing else to do
+    return true;
+}
+
+void SendExpeditedBlock(CXThinBlock &thinBlock, unsigned char hops, CNode *pskip)
+{
+    if (!CanExpediteHeader(thinBlock.header, pskip))
+        return;
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << thinBlock;
+    std::vector<unsigned char> vPayload(ss.begin(), ss.end());
+    ForwardExpeditedBlock(thinBlock.header.GetHash(), EXPEDITED_MSG_XTHIN, hops, vPayload, pskip);
 }
 
 void SendExpeditedBlock(const CBlock &block, CNode *pskip)
@@ -178,3 +236,20 @@ void SendExpeditedBlock(const CBlock &block, CNode *pskip)
     CXThinBlock thinBlock(block);
     SendExpeditedBlock(thinBlock, 0, pskip);
 }
+
+/**
+ * Cut-through relay of a compact block: forward the compact block exactly as it was received to our compact block
+ * capable expedited peers once its header is accepted, in parallel with our own reconstruction and validation.
+ */
+void SendExpeditedBlock(const CompactBlock &cmpctBlock,
+    const std::vector<unsigned char> &vPayload,
+    unsigned char hops,
+    CNode *pskip)
+{
+    if (!expeditedCutThrough.Value() || vPayload.empty())
+        return;
+    if (!CanExpediteHeader(cmpctBlock.header, pskip))
+        return;
+
+    ForwardExpeditedBlock(cmpctBlock.header.GetHash(), EXPEDITED_MSG_CMPCT, hops, vPayload, pskip);
+}
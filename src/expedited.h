@@ -5,7 +5,9 @@
 #ifndef BITCOIN_EXPEDITED_H
 #define BITCOIN_EXPEDITED_H
 
+#include "blockrelay/compactblock.h"
 #include "blockrelay/thinblock.h"
+#include "tweak.h"
 
 enum
 {
@@ -18,8 +20,12 @@ enum
 {
     EXPEDITED_MSG_HDR = 1,
     EXPEDITED_MSG_XTHIN = 2,
+    EXPEDITED_MSG_CMPCT = 3,
 };
 
+// Forward compact blocks to compact block capable expedited peers as soon as their header is accepted
+extern CTweak<bool> expeditedCutThrough;
+
 
 // Checks to see if the node is configured in bitcoin.conf to
 extern bool CheckAndRequestExpeditedBlocks(CNode *pfrom);
@@ -27,6 +33,17 @@ extern bool CheckAndRequestExpeditedBlocks(CNode *pfrom);
 // be an expedited block source and if so, request them.
 extern void SendExpeditedBlock(CXThinBlock &thinBlock, unsigned char hops, CNode *pskip = nullptr);
 extern void SendExpeditedBlock(const CBlock &block, CNode *pskip = nullptr);
+extern void SendExpeditedBlock(const CompactBlock &cmpctBlock,
+    const std::vector<unsigned char> &vPayload,
+    unsigned char hops,
+    CNode *pskip);
+
+// Forward an already serialized expedited payload whose header has been accepted and extends the chain tip
+extern void ForwardExpeditedBlock(const uint256 &hash,
+    unsigned char msgType,
+    unsigned char hops,
+    const std::vector<unsigned char> &vPayload,
+    CNode *pskip);
 extern bool HandleExpeditedRequest(CDataStream &vRecv, CNode *pfrom);
 
 // process incoming unsolicited block
@@ -242,7 +242,7 @@ CCond cvTxInQ;
 CFastFilter<4 * 1024 * 1024> incomingConflicts GUARDED_BY(csTxInQ);
 
 // Tranactions that are waiting for validation and are known not to conflict with others
-std::queue<CTxInputData> txInQ GUARDED_BY(csTxInQ);
+CTxInputQueue txInQ;
 
 // Transaction that cannot be processed in this round (may potentially conflict with other tx)
 std::queue<CTxInputData> txDeferQ GUARDED_BY(csTxInQ);
@@ -253,10 +253,13 @@ std::queue<CTxInputData> txDeferQ GUARDED_BY(csTxInQ);
 std::queue<CTxInputData> txWaitNextBlockQ GUARDED_BY(csTxInQ);
 ;
 
+// Committed transactions whose orphan children have not been resubmitted yet
+std::vector<uint256> vOrphanWork GUARDED_BY(csTxInQ);
+
 // Transactions that have been validated and are waiting to be committed into the mempool
 CWaitableCriticalSection csCommitQ;
 CConditionVariable cvCommitQ GUARDED_BY(csCommitQ);
-std::map<uint256, CTxCommitData> *txCommitQ GUARDED_BY(csCommitQ) = nullptr;
+CTxCommitBatch *txCommitQ GUARDED_BY(csCommitQ) = nullptr;
 
 // Control the execution of the parallel tx validation and serial mempool commit phases
 CThreadCorral txProcessingCorral;
@@ -325,6 +328,14 @@ CTweak<uint64_t> maxSigChecks("consensus.maxBlockSigChecks",
     "Consensus parameter specifying the maximum sigchecks in a block.  Use for testing only!",
     MAY2020_MAX_BLOCK_SIGCHECK_COUNT);
 
+CTweak<bool> batchSchnorrTweak("validation.batchSchnorr",
+    "Verify the Schnorr signatures of a block in batches during parallel script validation (default: true)",
+    true);
+
+CTweak<unsigned int> coinsPrefetchThreads("validation.prefetchThreads",
+    "Number of threads that load the coins spent by a block from disk before it is connected (0 to disable)",
+    DEFAULT_PREFETCH_THREADS);
+
 CTweak<bool> unsafeGetBlockTemplate("mining.unsafeGetBlockTemplate",
     "Allow getblocktemplate to succeed even if the chain tip is old or this node is not connected to other nodes",
     false);
@@ -461,6 +472,21 @@ CTweak<double> grapheneBloomFprOverride("net.grapheneBloomFprOverride",
     "Override size of Bloom filter to the indicated value (greater than 0.0): 0.0 for optimal (default: 0.0)",
     0.0);
 
+/** When a compact block is missing transactions, the getblocktxn request is also sent to this many other
+ * peers that have the block. Whichever peer answers first is used to reconstruct the block.
+ */
+CTweak<unsigned int> missingTxFetchPeers("net.missingTxFetchPeers",
+    "Number of additional peers that are asked for the missing transactions of a compact block at the same time "
+    "as the announcing peer: 0 to only ask the announcing peer (default: 0)",
+    0);
+
+/** Compact blocks are forwarded to compact block capable expedited peers as soon as their header is accepted,
+ * before they are reconstructed and validated. Peers that do not understand expedited compact blocks ignore them.
+ */
+CTweak<bool> expeditedCutThrough("net.expeditedCutThrough",
+    "Forward compact blocks to expedited peers as soon as their header has been checked (default: false)",
+    false);
+
 CTweak<bool> syncMempoolWithPeers("net.syncMempoolWithPeers", "Synchronize mempool with peers", false);
 
 /** This setting specifies the minimum supported mempool sync version (inclusive).
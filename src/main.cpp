@@ -726,7 +726,6 @@ void MainCleanup()
     {
         // orphan transactions
         WRITELOCK(orphanpool.cs_orphanpool);
-        orphanpool.mapOrphanTransactions.clear();
-        orphanpool.mapOrphanTransactionsByPrev.clear();
+        orphanpool._clear();
     }
 }
@@ -6,6 +6,8 @@
 #ifndef BITCOIN_MEMUSAGE_H
 #define BITCOIN_MEMUSAGE_H
 
+#include "prevector.h"
+
 #include <stdlib.h>
 
 #include <map>
@@ -174,6 +176,13 @@ static inline size_t DynamicUsage(const std::unordered_map<X, Y, Z> &m)
     return MallocUsage(sizeof(unordered_node<std::pair<const X, Y> >)) * m.size() +
            MallocUsage(sizeof(void *) * m.bucket_count());
 }
+
+/** The node of one more element plus its share of the bucket array, at the default maximum load factor of one */
+template <typename X, typename Y, typename Z>
+static inline size_t IncrementalDynamicUsage(const std::unordered_map<X, Y, Z> &m)
+{
+    return MallocUsage(sizeof(unordered_node<std::pair<const X, Y> >)) + sizeof(void *);
+}
 }
 
 #endif // BITCOIN_MEMUSAGE_H
@@ -116,6 +116,8 @@ void BlockAssembler::resetBlock(const CScript &scriptPubKeyIn, int64_t coinbaseS
 
     lastFewTxs = 0;
     blockFinished = false;
+
+    minPackageFeeRate = CFeeRate(MAX_MONEY);
 }
 
 uint64_t BlockAssembler::reserveBlockSize(const CScript &scriptPubKeyIn, int64_t coinbaseSize)
@@ -190,9 +192,9 @@ CTransactionRef BlockAssembler::coinbaseTx(const CScript &scriptPubKeyIn, int _n
 struct NumericallyLessTxHashComparator
 {
 public:
-    bool operator()(const CTxMemPoolEntry *a, const CTxMemPoolEntry *b) const
+    bool operator()(const CBlockCandidateTx &a, const CBlockCandidateTx &b) const
     {
-        return a->GetTx().GetHash() < b->GetTx().GetHash();
+        return a.ptx->GetHash() < b.ptx->GetHash();
     }
 };
 
@@ -254,22 +256,53 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript &sc
             }
         }
 
-        std::vector<const CTxMemPoolEntry *> vtxe;
-        addPriorityTxs(&vtxe);
-
-        // Mine by package (CPFP) or by score.
-        if (miningCPFP.Value() == true)
-        {
-            int64_t nStartPackage = GetStopwatchMicros();
-            addPackageTxs(&vtxe, canonical);
-            nTotalPackage += GetStopwatchMicros() - nStartPackage;
-        }
-        else
+        // How much of the block should be dedicated to high-priority transactions,
+        // included regardless of the fees they pay
+        uint64_t nBlockPrioritySize = GetArg("-blockprioritysize", DEFAULT_BLOCK_PRIORITY_SIZE);
+        nBlockPrioritySize = std::min(nBlockMaxSize, nBlockPrioritySize);
+
+        CBlockCandidate::Settings candidateSettings;
+        candidateSettings.hashPrevBlock = pindexPrev->GetBlockHash();
+        candidateSettings.nHeight = nHeight;
+        candidateSettings.nLockTimeCutoff = nLockTimeCutoff;
+        candidateSettings.nReservedSize = nBlockSize;
+        candidateSettings.nBlockMaxSize = nBlockMaxSize;
+        candidateSettings.nBlockMinSize = nBlockMinSize;
+        candidateSettings.nBlockPrioritySize = nBlockPrioritySize;
+        candidateSettings.fCanonical = canonical;
+        candidateSettings.fCPFP = miningCPFP.Value();
+        candidateSettings.fMay2020 = may2020Enabled;
+        candidateSettings.maxSigOpsAllowed = may2020Enabled ? maxSigOpsAllowed : 0;
+        candidateSettings.minRelayFee = ::minRelayTxFee;
+
+        // Reuse the selection the mempool has kept up to date since the last template, if there is one
+        std::vector<CBlockCandidateTx> vCandidate;
+        if (!mempool.blockCandidate->Get(candidateSettings, vCandidate, nBlockSize, nBlockSigOps, nFees))
         {
-            int64_t nStartScore = GetStopwatchMicros();
-            addScoreTxs(&vtxe);
-            nTotalScore += GetStopwatchMicros() - nStartScore;
+            std::vector<const CTxMemPoolEntry *> vtxe;
+            addPriorityTxs(&vtxe, nBlockPrioritySize);
+
+            // Mine by package (CPFP) or by score.
+            if (candidateSettings.fCPFP)
+            {
+                int64_t nStartPackage = GetStopwatchMicros();
+                addPackageTxs(&vtxe, canonical);
+                nTotalPackage += GetStopwatchMicros() - nStartPackage;
+            }
+            else
+            {
+                int64_t nStartScore = GetStopwatchMicros();
+                addScoreTxs(&vtxe);
+                nTotalScore += GetStopwatchMicros() - nStartScore;
+            }
+
+            vCandidate.reserve(vtxe.size());
+            for (const CTxMemPoolEntry *txe : vtxe)
+                vCandidate.push_back(CBlockCandidateTx{txe->GetSharedTx(), txe->GetFee(), txe->GetSigOpCount()});
+            mempool.blockCandidate->Set(
+                candidateSettings, vCandidate, nBlockSize, nBlockSigOps, nFees, minPackageFeeRate);
         }
+        nBlockTx = vCandidate.size();
 
         nLastBlockTx = nBlockTx;
         nLastBlockSize = nBlockSize;
@@ -280,14 +313,17 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript &sc
         // sort tx if there are any and the feature is enabled
         if (canonical)
         {
-            std::sort(vtxe.begin(), vtxe.end(), NumericallyLessTxHashComparator());
+            std::sort(vCandidate.begin(), vCandidate.end(), NumericallyLessTxHashComparator());
         }
 
-        for (auto &txe : vtxe)
+        pblocktemplate->block.vtx.reserve(vCandidate.size() + 1);
+        pblocktemplate->vTxFees.reserve(vCandidate.size() + 1);
+        pblocktemplate->vTxSigOps.reserve(vCandidate.size() + 1);
+        for (const CBlockCandidateTx &txc : vCandidate)
         {
-            pblocktemplate->block.vtx.push_back(txe->GetSharedTx());
-            pblocktemplate->vTxFees.push_back(txe->GetFee());
-            pblocktemplate->vTxSigOps.push_back(txe->GetSigOpCount());
+            pblocktemplate->block.vtx.push_back(txc.ptx);
+            pblocktemplate->vTxFees.push_back(txc.nFee);
+            pblocktemplate->vTxSigOps.push_back(txc.nSigOps);
         }
 
         // Create coinbase transaction.
@@ -314,6 +350,7 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript &sc
     CValidationState state;
     if (!TestBlockValidity(state, chainparams, *pblock, pindexPrev, false, false))
     {
+        mempool.blockCandidate->Invalidate();
         throw std::runtime_error(strprintf("%s: TestBlockValidity failed: %s", __func__, FormatStateMessage(state)));
     }
     if (pblock->fExcessive)
@@ -643,6 +680,7 @@ void BlockAssembler::addPackageTxs(std::vector<const CTxMemPoolEntry *> *vtxe, b
         }
 
         // The Package can now be added to the block.
+        minPackageFeeRate = std::min(minPackageFeeRate, CFeeRate(packageFees, packageSize));
         if (fCanonical)
         {
             for (auto &it : ancestors)
@@ -663,13 +701,8 @@ void BlockAssembler::addPackageTxs(std::vector<const CTxMemPoolEntry *> *vtxe, b
     }
 }
 
-void BlockAssembler::addPriorityTxs(std::vector<const CTxMemPoolEntry *> *vtxe)
+void BlockAssembler::addPriorityTxs(std::vector<const CTxMemPoolEntry *> *vtxe, uint64_t nBlockPrioritySize)
 {
-    // How much of the block should be dedicated to high-priority transactions,
-    // included regardless of the fees they pay
-    uint64_t nBlockPrioritySize = GetArg("-blockprioritysize", DEFAULT_BLOCK_PRIORITY_SIZE);
-    nBlockPrioritySize = std::min(nBlockMaxSize, nBlockPrioritySize);
-
     if (nBlockPrioritySize == 0)
     {
         return;
@@ -743,6 +776,137 @@ void BlockAssembler::addPriorityTxs(std::vector<const CTxMemPoolEntry *> *vtxe)
     }
 }
 
+bool CBlockCandidate::Settings::operator==(const Settings &other) const
+{
+    return hashPrevBlock == other.hashPrevBlock && nHeight == other.nHeight &&
+           nLockTimeCutoff == other.nLockTimeCutoff && nReservedSize == other.nReservedSize &&
+           nBlockMaxSize == other.nBlockMaxSize && nBlockMinSize == other.nBlockMinSize &&
+           nBlockPrioritySize == other.nBlockPrioritySize && fCanonical == other.fCanonical && fCPFP == other.fCPFP &&
+           fMay2020 == other.fMay2020 && maxSigOpsAllowed == other.maxSigOpsAllowed &&
+           minRelayFee == other.minRelayFee;
+}
+
+// The same size and sigops tests as BlockAssembler::addPackageTxs
+bool CBlockCandidate::_PackageFits(uint64_t nPackageSize, unsigned int nPackageSigOps) const
+{
+    AssertLockHeld(cs_candidate);
+    if (nBlockSize + nPackageSize > settings.nBlockMaxSize)
+        return false;
+    const uint64_t nMaxSigOps =
+        settings.fMay2020 ? settings.maxSigOpsAllowed : GetMaxBlockSigOpsCount(nBlockSize + nPackageSize);
+    return nBlockSigOps + nPackageSigOps < nMaxSigOps;
+}
+
+void CBlockCandidate::TxAdded(CTxMemPool::txiter it, const CTxMemPool::setEntries &setAncestors)
+{
+    LOCK(cs_candidate);
+    if (!fValid)
+        return;
+    if (!settings.fCPFP || !settings.fCanonical)
+    {
+        // Score mining and non canonical blocks order transactions by fee, so a new one could land anywhere
+        fValid = false;
+        return;
+    }
+
+    // The package is the new transaction and whichever of its ancestors were not selected
+    CTxMemPool::setEntries package;
+    package.insert(it);
+    for (CTxMemPool::txiter ancestor : setAncestors)
+    {
+        if (!setTxids.count(ancestor->GetTxHash()))
+            package.insert(ancestor);
+    }
+    uint64_t nPackageSize = 0;
+    unsigned int nPackageSigOps = 0;
+    CAmount nPackageFees = 0;
+    bool fFinal = true;
+    for (CTxMemPool::txiter entry : package)
+    {
+        nPackageSize += entry->GetTxSize();
+        nPackageSigOps += entry->GetSigOpCount();
+        nPackageFees += entry->GetModifiedFee();
+        fFinal &= IsFinalTx(entry->GetSharedTx(), settings.nHeight, settings.nLockTimeCutoff);
+    }
+
+    if (nPackageFees < settings.minRelayFee.GetFee(nPackageSize))
+    {
+        // Not worth mining, unless the block is still being padded up to its minimum size
+        if (nBlockSize < settings.nBlockMinSize)
+            fValid = false;
+        return;
+    }
+    if (!fFinal)
+        return;
+    if (!_PackageFits(nPackageSize, nPackageSigOps))
+    {
+        if (CFeeRate(nPackageFees, nPackageSize) > minPackageFeeRate)
+            fValid = false;
+        return;
+    }
+
+    // The template sorts canonical blocks by txid, so the order they are appended in doesn't matter
+    for (CTxMemPool::txiter entry : package)
+    {
+        vTx.push_back(CBlockCandidateTx{entry->GetSharedTx(), entry->GetFee(), entry->GetSigOpCount()});
+        setTxids.insert(entry->GetTxHash());
+        nFees += entry->GetFee();
+    }
+    nBlockSize += nPackageSize;
+    nBlockSigOps += nPackageSigOps;
+    minPackageFeeRate = std::min(minPackageFeeRate, CFeeRate(nPackageFees, nPackageSize));
+}
+
+void CBlockCandidate::TxRemoved(const uint256 &hash)
+{
+    LOCK(cs_candidate);
+    if (fValid && setTxids.count(hash))
+        fValid = false;
+}
+
+void CBlockCandidate::Invalidate()
+{
+    LOCK(cs_candidate);
+    fValid = false;
+}
+
+void CBlockCandidate::Set(const Settings &newSettings,
+    const std::vector<CBlockCandidateTx> &vNewTx,
+    uint64_t nNewBlockSize,
+    unsigned int nNewBlockSigOps,
+    CAmount nNewFees,
+    const CFeeRate &newMinPackageFeeRate)
+{
+    LOCK(cs_candidate);
+    settings = newSettings;
+    vTx = vNewTx;
+    setTxids.clear();
+    setTxids.reserve(vTx.size());
+    for (const CBlockCandidateTx &txc : vTx)
+        setTxids.insert(txc.ptx->GetHash());
+    nBlockSize = nNewBlockSize;
+    nBlockSigOps = nNewBlockSigOps;
+    nFees = nNewFees;
+    minPackageFeeRate = newMinPackageFeeRate;
+    fValid = true;
+}
+
+bool CBlockCandidate::Get(const Settings &currentSettings,
+    std::vector<CBlockCandidateTx> &vTxOut,
+    uint64_t &nBlockSizeOut,
+    unsigned int &nBlockSigOpsOut,
+    CAmount &nFeesOut) const
+{
+    LOCK(cs_candidate);
+    if (!fValid || !(settings == currentSettings))
+        return false;
+    vTxOut = vTx;
+    nBlockSizeOut = nBlockSize;
+    nBlockSigOpsOut = nBlockSigOps;
+    nFeesOut = nFees;
+    return true;
+}
+
 void IncrementExtraNonce(CBlock *pblock, unsigned int &nExtraNonce)
 {
     // Update nExtraNonce
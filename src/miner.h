@@ -12,6 +12,7 @@
 
 #include <memory>
 #include <stdint.h>
+#include <unordered_set>
 
 #include "boost/multi_index/ordered_index.hpp"
 #include "boost/multi_index_container.hpp"
@@ -45,6 +46,83 @@ struct CBlockTemplate
 };
 
 
+/** A transaction chosen for the block candidate, with what a block template records about it */
+struct CBlockCandidateTx
+{
+    CTransactionRef ptx;
+    CAmount nFee;
+    unsigned int nSigOps;
+};
+
+/**
+ * The transactions selected for the last block template, kept up to date as the mempool changes so that the next
+ * template for the same tip and settings is a copy of the selection rather than a new walk of the mempool.
+ *
+ * The mempool calls TxAdded and TxRemoved with its write lock held. A new transaction whose package fits in the
+ * remaining space is appended. Anything the candidate can't follow invalidates it, and the next template is then
+ * assembled from scratch. That covers a selected transaction leaving the mempool, a fee delta, a better paying
+ * package that no longer fits, a new tip, and any addition when mining by score or without canonical ordering,
+ * where the block order depends on the fees. The priority area is only refilled on a rebuild.
+ */
+class CBlockCandidate
+{
+public:
+    /** Everything besides the mempool contents that the selection depends on */
+    struct Settings
+    {
+        uint256 hashPrevBlock;
+        int nHeight = 0;
+        int64_t nLockTimeCutoff = 0;
+        uint64_t nReservedSize = 0; // header and coinbase
+        uint64_t nBlockMaxSize = 0;
+        uint64_t nBlockMinSize = 0;
+        uint64_t nBlockPrioritySize = 0;
+        bool fCanonical = false;
+        bool fCPFP = false;
+        bool fMay2020 = false;
+        uint64_t maxSigOpsAllowed = 0;
+        CFeeRate minRelayFee;
+
+        bool operator==(const Settings &other) const;
+    };
+
+private:
+    mutable CCriticalSection cs_candidate;
+    bool fValid GUARDED_BY(cs_candidate) = false;
+    Settings settings GUARDED_BY(cs_candidate);
+    std::vector<CBlockCandidateTx> vTx GUARDED_BY(cs_candidate);
+    std::unordered_set<uint256, SaltedTxidHasher> setTxids GUARDED_BY(cs_candidate);
+    uint64_t nBlockSize GUARDED_BY(cs_candidate) = 0;
+    unsigned int nBlockSigOps GUARDED_BY(cs_candidate) = 0;
+    CAmount nFees GUARDED_BY(cs_candidate) = 0;
+    //! The lowest package fee rate selected. A package paying more that doesn't fit could displace something.
+    CFeeRate minPackageFeeRate GUARDED_BY(cs_candidate);
+
+    bool _PackageFits(uint64_t nPackageSize, unsigned int nPackageSigOps) const;
+
+public:
+    /** Follow a transaction entering the mempool, with its in-mempool ancestors */
+    void TxAdded(CTxMemPool::txiter it, const CTxMemPool::setEntries &setAncestors);
+    /** Follow a transaction leaving the mempool */
+    void TxRemoved(const uint256 &hash);
+    /** Forget the selection, so that the next template is assembled from scratch */
+    void Invalidate();
+
+    /** Replace the selection with one just assembled from the mempool */
+    void Set(const Settings &newSettings,
+        const std::vector<CBlockCandidateTx> &vNewTx,
+        uint64_t nNewBlockSize,
+        unsigned int nNewBlockSigOps,
+        CAmount nNewFees,
+        const CFeeRate &newMinPackageFeeRate);
+    /** Copy the selection out if it is valid and was made with the same settings */
+    bool Get(const Settings &currentSettings,
+        std::vector<CBlockCandidateTx> &vTxOut,
+        uint64_t &nBlockSizeOut,
+        unsigned int &nBlockSigOpsOut,
+        CAmount &nFeesOut) const;
+};
+
 /** Comparator for CTxMemPool::txiter objects.
  *  It simply compares the internal memory address of the CTxMemPoolEntry object
  *  pointed to. This means it has no meaning, and is only useful for using them
@@ -97,6 +175,9 @@ private:
     bool may2020Enabled = false;
     uint64_t maxSigOpsAllowed = 0;
 
+    // Lowest fee rate of the packages added by addPackageTxs
+    CFeeRate minPackageFeeRate;
+
 public:
     BlockAssembler(const CChainParams &chainparams);
     /** Construct a new block template with coinbase to scriptPubKeyIn */
@@ -113,7 +194,7 @@ private:
     /** Add transactions based on modified feerate */
     void addScoreTxs(std::vector<const CTxMemPoolEntry *> *vtxe);
     /** Add transactions based on tx "priority" */
-    void addPriorityTxs(std::vector<const CTxMemPoolEntry *> *vtxe);
+    void addPriorityTxs(std::vector<const CTxMemPoolEntry *> *vtxe, uint64_t nBlockPrioritySize);
 
     /** Add transactions based on feerate including unconfirmed ancestors */
     void addPackageTxs(std::vector<const CTxMemPoolEntry *> *vtxe, bool fCanonical);
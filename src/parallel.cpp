@@ -48,7 +48,7 @@ static void AddScriptCheckThreads(int i, CCheckQueue<CScriptCheck> *pqueue)
 bool CScriptCheck::operator()()
 {
     const CScript &scriptSig = ptxTo->vin[nIn].scriptSig;
-    CachingTransactionSignatureChecker checker(ptxTo, nIn, amount, nFlags, cacheStore);
+    CBatchingTransactionSignatureChecker checker(ptxTo, nIn, amount, nFlags, cacheStore, schnorrBatch);
     ScriptMachineResourceTracker smRes;
     if (!VerifyScript(scriptSig, scriptPubKey, nFlags, maxOps, checker, &error, &smRes))
     {
@@ -609,6 +609,11 @@ void HandleBlockMessageThread(CNodeRef noderef, const string strCommand, CBlockR
 
         PV->InitThread(this_id, pfrom, pblock, inv, nSizeBlock); // initialize the mapBlockValidationThread entries
 
+        // Load the coins that the block spends now, in parallel and before cs_main is taken to connect it. The
+        // proof of work is checked first so that a peer can not make us read the coins database for nothing.
+        if (CheckProofOfWork(pblock->GetHash(), pblock->nBits, Params().GetConsensus()))
+            PrefetchBlockCoins(*pblock, pcoinsTip);
+
         // Process all blocks from whitelisted peers, even if not requested,
         // unless we're still syncing with the network.
         // Such an unrequested block may still be processed, subject to the
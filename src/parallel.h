@@ -85,6 +85,8 @@ public:
  * Closure representing one script verification
  * Note that this stores references to the spending transaction
  */
+class CSchnorrBatch;
+
 class CScriptCheck
 {
 protected:
@@ -97,12 +99,13 @@ protected:
     unsigned int maxOps;
     bool cacheStore;
     ScriptError error;
+    CSchnorrBatch *schnorrBatch;
 
 public:
     unsigned char sighashType;
     CScriptCheck()
         : resourceTracker(nullptr), amount(0), ptxTo(0), nIn(0), nFlags(0), maxOps(0xffffffff), cacheStore(false),
-          error(SCRIPT_ERR_UNKNOWN_ERROR), sighashType(0)
+          error(SCRIPT_ERR_UNKNOWN_ERROR), schnorrBatch(nullptr), sighashType(0)
     {
     }
 
@@ -116,7 +119,7 @@ public:
         bool cacheIn)
         : resourceTracker(resourceTrackerIn), scriptPubKey(scriptPubKeyIn), amount(amountIn), ptxTo(&txToIn),
           nIn(nInIn), nFlags(nFlagsIn), maxOps(maxOpsIn), cacheStore(cacheIn), error(SCRIPT_ERR_UNKNOWN_ERROR),
-          sighashType(0)
+          schnorrBatch(nullptr), sighashType(0)
     {
     }
 
@@ -134,8 +137,11 @@ public:
         std::swap(error, check.error);
         std::swap(sighashType, check.sighashType);
         std::swap(maxOps, check.maxOps);
+        std::swap(schnorrBatch, check.schnorrBatch);
     }
 
+    //! Defer this check's Schnorr signatures to a batch, which must outlive the check
+    void SetSchnorrBatch(CSchnorrBatch *batch) { schnorrBatch = batch; }
     ScriptError GetScriptError() const { return error; }
 };
 
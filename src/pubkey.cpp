@@ -260,6 +260,39 @@ bool CPubKey::VerifySchnorr(const uint256 &hash, const std::vector<uint8_t> &vch
     return secp256k1_schnorr_verify(secp256k1_context_verify, &vchSig[0], hash.begin(), &pubkey);
 }
 
+bool CPubKey::VerifySchnorrBatch(const std::vector<const CPubKey *> &pubkeys,
+    const std::vector<const uint256 *> &hashes,
+    const std::vector<const std::vector<uint8_t> *> &vchSigs)
+{
+    const size_t n = pubkeys.size();
+    if (hashes.size() != n || vchSigs.size() != n)
+        return false;
+
+    std::vector<secp256k1_pubkey> vParsed(n);
+    std::vector<const secp256k1_pubkey *> vpParsed(n);
+    std::vector<const unsigned char *> vpMsgs(n);
+    std::vector<const unsigned char *> vpSigs(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        const CPubKey &pubkey = *pubkeys[i];
+        if (!pubkey.IsValid() || vchSigs[i]->size() != 64)
+            return false;
+        if (!secp256k1_ec_pubkey_parse(secp256k1_context_verify, &vParsed[i], &pubkey[0], pubkey.size()))
+            return false;
+        vpParsed[i] = &vParsed[i];
+        vpMsgs[i] = hashes[i]->begin();
+        vpSigs[i] = vchSigs[i]->data();
+    }
+
+    // Big enough for Pippenger's algorithm over a few hundred points; without it the batch is no faster.
+    secp256k1_scratch_space *scratch = secp256k1_scratch_space_create(secp256k1_context_verify, 1 << 20);
+    int ret = secp256k1_schnorr_verify_batch(
+        secp256k1_context_verify, scratch, vpSigs.data(), vpMsgs.data(), vpParsed.data(), n);
+    if (scratch)
+        secp256k1_scratch_space_destroy(secp256k1_context_verify, scratch);
+    return ret;
+}
+
 bool CPubKey::RecoverCompact(const uint256 &hash, const std::vector<uint8_t> &vchSig)
 {
     if (vchSig.size() != COMPACT_SIGNATURE_SIZE)
@@ -161,6 +161,14 @@ public:
      */
     bool VerifySchnorr(const uint256 &hash, const std::vector<uint8_t> &vchSig) const;
 
+    /**
+     * Verify a batch of Schnorr signatures, where vchSigs[i] signs hashes[i] with pubkeys[i].
+     * Returns true only if every signature is valid, but does not tell which one is not.
+     */
+    static bool VerifySchnorrBatch(const std::vector<const CPubKey *> &pubkeys,
+        const std::vector<const uint256 *> &hashes,
+        const std::vector<const std::vector<uint8_t> *> &vchSigs);
+
     /**
      * Check whether a DER-serialized ECDSA signature is normalized (lower-S).
      */
@@ -594,7 +594,7 @@ bool CRequestManager::RequestBlock(CNode *pfrom, CInv obj)
                 {
                     READLOCK(orphanpool.cs_orphanpool);
                     for (auto &mi : orphanpool.mapOrphanTransactions)
-                        vOrphanHashes.emplace_back(mi.first);
+                        vOrphanHashes.emplace_back(mi.ptx->GetHash());
                 }
                 BuildSeededBloomFilter(filterMemPool, vOrphanHashes, inv2.hash, pfrom);
                 ss << inv2;
@@ -32,6 +32,7 @@
 #include "validation/validation.h"
 #include "validation/verifydb.h"
 
+#include <algorithm>
 #include <stdint.h>
 
 #include <univalue.h>
@@ -274,12 +275,20 @@ UniValue mempoolToJSON(bool fVerbose /* = false */)
     if (fVerbose)
     {
         READLOCK(mempool.cs_txmempool);
-        UniValue o(UniValue::VOBJ);
+        // The txid index is hashed, so sort the entries to keep the output ordered by txid
+        vector<const CTxMemPoolEntry *> vEntries;
+        vEntries.reserve(mempool.mapTx.size());
         for (const CTxMemPoolEntry &e : mempool.mapTx)
+            vEntries.push_back(&e);
+        std::sort(vEntries.begin(), vEntries.end(),
+            [](const CTxMemPoolEntry *a, const CTxMemPoolEntry *b) { return a->GetTxHash() < b->GetTxHash(); });
+
+        UniValue o(UniValue::VOBJ);
+        for (const CTxMemPoolEntry *e : vEntries)
         {
-            const uint256 &hash = e.GetTx().GetHash();
+            const uint256 &hash = e->GetTxHash();
             UniValue info(UniValue::VOBJ);
-            entryToJSON(info, e);
+            entryToJSON(info, *e);
             o.pushKV(hash.ToString(), info);
         }
         return o;
@@ -288,6 +297,7 @@ UniValue mempoolToJSON(bool fVerbose /* = false */)
     {
         vector<uint256> vtxid;
         mempool.queryHashes(vtxid);
+        std::sort(vtxid.begin(), vtxid.end());
 
         UniValue a(UniValue::VARR);
         for (const uint256 &hash : vtxid)
@@ -1457,6 +1467,17 @@ UniValue mempoolInfoToJSON()
         ret.pushKV("peak_tps", "N/A");
     }
 
+    UniValue shards(UniValue::VARR);
+    for (uint64_t nDepth : txInQ.ShardDepths())
+        shards.push_back(nDepth);
+    ret.pushKV("txinq_shards", shards);
+    UniValue maxShards(UniValue::VARR);
+    for (uint64_t nDepth : txInQ.MaxShardDepths())
+        maxShards.push_back(nDepth);
+    ret.pushKV("txinq_shards_max", maxShards);
+    ret.pushKV("txinq_stolen", txInQ.Stolen());
+    ret.pushKV("commit_lock_us", commitLockTimeHistogram.ToUniValue());
+
     return ret;
 }
 
@@ -1474,6 +1495,12 @@ UniValue getmempoolinfo(const UniValue &params, bool fHelp)
                             "  \"mempoolminfee\": xxxxx       (numeric) Minimum fee for tx to be accepted\n"
                             "  \"tps\": xxxxx                 (numeric) Transactions per second accepted\n"
                             "  \"peak_tps\": xxxxx            (numeric) Peak Transactions per second accepted\n"
+                            "  \"txinq_shards\": [xx,...]     (array) Transactions waiting for admission in each input "
+                            "queue shard\n"
+                            "  \"txinq_shards_max\": [xx,...] (array) Highest depth reached by each input queue shard\n"
+                            "  \"txinq_stolen\": xxxxx        (numeric) Transactions taken from another thread's shard\n"
+                            "  \"commit_lock_us\": [xx,...]   (array) Histogram of mempool write lock hold times when "
+                            "committing transactions. Element i counts holds of less than 2^i microseconds\n"
                             "}\n"
                             "\nExamples:\n" +
                             HelpExampleCli("getmempoolinfo", "") + HelpExampleRpc("getmempoolinfo", ""));
@@ -536,6 +536,7 @@ static UniValue GetGrapheneStats()
         obj.pushKV("graphene_block_size", graphenedata.GrapheneBlockToString());
         obj.pushKV("graphene_additional_tx_size", graphenedata.AdditionalTxToString());
         obj.pushKV("rerequested", graphenedata.ReRequestedTxToString());
+        obj.pushKV("failure_recovery_time", graphenedata.FailureRecoveryTimeToString());
     }
     return obj;
 }
@@ -555,6 +556,7 @@ static UniValue GetCompactBlockStats()
         obj.pushKV("validation_time", compactdata.ValidationTimeToString());
         obj.pushKV("compact_block_size", compactdata.CompactBlockToString());
         obj.pushKV("compact_full_tx", compactdata.FullTxToString());
+        obj.pushKV("missing_tx_fetch_time", compactdata.MissingTxFetchTimeToString());
         obj.pushKV("rerequested", compactdata.ReRequestedTxToString());
     }
     return obj;
@@ -173,3 +173,94 @@ bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<uint8
     return RunMemoizedCheck(vchSig, pubkey, sighash, nFlags, store,
         [&] { return TransactionSignatureChecker::VerifySignature(vchSig, pubkey, sighash); });
 }
+
+bool CBatchingTransactionSignatureChecker::VerifySignature(const std::vector<uint8_t> &vchSig,
+    const CPubKey &pubkey,
+    const uint256 &sighash) const
+{
+    if (batch == nullptr || vchSig.size() != 64 || !(nFlags & SCRIPT_VERIFY_NULLFAIL))
+        return CachingTransactionSignatureChecker::VerifySignature(vchSig, pubkey, sighash);
+
+    uint256 entry;
+    signatureCache.ComputeEntry(entry, vchSig, pubkey, sighash, nFlags);
+    if (signatureCache.Get(entry, !store))
+        return true;
+    return batch->Add(vchSig, pubkey, sighash, nFlags, store);
+}
+
+bool CSchnorrBatch::Add(const std::vector<uint8_t> &vchSig,
+    const CPubKey &pubkey,
+    const uint256 &sighash,
+    uint32_t flags,
+    bool fStore)
+{
+    if (!fValid)
+        return false;
+
+    std::vector<Entry> vFull;
+    {
+        LOCK(cs_batch);
+        vPending.push_back(Entry{vchSig, pubkey, sighash, flags, fStore});
+        if (vPending.size() < BATCH_SIZE)
+            return true;
+        vFull.swap(vPending);
+        vPending.reserve(BATCH_SIZE);
+    }
+    return Verify(vFull);
+}
+
+bool CSchnorrBatch::Flush()
+{
+    std::vector<Entry> vLeft;
+    {
+        LOCK(cs_batch);
+        vLeft.swap(vPending);
+    }
+    return Verify(vLeft) && fValid;
+}
+
+bool CSchnorrBatch::Verify(const std::vector<Entry> &vEntries)
+{
+    if (vEntries.empty() || !fValid)
+        return fValid;
+
+    std::vector<const CPubKey *> pubkeys;
+    std::vector<const uint256 *> hashes;
+    std::vector<const std::vector<uint8_t> *> vchSigs;
+    pubkeys.reserve(vEntries.size());
+    hashes.reserve(vEntries.size());
+    vchSigs.reserve(vEntries.size());
+    for (const Entry &e : vEntries)
+    {
+        pubkeys.push_back(&e.pubkey);
+        hashes.push_back(&e.sighash);
+        vchSigs.push_back(&e.vchSig);
+    }
+
+    if (!CPubKey::VerifySchnorrBatch(pubkeys, hashes, vchSigs))
+    {
+        // The batch does not say which signature is bad, so find it for the log
+        for (const Entry &e : vEntries)
+        {
+            if (!e.pubkey.VerifySchnorr(e.sighash, e.vchSig))
+            {
+                LOGA("Schnorr batch verification failed: invalid signature %s for pubkey %s\n", HexStr(e.vchSig),
+                    HexStr(e.pubkey));
+                break;
+            }
+        }
+        fValid = false;
+        return false;
+    }
+
+    for (const Entry &e : vEntries)
+    {
+        if (e.fStore)
+        {
+            uint256 entry;
+            signatureCache.ComputeEntry(entry, e.vchSig, e.pubkey, e.sighash, e.flags);
+            signatureCache.Set(entry);
+        }
+    }
+    return true;
+}
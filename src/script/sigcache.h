@@ -7,8 +7,11 @@
 #ifndef BITCOIN_SCRIPT_SIGCACHE_H
 #define BITCOIN_SCRIPT_SIGCACHE_H
 
+#include "pubkey.h"
 #include "script/interpreter.h"
+#include "sync.h"
 
+#include <atomic>
 #include <vector>
 
 // DoS prevention: limit cache size to 32MB (over 1000000 entries on 64-bit
@@ -16,8 +19,6 @@
 // more (~32.25 MB)
 static const unsigned int DEFAULT_MAX_SIG_CACHE_SIZE = 32;
 
-class CPubKey;
-
 /**
  * We're hashing a nonce into the entries themselves, so we don't need extra
  * blinding in the set hash computation.
@@ -41,7 +42,7 @@ public:
 
 class CachingTransactionSignatureChecker : public TransactionSignatureChecker
 {
-private:
+protected:
     bool store;
 
 public:
@@ -61,6 +62,75 @@ public:
         const uint256 &sighash) const override;
 };
 
+/**
+ * Collects the Schnorr signatures checked by a block's scripts and verifies them in batches of BATCH_SIZE, which
+ * is much cheaper than verifying them one at a time.  The thread whose signature fills a batch verifies it, so
+ * the batches of a block are spread over the script check threads.  Signatures that verify are added to the
+ * signature cache, as CachingTransactionSignatureChecker would have done.
+ */
+class CSchnorrBatch
+{
+public:
+    static const size_t BATCH_SIZE = 128;
+
+    CSchnorrBatch() : fValid(true) {}
+    /**
+     * Add a signature, verifying the batch if it is now full.  Returns false if this or any earlier batch
+     * failed, true if the signature is either verified or still pending.
+     */
+    bool Add(const std::vector<uint8_t> &vchSig,
+        const CPubKey &pubkey,
+        const uint256 &sighash,
+        uint32_t flags,
+        bool fStore);
+    //! Verify the signatures that are still pending.  Returns false if any signature added to the batch is invalid.
+    bool Flush();
+    //! False once a signature added to the batch has been found to be invalid
+    bool IsValid() const { return fValid; }
+private:
+    struct Entry
+    {
+        std::vector<uint8_t> vchSig;
+        CPubKey pubkey;
+        uint256 sighash;
+        uint32_t flags;
+        bool fStore;
+    };
+
+    bool Verify(const std::vector<Entry> &vEntries);
+
+    CCriticalSection cs_batch;
+    std::vector<Entry> vPending GUARDED_BY(cs_batch);
+    std::atomic<bool> fValid;
+};
+
+/**
+ * A caching checker that hands Schnorr signatures to a CSchnorrBatch rather than verifying them, and reports them
+ * as valid.  This is only done when NULLFAIL is enforced: a script can then only succeed if every non-null
+ * signature it checks is valid, so a signature found to be invalid later fails the block, just as it would have
+ * failed the script.  Everything else is checked immediately, as is everything when there is no batch.
+ */
+class CBatchingTransactionSignatureChecker : public CachingTransactionSignatureChecker
+{
+private:
+    CSchnorrBatch *batch;
+
+public:
+    CBatchingTransactionSignatureChecker(const CTransaction *txToIn,
+        unsigned int nInIn,
+        const CAmount &amountIn,
+        unsigned int flags,
+        bool storeIn,
+        CSchnorrBatch *batchIn)
+        : CachingTransactionSignatureChecker(txToIn, nInIn, amountIn, flags, storeIn), batch(batchIn)
+    {
+    }
+
+    bool VerifySignature(const std::vector<uint8_t> &vchSig,
+        const CPubKey &pubkey,
+        const uint256 &sighash) const override;
+};
+
 void InitSignatureCache();
 
 #endif // BITCOIN_SCRIPT_SIGCACHE_H
@@ -23,6 +23,34 @@ SECP256K1_API SECP256K1_WARN_UNUSED_RESULT int secp256k1_schnorr_verify(
   const secp256k1_pubkey *pubkey
 ) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3) SECP256K1_ARG_NONNULL(4);
 
+/**
+ * Verify a batch of signatures created by secp256k1_schnorr_sign, with a
+ * single multi-scalar multiplication.
+ * Returns: 1: all signatures are correct (or n is 0)
+ *          0: at least one signature is incorrect, or the scratch space is
+ *             too small for the batch
+ * Args:    ctx:       a secp256k1 context object, initialized for verification.
+ *          scratch:   scratch space used for the multiplication (can be NULL,
+ *                     which is much slower)
+ * In:      sig64:     array of n pointers to 64-byte signatures
+ *          msg32:     array of n pointers to 32-byte message hashes
+ *          pubkey:    array of n pointers to the public keys to verify with
+ *          n:         number of signatures in the batch
+ *
+ * The batch is checked with random coefficients derived from its own
+ * contents, so the result is the same as verifying each signature on its own,
+ * except with negligible probability. It does not tell which signature is
+ * incorrect.
+ */
+SECP256K1_API SECP256K1_WARN_UNUSED_RESULT int secp256k1_schnorr_verify_batch(
+  const secp256k1_context* ctx,
+  secp256k1_scratch_space *scratch,
+  const unsigned char *const *sig64,
+  const unsigned char *const *msg32,
+  const secp256k1_pubkey *const *pubkey,
+  size_t n
+) SECP256K1_ARG_NONNULL(1);
+
 /**
  * Create a signature using a custom EC-Schnorr-SHA256 construction. It
  * produces non-malleable 64-byte signatures which support batch validation,
@@ -27,6 +27,97 @@ int secp256k1_schnorr_verify(
     return secp256k1_schnorr_sig_verify(&ctx->ecmult_ctx, sig64, &q, msg32);
 }
 
+typedef struct {
+    const secp256k1_context *ctx;
+    const unsigned char *const *sig64;
+    const unsigned char *const *msg32;
+    const secp256k1_pubkey *const *pubkey;
+    const unsigned char *seed;
+} secp256k1_schnorr_verify_batch_data;
+
+/* Points 2*i and 2*i+1 of the multiplication are R_i and P_i, with scalars a_i and a_i*e_i */
+static int secp256k1_schnorr_verify_batch_callback(secp256k1_scalar *sc, secp256k1_ge *pt, size_t idx, void *data) {
+    const secp256k1_schnorr_verify_batch_data *batch = (const secp256k1_schnorr_verify_batch_data *)data;
+    const size_t i = idx / 2;
+
+    secp256k1_schnorr_batch_coefficient(sc, batch->seed, i);
+    if (idx % 2 == 0) {
+        secp256k1_fe Rx;
+        if (!secp256k1_fe_set_b32(&Rx, batch->sig64[i])) {
+            return 0;
+        }
+        return secp256k1_ge_set_xquad(pt, &Rx);
+    } else {
+        secp256k1_scalar e;
+        secp256k1_pubkey_load(batch->ctx, pt, batch->pubkey[i]);
+        secp256k1_schnorr_compute_e(&e, batch->sig64[i], pt, batch->msg32[i]);
+        secp256k1_scalar_mul(sc, sc, &e);
+        return 1;
+    }
+}
+
+int secp256k1_schnorr_verify_batch(
+    const secp256k1_context* ctx,
+    secp256k1_scratch_space *scratch,
+    const unsigned char *const *sig64,
+    const unsigned char *const *msg32,
+    const secp256k1_pubkey *const *pubkey,
+    size_t n
+) {
+    secp256k1_schnorr_verify_batch_data data;
+    secp256k1_sha256 sha;
+    unsigned char seed[32];
+    secp256k1_scalar s, a, sum;
+    secp256k1_gej r;
+    size_t i;
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
+    ARG_CHECK(n == 0 || sig64 != NULL);
+    ARG_CHECK(n == 0 || msg32 != NULL);
+    ARG_CHECK(n == 0 || pubkey != NULL);
+
+    if (n == 0) {
+        return 1;
+    }
+
+    /* The coefficients are seeded with everything in the batch */
+    secp256k1_sha256_initialize(&sha);
+    for (i = 0; i < n; i++) {
+        ARG_CHECK(sig64[i] != NULL);
+        ARG_CHECK(msg32[i] != NULL);
+        ARG_CHECK(pubkey[i] != NULL);
+        secp256k1_sha256_write(&sha, sig64[i], 64);
+        secp256k1_sha256_write(&sha, msg32[i], 32);
+        secp256k1_sha256_write(&sha, pubkey[i]->data, sizeof(pubkey[i]->data));
+    }
+    secp256k1_sha256_finalize(&sha, seed);
+
+    /* sum = -(a_0 * s_0 + ... + a_n-1 * s_n-1) */
+    secp256k1_scalar_clear(&sum);
+    for (i = 0; i < n; i++) {
+        int overflow = 0;
+        secp256k1_scalar_set_b32(&s, sig64[i] + 32, &overflow);
+        if (overflow) {
+            return 0;
+        }
+        secp256k1_schnorr_batch_coefficient(&a, seed, i);
+        secp256k1_scalar_mul(&s, &s, &a);
+        secp256k1_scalar_add(&sum, &sum, &s);
+    }
+    secp256k1_scalar_negate(&sum, &sum);
+
+    data.ctx = ctx;
+    data.sig64 = sig64;
+    data.msg32 = msg32;
+    data.pubkey = pubkey;
+    data.seed = seed;
+    if (!secp256k1_ecmult_multi_var(&ctx->error_callback, &ctx->ecmult_ctx, scratch, &r, &sum,
+            secp256k1_schnorr_verify_batch_callback, &data, 2 * n)) {
+        return 0;
+    }
+    return secp256k1_gej_is_infinity(&r);
+}
+
 int secp256k1_schnorr_sign(
     const secp256k1_context *ctx,
     unsigned char *sig64,
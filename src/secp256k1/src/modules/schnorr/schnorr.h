@@ -24,6 +24,12 @@ static int secp256k1_schnorr_compute_e(
     const unsigned char *msg32
 );
 
+static void secp256k1_schnorr_batch_coefficient(
+    secp256k1_scalar *a,
+    const unsigned char *seed32,
+    size_t i
+);
+
 static int secp256k1_schnorr_sig_sign(
     const secp256k1_ecmult_gen_context* ctx,
     unsigned char *sig64,
@@ -47,6 +47,11 @@
  *     Decompress x coordinate r into point R, with R.y a quadratic residue.
  *       Reject if R is not on the curve.
  *       Signature is valid if R + e * P - s * G == 0.
+ *
+ * Batch verification (of signatures i = 0..n-1, using option 2):
+ *   Compute a seed as the hash of all the signatures, messages and public keys.
+ *   Use the coefficient a_0 = 1, and a_i = Hash(seed || i) mod n for i > 0.
+ *   The batch is valid if sum(a_i * R_i + a_i * e_i * P_i) - sum(a_i * s_i) * G == 0.
  */
 static int secp256k1_schnorr_sig_verify(
     const secp256k1_ecmult_context* ctx,
@@ -130,6 +135,31 @@ static int secp256k1_schnorr_compute_e(
     return !overflow & !secp256k1_scalar_is_zero(e);
 }
 
+static void secp256k1_schnorr_batch_coefficient(
+    secp256k1_scalar *a,
+    const unsigned char *seed32,
+    size_t i
+) {
+    secp256k1_sha256 sha;
+    unsigned char buf[32];
+    int j;
+
+    if (i == 0) {
+        secp256k1_scalar_set_int(a, 1);
+        return;
+    }
+
+    /* seed || little endian 64 bit i */
+    for (j = 0; j < 8; j++) {
+        buf[j] = (unsigned char)(((uint64_t)i) >> (8 * j));
+    }
+    secp256k1_sha256_initialize(&sha);
+    secp256k1_sha256_write(&sha, seed32, 32);
+    secp256k1_sha256_write(&sha, buf, 8);
+    secp256k1_sha256_finalize(&sha, buf);
+    secp256k1_scalar_set_b32(a, buf, NULL);
+}
+
 static int secp256k1_schnorr_sig_sign(
     const secp256k1_ecmult_gen_context* ctx,
     unsigned char *sig64,
@@ -5,6 +5,7 @@
 #ifndef STAT_H
 #define STAT_H
 
+#include <atomic>
 #include <boost/asio.hpp>
 #include <boost/asio/steady_timer.hpp>
 #include <boost/bind/bind.hpp>
@@ -724,6 +725,46 @@ public:
 };
 
 
+/**
+ * A histogram with power of 2 bucket boundaries, suitable for durations that span several orders of magnitude.
+ * Bucket i counts the samples in [2^(i-1), 2^i), bucket 0 counts 0 and the last bucket also counts everything
+ * larger.  Samples are recorded with relaxed atomics so recording never blocks.
+ */
+template <int NumBuckets>
+class CLog2Histogram
+{
+protected:
+    std::atomic<uint64_t> buckets[NumBuckets];
+
+public:
+    CLog2Histogram()
+    {
+        for (auto &bucket : buckets)
+            bucket.store(0, std::memory_order_relaxed);
+    }
+
+    void Add(uint64_t value)
+    {
+        int idx = 0;
+        while (value != 0 && idx < NumBuckets - 1)
+        {
+            value >>= 1;
+            idx++;
+        }
+        buckets[idx].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /** Return the bucket counts as a UniValue array */
+    UniValue ToUniValue() const
+    {
+        UniValue ret(UniValue::VARR);
+        for (const auto &bucket : buckets)
+            ret.push_back(bucket.load(std::memory_order_relaxed));
+        return ret;
+    }
+};
+
+
 // Get the named statistic.  Returns nullptr if it does not exist
 CStatBase *GetStat(char *name);
 
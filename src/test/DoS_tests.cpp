@@ -330,12 +330,10 @@ BOOST_AUTO_TEST_CASE(DoS_bantime_expiration)
 
 CTransaction RandomOrphan()
 {
-    std::map<uint256, CTxOrphanPool::COrphanTx>::iterator it;
     READLOCK(orphanpool.cs_orphanpool);
-    it = orphanpool.mapOrphanTransactions.lower_bound(InsecureRand256());
-    if (it == orphanpool.mapOrphanTransactions.end())
-        it = orphanpool.mapOrphanTransactions.begin();
-    return *it->second.ptx;
+    auto it = orphanpool.mapOrphanTransactions.begin();
+    std::advance(it, InsecureRandRange(orphanpool.mapOrphanTransactions.size()));
+    return *it->ptx;
 }
 
 BOOST_AUTO_TEST_CASE(DoS_mapOrphans)
@@ -365,11 +363,14 @@ BOOST_AUTO_TEST_CASE(DoS_mapOrphans)
 
     {
         WRITELOCK(orphanpool.cs_orphanpool);
-        orphanpool.LimitOrphanTxSize(50, 8900);
+        // all 50 orphans are the same size, including the orphan pool's own index overhead
+        const uint64_t nOrphanBytes = orphanpool.nBytesOrphanPool / 50;
+        BOOST_CHECK_EQUAL(orphanpool.nBytesOrphanPool, 50 * nOrphanBytes);
+        orphanpool.LimitOrphanTxSize(50, 50 * nOrphanBytes);
         BOOST_CHECK_EQUAL(orphanpool.mapOrphanTransactions.size(), 50);
-        orphanpool.LimitOrphanTxSize(50, 6300);
-        BOOST_CHECK(orphanpool.mapOrphanTransactions.size() <= 49);
-        orphanpool.LimitOrphanTxSize(50, 1000);
+        orphanpool.LimitOrphanTxSize(50, 35 * nOrphanBytes);
+        BOOST_CHECK(orphanpool.mapOrphanTransactions.size() <= 35);
+        orphanpool.LimitOrphanTxSize(50, 8 * nOrphanBytes);
         BOOST_CHECK(orphanpool.mapOrphanTransactions.size() <= 8);
         orphanpool.LimitOrphanTxSize(50, 0);
         BOOST_CHECK(orphanpool.mapOrphanTransactions.empty());
@@ -510,4 +511,48 @@ BOOST_AUTO_TEST_CASE(DoS_mapOrphans)
     }
 }
 
+BOOST_AUTO_TEST_CASE(DoS_mapOrphans_indexes)
+{
+    WRITELOCK(orphanpool.cs_orphanpool);
+    orphanpool._clear();
+
+    // 20 orphans that arrive an hour apart
+    int64_t nStartTime = GetTime();
+    std::vector<uint256> vHashes;
+    for (int i = 0; i < 20; i++)
+    {
+        SetMockTime(nStartTime + i * 60 * 60);
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout.n = 0;
+        tx.vin[0].prevout.hash = InsecureRand256();
+        tx.vout.resize(1);
+        tx.vout[0].nValue = i;
+        CTransactionRef ptx = MakeTransactionRef(tx);
+        BOOST_CHECK(orphanpool.AddOrphanTx(ptx, i));
+        vHashes.push_back(ptx->GetHash());
+    }
+    BOOST_CHECK_EQUAL(orphanpool.mapOrphanTransactionsByPrev.size(), 20U);
+
+    // only the orphans older than the expiry are erased, oldest first
+    const int64_t nExpiry = 60 * 60 * DEFAULT_ORPHANPOOL_EXPIRY;
+    orphanpool.SetLastOrphanCheck(0);
+    SetMockTime(nStartTime + 5 * 60 * 60 + nExpiry + 1);
+    orphanpool.EraseOrphansByTime();
+    BOOST_CHECK_EQUAL(orphanpool.mapOrphanTransactions.size(), 14U);
+    for (int i = 0; i < 20; i++)
+        BOOST_CHECK_EQUAL(orphanpool.mapOrphanTransactions.count(vHashes[i]), i < 6 ? 0U : 1U);
+
+    // random eviction keeps the indexes consistent down to an empty pool
+    for (unsigned int nMax = 13; nMax != (unsigned int)-1; nMax--)
+    {
+        BOOST_CHECK_EQUAL(orphanpool.LimitOrphanTxSize(nMax, 10000000), 1U);
+        BOOST_CHECK_EQUAL(orphanpool.mapOrphanTransactions.size(), nMax);
+        BOOST_CHECK_EQUAL(orphanpool.mapOrphanTransactionsByPrev.size(), nMax);
+    }
+    BOOST_CHECK_EQUAL(orphanpool.nBytesOrphanPool, 0U);
+
+    SetMockTime(0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,121 @@
+// Copyright (c) 2019 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "arenamap.h"
+
+#include "test/test_bitcoin.h"
+
+#include <map>
+#include <set>
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+// A poor hash, so that many keys share a home slot and erasing has to shift long runs of slots
+struct CollidingHasher
+{
+    uint64_t operator()(uint64_t n) const { return n & 0xff; }
+};
+
+typedef arenamap<uint64_t, std::string, CollidingHasher> TestMap;
+
+static void CheckEqual(const TestMap &map, const std::map<uint64_t, std::string> &ref)
+{
+    BOOST_CHECK_EQUAL(map.size(), ref.size());
+    size_t nVisited = 0;
+    for (const auto &entry : map)
+    {
+        auto it = ref.find(entry.first);
+        BOOST_CHECK(it != ref.end() && it->second == entry.second);
+        nVisited++;
+    }
+    BOOST_CHECK_EQUAL(nVisited, ref.size());
+    for (const auto &entry : ref)
+    {
+        auto it = map.find(entry.first);
+        BOOST_CHECK(it != map.end() && it->second == entry.second);
+    }
+}
+
+BOOST_FIXTURE_TEST_SUITE(arenamap_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(arenamap_random_ops)
+{
+    TestMap map;
+    std::map<uint64_t, std::string> ref;
+    for (int i = 0; i < 100000; i++)
+    {
+        const uint64_t nKey = InsecureRandRange(3000);
+        switch (InsecureRandRange(4))
+        {
+        case 0:
+        case 1:
+        {
+            auto ret = map.emplace(nKey, std::to_string(i));
+            BOOST_CHECK_EQUAL(ret.second, ref.emplace(nKey, std::to_string(i)).second);
+            BOOST_CHECK(ret.first->second == ref[nKey]);
+            break;
+        }
+        case 2:
+            BOOST_CHECK_EQUAL(map.erase(nKey), ref.erase(nKey));
+            break;
+        case 3:
+            map[nKey] = "x";
+            ref[nKey] = "x";
+            break;
+        }
+    }
+    CheckEqual(map, ref);
+}
+
+BOOST_AUTO_TEST_CASE(arenamap_erase_while_iterating)
+{
+    TestMap map;
+    std::map<uint64_t, std::string> ref;
+    for (uint64_t i = 0; i < 5000; i++)
+    {
+        map.emplace(i, std::to_string(i));
+        ref.emplace(i, std::to_string(i));
+    }
+
+    // references stay valid while other entries are inserted and erased
+    const std::string *pValue = &map.find(42)->second;
+
+    // every entry is visited exactly once while every third one is erased
+    std::set<uint64_t> setVisited;
+    for (auto it = map.begin(); it != map.end();)
+    {
+        BOOST_CHECK(setVisited.insert(it->first).second);
+        if (it->first % 3 == 0)
+        {
+            ref.erase(it->first);
+            it = map.erase(it);
+        }
+        else
+            ++it;
+    }
+    BOOST_CHECK_EQUAL(setVisited.size(), 5000U);
+    CheckEqual(map, ref);
+
+    // erased entries are reused before the arena grows, and erasing brings the usage down
+    const size_t nUsage = map.DynamicMemoryUsage();
+    for (uint64_t i = 5000; i < 5100; i++)
+        map.emplace(i, "");
+    BOOST_CHECK(map.DynamicMemoryUsage() > nUsage);
+    for (uint64_t i = 5000; i < 5100; i++)
+        map.erase(i);
+    BOOST_CHECK(map.DynamicMemoryUsage() <= nUsage);
+    BOOST_CHECK(pValue == &map.find(42)->second);
+    BOOST_CHECK(*pValue == "42");
+
+    // the arena is released once the last entry is gone
+    for (auto it = map.begin(); it != map.end();)
+        it = map.erase(it);
+    BOOST_CHECK(map.empty());
+    BOOST_CHECK_EQUAL(map.DynamicMemoryUsage(), 0U);
+    BOOST_CHECK(map.begin() == map.end());
+    BOOST_CHECK(map.find(1) == map.end());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -9,6 +9,7 @@
 #include "test/test_bitcoin.h"
 #include "uint256.h"
 #include "undo.h"
+#include "validation/validation.h"
 
 #include <map>
 #include <vector>
@@ -771,5 +772,61 @@ BOOST_AUTO_TEST_CASE(ccoins_write)
                     CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
 }
 
+BOOST_AUTO_TEST_CASE(ccoins_prefetch)
+{
+    // coins on "disk", one of which is already spent in the cache
+    CCoinsViewTest base;
+    CCoinsViewCacheTest cache(&base);
+    std::vector<COutPoint> vOnDisk;
+    {
+        CCoinsViewCacheTest writer(&base);
+        for (int i = 0; i < 500; i++)
+        {
+            vOnDisk.push_back(COutPoint(InsecureRand256(), i % 3));
+            writer.AddCoin(vOnDisk.back(), Coin(CTxOut(i + 1, CScript() << OP_TRUE), 1, false), false);
+        }
+        BOOST_CHECK(writer.Flush());
+    }
+    cache.SpendCoin(vOnDisk[0]);
+
+    // a block spending all of them, an output of its own and a coin that does not exist
+    CBlock block;
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vout.resize(1);
+    block.vtx.push_back(MakeTransactionRef(coinbase));
+    CMutableTransaction tx;
+    for (const COutPoint &outpoint : vOnDisk)
+        tx.vin.push_back(CTxIn(outpoint));
+    tx.vout.resize(1);
+    block.vtx.push_back(MakeTransactionRef(tx));
+    CMutableTransaction child;
+    const COutPoint inBlock(block.vtx[1]->GetHash(), 0);
+    const COutPoint missing(InsecureRand256(), 0);
+    child.vin.push_back(CTxIn(inBlock));
+    child.vin.push_back(CTxIn(missing));
+    block.vtx.push_back(MakeTransactionRef(child));
+
+    PrefetchBlockCoins(block, &cache);
+
+    bool fSpent = false;
+    BOOST_CHECK(cache.HaveCoinInCache(vOnDisk[0], fSpent));
+    BOOST_CHECK(fSpent);
+    for (size_t i = 1; i < vOnDisk.size(); i++)
+    {
+        fSpent = true;
+        BOOST_CHECK(cache.HaveCoinInCache(vOnDisk[i], fSpent));
+        BOOST_CHECK(!fSpent);
+    }
+    BOOST_CHECK(!cache.HaveCoinInCache(inBlock, fSpent));
+    BOOST_CHECK(!cache.HaveCoinInCache(missing, fSpent));
+    cache.SelfTest();
+
+    // loading a coin that is already cached keeps the cached version, and does not count its memory twice
+    BOOST_CHECK(!cache.GetCoinFromDB(vOnDisk[0]));
+    BOOST_CHECK(cache.GetCoinFromDB(vOnDisk[1]));
+    cache.SelfTest();
+}
+
 
 BOOST_AUTO_TEST_SUITE_END()
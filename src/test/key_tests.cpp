@@ -8,6 +8,7 @@
 #include "base58.h"
 #include "dstencode.h"
 #include "script/script.h"
+#include "script/sigcache.h"
 #include "test/test_bitcoin.h"
 #include "uint256.h"
 #include "util.h"
@@ -317,4 +318,84 @@ BOOST_AUTO_TEST_CASE(key_test1)
                                    "6b4b1573c84da49a38405d"));
 }
 
+BOOST_AUTO_TEST_CASE(schnorr_batch_test)
+{
+    const size_t nSigs = 2 * CSchnorrBatch::BATCH_SIZE + 10;
+    std::vector<CPubKey> pubkeys(nSigs);
+    std::vector<uint256> hashes(nSigs);
+    std::vector<std::vector<uint8_t> > vchSigs(nSigs);
+    for (size_t i = 0; i < nSigs; i++)
+    {
+        CKey key;
+        key.MakeNewKey(i % 2 == 0);
+        pubkeys[i] = key.GetPubKey();
+        hashes[i] = InsecureRand256();
+        BOOST_CHECK(key.SignSchnorr(hashes[i], vchSigs[i]));
+    }
+
+    std::vector<const CPubKey *> vpPubKeys;
+    std::vector<const uint256 *> vpHashes;
+    std::vector<const std::vector<uint8_t> *> vpSigs;
+    for (size_t i = 0; i < nSigs; i++)
+    {
+        vpPubKeys.push_back(&pubkeys[i]);
+        vpHashes.push_back(&hashes[i]);
+        vpSigs.push_back(&vchSigs[i]);
+    }
+    BOOST_CHECK(CPubKey::VerifySchnorrBatch(vpPubKeys, vpHashes, vpSigs));
+    BOOST_CHECK(CPubKey::VerifySchnorrBatch({}, {}, {}));
+
+    // a signature of the wrong message, or by the wrong key, fails the batch
+    vpHashes[5] = &hashes[6];
+    BOOST_CHECK(!CPubKey::VerifySchnorrBatch(vpPubKeys, vpHashes, vpSigs));
+    vpHashes[5] = &hashes[5];
+    vpPubKeys[nSigs - 1] = &pubkeys[0];
+    BOOST_CHECK(!CPubKey::VerifySchnorrBatch(vpPubKeys, vpHashes, vpSigs));
+    vpPubKeys[nSigs - 1] = &pubkeys[nSigs - 1];
+
+    // so does one that is not 64 bytes, or vectors of different lengths
+    std::vector<uint8_t> vchShort(vchSigs[0].begin(), vchSigs[0].end() - 1);
+    vpSigs[0] = &vchShort;
+    BOOST_CHECK(!CPubKey::VerifySchnorrBatch(vpPubKeys, vpHashes, vpSigs));
+    vpSigs[0] = &vchSigs[0];
+    vpHashes.pop_back();
+    BOOST_CHECK(!CPubKey::VerifySchnorrBatch(vpPubKeys, vpHashes, vpSigs));
+
+    // the collector verifies full batches as they are added and the rest when flushed
+    {
+        CSchnorrBatch batch;
+        for (size_t i = 0; i < nSigs; i++)
+            BOOST_CHECK(batch.Add(vchSigs[i], pubkeys[i], hashes[i], 0, false));
+        BOOST_CHECK(batch.Flush());
+        BOOST_CHECK(batch.IsValid());
+    }
+
+    // a bad signature in a full batch is reported by the Add that completes it, and by every later call
+    {
+        CSchnorrBatch batch;
+        std::vector<uint8_t> vchBad(vchSigs[3]);
+        vchBad[40] ^= 1;
+        for (size_t i = 0; i < CSchnorrBatch::BATCH_SIZE - 1; i++)
+            BOOST_CHECK(batch.Add(i == 3 ? vchBad : vchSigs[i], pubkeys[i], hashes[i], 0, false));
+        const size_t nLast = CSchnorrBatch::BATCH_SIZE - 1;
+        BOOST_CHECK(!batch.Add(vchSigs[nLast], pubkeys[nLast], hashes[nLast], 0, false));
+        BOOST_CHECK(!batch.IsValid());
+        BOOST_CHECK(!batch.Add(vchSigs[nLast + 1], pubkeys[nLast + 1], hashes[nLast + 1], 0, false));
+        BOOST_CHECK(!batch.Flush());
+    }
+
+    // and a bad signature that is still pending by Flush
+    {
+        CSchnorrBatch batch;
+        std::vector<uint8_t> vchBad(vchSigs[nSigs - 1]);
+        vchBad[0] ^= 1;
+        for (size_t i = 0; i < nSigs - 1; i++)
+            BOOST_CHECK(batch.Add(vchSigs[i], pubkeys[i], hashes[i], 0, false));
+        BOOST_CHECK(batch.Add(vchBad, pubkeys[nSigs - 1], hashes[nSigs - 1], 0, false));
+        BOOST_CHECK(batch.IsValid());
+        BOOST_CHECK(!batch.Flush());
+        BOOST_CHECK(!batch.IsValid());
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -9,6 +9,7 @@
 #include "test/test_bitcoin.h"
 
 #include <boost/test/unit_test.hpp>
+#include <future>
 #include <list>
 #include <vector>
 
@@ -1432,6 +1433,71 @@ BOOST_AUTO_TEST_CASE(MempoolRemoveTest)
     removed.clear();
 }
 
+BOOST_AUTO_TEST_CASE(MempoolTxMapTest)
+{
+    TestMemPoolEntryHelper entry;
+    CMutableTransaction txParent;
+    txParent.vin.resize(1);
+    txParent.vin[0].scriptSig = CScript() << OP_11;
+    txParent.vout.resize(2);
+    for (int i = 0; i < 2; i++)
+    {
+        txParent.vout[i].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        txParent.vout[i].nValue = 33000LL;
+    }
+    CMutableTransaction txChild;
+    txChild.vin.resize(1);
+    txChild.vin[0].scriptSig = CScript() << OP_11;
+    txChild.vin[0].prevout = COutPoint(txParent.GetHash(), 0);
+    txChild.vout.resize(1);
+    txChild.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    txChild.vout[0].nValue = 11000LL;
+
+    CTxMemPool testPool(CFeeRate(0));
+    BOOST_CHECK(!testPool.exists(txParent.GetHash()));
+    BOOST_CHECK(testPool.get(txParent.GetHash()) == nullptr);
+
+    testPool.addUnchecked(txParent.GetHash(), entry.FromTx(txParent));
+    testPool.addUnchecked(txChild.GetHash(), entry.FromTx(txChild));
+    BOOST_CHECK_EQUAL(testPool.txMap.size(), 2U);
+    BOOST_CHECK(testPool.exists(txChild.GetHash()));
+    BOOST_CHECK(testPool.get(txParent.GetHash())->GetHash() == txParent.GetHash());
+    BOOST_CHECK(testPool.exists(COutPoint(txParent.GetHash(), 1)));
+    BOOST_CHECK(!testPool.exists(COutPoint(txParent.GetHash(), 2)));
+    CTxProperties txProps;
+    BOOST_CHECK(testPool.GetTxProperties(txChild.GetHash(), &txProps));
+    BOOST_CHECK_EQUAL(txProps.countWithAncestors, 2U);
+
+    std::vector<uint256> vtxid;
+    testPool.queryHashes(vtxid);
+    std::sort(vtxid.begin(), vtxid.end());
+    std::vector<uint256> vExpected{txParent.GetHash(), txChild.GetHash()};
+    std::sort(vExpected.begin(), vExpected.end());
+    BOOST_CHECK(vtxid == vExpected);
+
+    // Lookups don't wait for a writer that is holding the mempool lock
+    {
+        WRITELOCK(testPool.cs_txmempool);
+        std::future<bool> found =
+            std::async(std::launch::async, [&testPool, &txChild]() { return testPool.exists(txChild.GetHash()); });
+        BOOST_CHECK(found.wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+        BOOST_CHECK(found.get());
+    }
+
+    // Removing the parent takes the child with it
+    std::list<CTransactionRef> removed;
+    testPool.removeRecursive(txParent, removed);
+    BOOST_CHECK_EQUAL(removed.size(), 2);
+    BOOST_CHECK_EQUAL(testPool.txMap.size(), 0U);
+    BOOST_CHECK(!testPool.exists(txChild.GetHash()));
+    BOOST_CHECK(!testPool.GetTxProperties(txChild.GetHash(), &txProps));
+
+    testPool.addUnchecked(txParent.GetHash(), entry.FromTx(txParent));
+    testPool.clear();
+    BOOST_CHECK_EQUAL(testPool.txMap.size(), 0U);
+    BOOST_CHECK(testPool.get(txParent.GetHash()) == nullptr);
+}
+
 template <typename name>
 void CheckSort(CTxMemPool &pool, std::vector<std::string> &sortedOrder)
 {
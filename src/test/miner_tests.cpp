@@ -809,4 +809,100 @@ BOOST_AUTO_TEST_CASE(CreateNewBlock_validity)
     fCheckpointsEnabled = true;
 }
 
+BOOST_AUTO_TEST_CASE(BlockCandidate_follows_mempool)
+{
+    CTxMemPool pool(CFeeRate(0));
+    TestMemPoolEntryHelper entry;
+
+    CBlockCandidate::Settings settings;
+    settings.hashPrevBlock = InsecureRand256();
+    settings.nHeight = 100;
+    settings.nReservedSize = 1000;
+    settings.nBlockMaxSize = 1500;
+    settings.fCPFP = true;
+    settings.fCanonical = true;
+    settings.minRelayFee = CFeeRate(1000);
+
+    auto MakeTx = [](const uint256 &prevHash) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].scriptSig = CScript() << OP_1;
+        tx.vin[0].prevout = COutPoint(prevHash, 0);
+        tx.vout.resize(1);
+        tx.vout[0].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+        tx.vout[0].nValue = 10 * COIN;
+        return tx;
+    };
+
+    std::vector<CBlockCandidateTx> vTx;
+    uint64_t nBlockSize;
+    unsigned int nBlockSigOps;
+    CAmount nFees;
+
+    // nothing to reuse until a selection has been made
+    BOOST_CHECK(!pool.blockCandidate->Get(settings, vTx, nBlockSize, nBlockSigOps, nFees));
+    pool.blockCandidate->Set(settings, {}, settings.nReservedSize, 0, 0, CFeeRate(MAX_MONEY));
+    BOOST_CHECK(pool.blockCandidate->Get(settings, vTx, nBlockSize, nBlockSigOps, nFees));
+    BOOST_CHECK(vTx.empty());
+
+    // a selection made for another tip is not reused
+    CBlockCandidate::Settings otherTip = settings;
+    otherTip.hashPrevBlock = InsecureRand256();
+    BOOST_CHECK(!pool.blockCandidate->Get(otherTip, vTx, nBlockSize, nBlockSigOps, nFees));
+
+    // transactions that fit are appended
+    CMutableTransaction parent = MakeTx(InsecureRand256());
+    CMutableTransaction child = MakeTx(parent.GetHash());
+    pool.addUnchecked(parent.GetHash(), entry.Fee(10000).FromTx(parent));
+    pool.addUnchecked(child.GetHash(), entry.Fee(20000).FromTx(child));
+    BOOST_CHECK(pool.blockCandidate->Get(settings, vTx, nBlockSize, nBlockSigOps, nFees));
+    BOOST_CHECK_EQUAL(vTx.size(), 2U);
+    BOOST_CHECK(vTx[0].ptx->GetHash() == parent.GetHash());
+    BOOST_CHECK(vTx[1].ptx->GetHash() == child.GetHash());
+    BOOST_CHECK_EQUAL(nFees, 30000);
+    BOOST_CHECK_EQUAL(nBlockSize, settings.nReservedSize + ::GetSerializeSize(parent, SER_NETWORK, PROTOCOL_VERSION) +
+                                      ::GetSerializeSize(child, SER_NETWORK, PROTOCOL_VERSION));
+
+    // a transaction below the relay fee leaves the selection as it is
+    CMutableTransaction lowFee = MakeTx(InsecureRand256());
+    pool.addUnchecked(lowFee.GetHash(), entry.Fee(0).FromTx(lowFee));
+    BOOST_CHECK(pool.blockCandidate->Get(settings, vTx, nBlockSize, nBlockSigOps, nFees));
+    BOOST_CHECK_EQUAL(vTx.size(), 2U);
+
+    // and so does removing a transaction that was not selected
+    std::list<CTransactionRef> removed;
+    pool.removeRecursive(lowFee, removed);
+    BOOST_CHECK(pool.blockCandidate->Get(settings, vTx, nBlockSize, nBlockSigOps, nFees));
+
+    // fill the block, then a package that doesn't fit but pays more than the selection invalidates it
+    std::vector<CMutableTransaction> vFill;
+    while (nBlockSize + ::GetSerializeSize(parent, SER_NETWORK, PROTOCOL_VERSION) <= settings.nBlockMaxSize)
+    {
+        vFill.push_back(MakeTx(InsecureRand256()));
+        pool.addUnchecked(vFill.back().GetHash(), entry.Fee(10000).FromTx(vFill.back()));
+        BOOST_CHECK(pool.blockCandidate->Get(settings, vTx, nBlockSize, nBlockSigOps, nFees));
+    }
+    CMutableTransaction cheap = MakeTx(InsecureRand256());
+    pool.addUnchecked(cheap.GetHash(), entry.Fee(5000).FromTx(cheap));
+    BOOST_CHECK(pool.blockCandidate->Get(settings, vTx, nBlockSize, nBlockSigOps, nFees));
+    CMutableTransaction better = MakeTx(InsecureRand256());
+    pool.addUnchecked(better.GetHash(), entry.Fee(50000).FromTx(better));
+    BOOST_CHECK(!pool.blockCandidate->Get(settings, vTx, nBlockSize, nBlockSigOps, nFees));
+
+    // removing a selected transaction invalidates it as well
+    pool.blockCandidate->Set(settings, {}, settings.nReservedSize, 0, 0, CFeeRate(MAX_MONEY));
+    CMutableTransaction selected = MakeTx(InsecureRand256());
+    pool.addUnchecked(selected.GetHash(), entry.Fee(10000).FromTx(selected));
+    BOOST_CHECK(pool.blockCandidate->Get(settings, vTx, nBlockSize, nBlockSigOps, nFees));
+    pool.removeRecursive(selected, removed);
+    BOOST_CHECK(!pool.blockCandidate->Get(settings, vTx, nBlockSize, nBlockSigOps, nFees));
+
+    // without canonical ordering a new transaction could belong anywhere in the block
+    settings.fCanonical = false;
+    pool.blockCandidate->Set(settings, {}, settings.nReservedSize, 0, 0, CFeeRate(MAX_MONEY));
+    CMutableTransaction unordered = MakeTx(InsecureRand256());
+    pool.addUnchecked(unordered.GetHash(), entry.Fee(10000).FromTx(unordered));
+    BOOST_CHECK(!pool.blockCandidate->Get(settings, vTx, nBlockSize, nBlockSigOps, nFees));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -949,4 +949,40 @@ BOOST_AUTO_TEST_CASE(askfor_tests)
     mapBlk = rman_access.GetMapBlkInfo();
     BOOST_CHECK(mapBlk[inv_block.hash].availableFrom.size() == 2); // should add another source
 }
+
+BOOST_AUTO_TEST_CASE(missingtxfetch_tests)
+{
+    uint256 hash = GetRandHash();
+    NodeId announcer = 1;
+    std::set<NodeId> setOtherPeers = {2, 3};
+    NodeId id;
+    CMissingTxFetch fetch;
+
+    // nothing was requested yet
+    BOOST_CHECK(!thinrelay.GetMissingTxFetchAnnouncer(2, hash, id));
+    BOOST_CHECK(!thinrelay.IsMissingTxFetchAnswered(hash));
+    BOOST_CHECK(!thinrelay.ClaimMissingTxFetch(hash, fetch));
+
+    thinrelay.AddMissingTxFetch(announcer, hash, setOtherPeers);
+
+    // only the other peers map back to the announcer
+    BOOST_CHECK(!thinrelay.GetMissingTxFetchAnnouncer(announcer, hash, id));
+    BOOST_CHECK(!thinrelay.GetMissingTxFetchAnnouncer(4, hash, id));
+    BOOST_CHECK(thinrelay.GetMissingTxFetchAnnouncer(3, hash, id));
+    BOOST_CHECK_EQUAL(id, announcer);
+    BOOST_CHECK(!thinrelay.IsMissingTxFetchAnswered(hash));
+
+    // the first response wins and all others are dropped
+    BOOST_CHECK(thinrelay.ClaimMissingTxFetch(hash, fetch));
+    BOOST_CHECK_EQUAL(fetch.announcer, announcer);
+    BOOST_CHECK(fetch.setOtherPeers == setOtherPeers);
+    BOOST_CHECK(thinrelay.IsMissingTxFetchAnswered(hash));
+    BOOST_CHECK(!thinrelay.ClaimMissingTxFetch(hash, fetch));
+
+    // a new request for the same block starts over
+    thinrelay.AddMissingTxFetch(announcer, hash, std::set<NodeId>());
+    BOOST_CHECK(!thinrelay.IsMissingTxFetchAnswered(hash));
+    BOOST_CHECK(!thinrelay.GetMissingTxFetchAnnouncer(3, hash, id));
+    BOOST_CHECK(thinrelay.ClaimMissingTxFetch(hash, fetch));
+}
 BOOST_AUTO_TEST_SUITE_END()
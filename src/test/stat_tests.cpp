@@ -131,4 +131,22 @@ BOOST_AUTO_TEST_CASE(stat_empty_construct)
     }
 }
 
+BOOST_AUTO_TEST_CASE(stat_log2_histogram)
+{
+    CLog2Histogram<4> hist;
+    hist.Add(0);
+    hist.Add(1);
+    hist.Add(2);
+    hist.Add(3);
+    hist.Add(4);
+    hist.Add(1000000); // overflows into the last bucket
+
+    UniValue buckets = hist.ToUniValue();
+    BOOST_CHECK_EQUAL(buckets.size(), 4U);
+    BOOST_CHECK_EQUAL(buckets[0].get_int(), 1);
+    BOOST_CHECK_EQUAL(buckets[1].get_int(), 1);
+    BOOST_CHECK_EQUAL(buckets[2].get_int(), 2);
+    BOOST_CHECK_EQUAL(buckets[3].get_int(), 2);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -72,7 +72,7 @@ TestingSetup::TestingSetup(const std::string &chainName) : BasicTestingSetup(cha
     pblocktree = new CBlockTreeDB(1 << 20, "", true);
     pcoinsdbview = new CCoinsViewDB(1 << 23, true);
     pcoinsTip = new CCoinsViewCache(pcoinsdbview);
-    txCommitQ = new std::map<uint256, CTxCommitData>();
+    txCommitQ = new CTxCommitBatch();
     bool worked = InitBlockIndex(chainparams);
     assert(worked);
 
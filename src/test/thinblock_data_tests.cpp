@@ -125,4 +125,53 @@ BOOST_AUTO_TEST_CASE(test_thinblockdata_stats1)
     }
 }
 
+BOOST_AUTO_TEST_CASE(test_thinblockdata_expire)
+{
+    // two samples in the same minute and one more an hour later, then read back once just before
+    // and once just after the first minute has fallen out of the 24 hour window
+    const int64_t nMinute = 1000 * 60;
+    vector<int64_t> times = {0, 1000, 60 * nMinute, (24 * 60 - 1) * nMinute, 24 * 60 * nMinute};
+
+    TestTBD tbd(times);
+    tbd.UpdateInBoundBloomFilter(1000);
+    tbd.UpdateInBoundBloomFilter(3000);
+    tbd.UpdateInBoundBloomFilter(8000);
+
+    string res = tbd.InBoundBloomFiltersToString();
+    BOOST_CHECK_MESSAGE(res.find("4.00KB") != string::npos, "InBoundBloomFiltersToString() is " << res);
+
+    res = tbd.InBoundBloomFiltersToString();
+    BOOST_CHECK_MESSAGE(res.find("8.00KB") != string::npos, "InBoundBloomFiltersToString() is " << res);
+}
+
+BOOST_AUTO_TEST_CASE(test_rolling_stat_ring)
+{
+    CRollingStatRing<double> ring;
+    const int64_t nMinute = CRollingStatRing<double>::BUCKET_MILLIS;
+
+    BOOST_CHECK_EQUAL(ring.Count(0), 0U);
+    BOOST_CHECK_EQUAL(ring.Average(0), 0.0);
+    BOOST_CHECK_EQUAL(ring.Percentile(0, 0.95), 0.0);
+
+    for (int64_t i : boost::irange(0, 100))
+        ring.Add(i * nMinute, (double)(i + 1));
+
+    BOOST_CHECK_EQUAL(ring.Count(100 * nMinute), 100U);
+    BOOST_CHECK_EQUAL(ring.Average(100 * nMinute), 50.5);
+    BOOST_CHECK_EQUAL(ring.Percentile(100 * nMinute, 0.95), 95.0);
+
+    // the first 50 samples have expired
+    const int64_t nLater = (49 + CRollingStatRing<double>::NUM_BUCKETS) * nMinute + 1;
+    BOOST_CHECK_EQUAL(ring.Count(nLater), 50U);
+    BOOST_CHECK_EQUAL(ring.Sum(nLater), 3775.0);
+
+    // reusing a bucket from an expired minute resets it
+    ring.Add(nLater, 1.0);
+    BOOST_CHECK_EQUAL(ring.Count(nLater), 51U);
+    BOOST_CHECK_EQUAL(ring.Sum(nLater), 3776.0);
+
+    ring.Clear();
+    BOOST_CHECK_EQUAL(ring.Count(nLater), 0U);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
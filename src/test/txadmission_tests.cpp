@@ -0,0 +1,185 @@
+// Copyright (c) 2019 The Bitcoin Unlimited developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "txadmission.h"
+#include "test/test_bitcoin.h"
+#include "txorphanpool.h"
+
+#include <boost/test/unit_test.hpp>
+
+static CTxInputData MakeInputData(const uint256 &prevHash, uint32_t n)
+{
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = COutPoint(prevHash, n);
+    tx.vout.resize(1);
+    tx.vout[0].nValue = n;
+    CTxInputData txd;
+    txd.tx = MakeTransactionRef(tx);
+    return txd;
+}
+
+BOOST_FIXTURE_TEST_SUITE(txadmission_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(txinqueue_routing)
+{
+    CTxInputQueue q;
+    BOOST_CHECK(q.empty());
+
+    // transactions spending the same outpoint always land in the same shard
+    CTxInputData txd1 = MakeInputData(InsecureRand256(), 1);
+    CTxInputData txd2 = MakeInputData(txd1.tx->vin[0].prevout.hash, 1);
+    const size_t nShard = CTxInputQueue::ShardOf(*txd1.tx);
+    BOOST_CHECK_EQUAL(nShard, CTxInputQueue::ShardOf(*txd2.tx));
+
+    q.push(txd1);
+    q.push(txd2);
+    BOOST_CHECK_EQUAL(q.size(), 2U);
+    BOOST_CHECK_EQUAL(q.ShardDepths()[nShard], 2U);
+    BOOST_CHECK_EQUAL(q.MaxShardDepths()[nShard], 2U);
+
+    // and are popped from it in arrival order, without stealing
+    CTxInputData txd;
+    BOOST_CHECK(q.pop(nShard, txd));
+    BOOST_CHECK(txd.tx == txd1.tx);
+    BOOST_CHECK(q.pop(nShard, txd));
+    BOOST_CHECK(txd.tx == txd2.tx);
+    BOOST_CHECK_EQUAL(q.Stolen(), 0U);
+    BOOST_CHECK(!q.pop(nShard, txd));
+    BOOST_CHECK(q.empty());
+    BOOST_CHECK_EQUAL(q.MaxShardDepths()[nShard], 2U);
+}
+
+BOOST_AUTO_TEST_CASE(txinqueue_steal_and_drain)
+{
+    CTxInputQueue q;
+    for (int i = 0; i < 100; i++)
+        q.push(MakeInputData(InsecureRand256(), i));
+    BOOST_CHECK_EQUAL(q.size(), 100U);
+
+    // a thread whose own shard is empty steals from the others
+    CTxInputData txd = MakeInputData(InsecureRand256(), 0);
+    size_t nShard = CTxInputQueue::ShardOf(*txd.tx);
+    while (q.ShardDepths()[nShard] > 0)
+        BOOST_CHECK(q.pop(nShard, txd));
+    uint64_t nStolenBefore = q.Stolen();
+    BOOST_CHECK(q.pop(nShard, txd));
+    BOOST_CHECK_EQUAL(q.Stolen(), nStolenBefore + 1);
+
+    std::queue<CTxInputData> dest;
+    const size_t nLeft = q.size();
+    q.drain(dest);
+    BOOST_CHECK_EQUAL(dest.size(), nLeft);
+    BOOST_CHECK(q.empty());
+    uint64_t nTotal = 0;
+    for (uint64_t nDepth : q.ShardDepths())
+        nTotal += nDepth;
+    BOOST_CHECK_EQUAL(nTotal, 0U);
+}
+
+BOOST_AUTO_TEST_CASE(txcommitbatch)
+{
+    CTxCommitBatch batch;
+    BOOST_CHECK(batch.empty());
+    BOOST_CHECK(batch.find(InsecureRand256()) == nullptr);
+
+    // enough entries to force the index to grow a few times
+    std::vector<uint256> vHashes;
+    for (int i = 0; i < 5000; i++)
+    {
+        CTxCommitData data;
+        data.entry =
+            CTxMemPoolEntry(MakeInputData(InsecureRand256(), i).tx, 0, 0, 0.0, 1, false, 0, false, 1, LockPoints());
+        data.hash = data.entry.GetTx().GetHash();
+        vHashes.push_back(data.hash);
+        BOOST_CHECK(batch.insert(std::move(data)));
+    }
+    BOOST_CHECK_EQUAL(batch.size(), vHashes.size());
+
+    // a second insert of the same hash is refused
+    CTxCommitData dup;
+    dup.hash = vHashes[10];
+    BOOST_CHECK(!batch.insert(std::move(dup)));
+    BOOST_CHECK_EQUAL(batch.size(), vHashes.size());
+
+    // entries are found by hash and iterated in arrival order
+    for (const uint256 &hash : vHashes)
+    {
+        const CTxCommitData *data = batch.find(hash);
+        BOOST_CHECK(data != nullptr && data->hash == hash);
+    }
+    size_t i = 0;
+    for (const CTxCommitData &data : batch)
+        BOOST_CHECK(data.hash == vHashes[i++]);
+
+    // clearing keeps the memory but forgets every entry
+    const size_t nUsage = batch.DynamicMemoryUsage();
+    batch.clear();
+    BOOST_CHECK(batch.empty());
+    BOOST_CHECK_EQUAL(batch.DynamicMemoryUsage(), nUsage);
+    for (const uint256 &hash : vHashes)
+        BOOST_CHECK(!batch.count(hash));
+
+    // and the batch can be refilled
+    CTxCommitData data;
+    data.hash = vHashes[0];
+    BOOST_CHECK(batch.insert(std::move(data)));
+    BOOST_CHECK(batch.count(vHashes[0]));
+    BOOST_CHECK(!batch.count(vHashes[1]));
+}
+
+BOOST_AUTO_TEST_CASE(orphan_work_batches)
+{
+    // three orphans spending outputs of the same parent, and one unrelated orphan
+    const uint256 parent = InsecureRand256();
+    std::vector<CTransactionRef> vOrphans;
+    for (int i = 0; i < 3; i++)
+        vOrphans.push_back(MakeInputData(parent, i).tx);
+    CTransactionRef unrelated = MakeInputData(InsecureRand256(), 0).tx;
+    {
+        WRITELOCK(orphanpool.cs_orphanpool);
+        for (const CTransactionRef &ptx : vOrphans)
+            BOOST_CHECK(orphanpool.AddOrphanTx(ptx, 1));
+        BOOST_CHECK(orphanpool.AddOrphanTx(unrelated, 1));
+    }
+
+    // committing the parent hands it to the admission threads rather than resolving its orphans in place
+    {
+        LOCK(csTxInQ);
+        vOrphanWork.clear(); // left over from blocks connected by earlier tests
+    }
+    std::vector<uint256> vWhatChanged{parent};
+    QueueOrphanWork(vWhatChanged);
+    BOOST_CHECK(vWhatChanged.empty());
+    std::vector<uint256> vBatch;
+    {
+        LOCK(csTxInQ);
+        BOOST_CHECK_EQUAL(vOrphanWork.size(), 1U);
+        vBatch.swap(vOrphanWork);
+    }
+    for (const CTransactionRef &ptx : vOrphans)
+        BOOST_CHECK(orphanpool.AlreadyHaveOrphan(ptx->GetHash()));
+
+    // every child of the parent is removed from the orphan pool and resubmitted
+    const size_t nQueuedBefore = txInQ.size();
+    ProcessOrphans(vBatch);
+    for (const CTransactionRef &ptx : vOrphans)
+        BOOST_CHECK(!orphanpool.AlreadyHaveOrphan(ptx->GetHash()));
+    BOOST_CHECK(orphanpool.AlreadyHaveOrphan(unrelated->GetHash()));
+    {
+        LOCK(csTxInQ);
+        BOOST_CHECK_EQUAL(txInQ.size() + txDeferQ.size(), nQueuedBefore + vOrphans.size());
+
+        std::queue<CTxInputData> dest;
+        txInQ.drain(dest);
+        std::queue<CTxInputData>().swap(txDeferQ);
+        incomingConflicts.reset();
+    }
+    {
+        WRITELOCK(orphanpool.cs_orphanpool);
+        orphanpool.EraseOrphanTx(unrelated->GetHash());
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
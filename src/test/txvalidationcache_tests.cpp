@@ -398,7 +398,7 @@ BOOST_FIXTURE_TEST_CASE(uncache_coins, TestChain100Setup)
     mempool.clear();
     {
         WRITELOCK(orphanpool.cs_orphanpool);
-        orphanpool.mapOrphanTransactions.clear();
+        orphanpool._clear();
     }
     pcoinsTip->Flush();
     SetMockTime(0);
@@ -13,6 +13,7 @@
 #include "dosman.h"
 #include "fastfilter.h"
 #include "init.h"
+#include "memusage.h"
 #include "main.h"
 #include "net.h"
 #include "parallel.h"
@@ -47,18 +48,77 @@ const uint64_t minCommitBatchSize = 10000;
 // avgCommitBatchSize is write protected by csCommitQ and is wrapped in std::atomic for reads.
 std::atomic<uint64_t> avgCommitBatchSize(0);
 
+CLog2Histogram<COMMIT_LOCK_HISTOGRAM_BUCKETS> commitLockTimeHistogram;
+
+// Emptied commit batches that are kept for reuse.  CommitTxToMempool is usually only run by the commit thread but
+// the wallet may also call it, so keep one spare batch per concurrent caller.
+static const size_t MAX_SPARE_COMMIT_BATCHES = 2;
+static std::vector<CTxCommitBatch *> vSpareCommitBatches GUARDED_BY(csCommitQ);
+
 Snapshot txHandlerSnap;
 
 void ThreadCommitToMempool();
-void ProcessOrphans(std::vector<uint256> &vWorkQueue);
+size_t CTxCommitBatch::FindSlot(const uint256 &hash) const
+{
+    const size_t nMask = vIndex.size() - 1;
+    size_t nSlot = hasher(hash) & nMask;
+    while (vIndex[nSlot] != 0 && vEntries[vIndex[nSlot] - 1].hash != hash)
+        nSlot = (nSlot + 1) & nMask;
+    return nSlot;
+}
+
+void CTxCommitBatch::Rehash(size_t nSlots)
+{
+    vIndex.assign(nSlots, 0);
+    for (size_t i = 0; i < vEntries.size(); i++)
+        vIndex[FindSlot(vEntries[i].hash)] = i + 1;
+}
+
+bool CTxCommitBatch::insert(CTxCommitData &&data)
+{
+    if ((vEntries.size() + 1) * 2 > vIndex.size())
+        Rehash(std::max<size_t>(1024, vIndex.size() * 2));
+
+    size_t nSlot = FindSlot(data.hash);
+    if (vIndex[nSlot] != 0)
+        return false;
+    vEntries.push_back(std::move(data));
+    vIndex[nSlot] = vEntries.size();
+    return true;
+}
+
+const CTxCommitData *CTxCommitBatch::find(const uint256 &hash) const
+{
+    if (vEntries.empty())
+        return nullptr;
+    size_t nSlot = FindSlot(hash);
+    if (vIndex[nSlot] == 0)
+        return nullptr;
+    return &vEntries[vIndex[nSlot] - 1];
+}
+
+void CTxCommitBatch::clear()
+{
+    // Only the slots that are in use need to be reset, which is cheaper than clearing the whole index when a
+    // large batch was followed by a small one.  They are reset in reverse insertion order so that the probe
+    // sequence of every remaining entry is still intact when it is looked up.
+    for (auto it = vEntries.rbegin(); it != vEntries.rend(); ++it)
+        vIndex[FindSlot(it->hash)] = 0;
+    vEntries.clear();
+}
+
+size_t CTxCommitBatch::DynamicMemoryUsage() const
+{
+    return memusage::DynamicUsage(vEntries) + memusage::DynamicUsage(vIndex);
+}
 
 CTransactionRef CommitQGet(uint256 hash)
 {
     boost::unique_lock<boost::mutex> lock(csCommitQ);
-    std::map<uint256, CTxCommitData>::iterator it = txCommitQ->find(hash);
-    if (it == txCommitQ->end())
+    const CTxCommitData *data = txCommitQ->find(hash);
+    if (data == nullptr)
         return nullptr;
-    return it->second.entry.GetSharedTx();
+    return data->entry.GetSharedTx();
 }
 
 static inline uint256 IncomingConflictHash(const COutPoint &prevout)
@@ -76,10 +136,81 @@ static inline uint256 IncomingConflictHash(const COutPoint &prevout)
     return hash;
 }
 
+size_t CTxInputQueue::ShardOf(const CTransaction &tx)
+{
+    if (tx.vin.empty())
+        return 0;
+    return IncomingConflictHash(tx.vin[0].prevout).GetCheapHash() % NUM_SHARDS;
+}
+
+void CTxInputQueue::push(const CTxInputData &txd)
+{
+    Shard &shard = shards[ShardOf(*txd.tx)];
+    LOCK(shard.cs);
+    shard.q.push(txd);
+    uint64_t nDepth = ++shard.nDepth;
+    if (nDepth > shard.nMaxDepth.load())
+        shard.nMaxDepth.store(nDepth);
+    nSize++;
+}
+
+bool CTxInputQueue::pop(size_t nShard, CTxInputData &txd)
+{
+    for (size_t i = 0; i < NUM_SHARDS; i++)
+    {
+        Shard &shard = shards[(nShard + i) % NUM_SHARDS];
+        if (shard.nDepth.load() == 0)
+            continue;
+
+        LOCK(shard.cs);
+        if (shard.q.empty())
+            continue;
+        txd = shard.q.front();
+        shard.q.pop();
+        shard.nDepth--;
+        nSize--;
+        if (i != 0)
+            nStolen++;
+        return true;
+    }
+    return false;
+}
+
+void CTxInputQueue::drain(std::queue<CTxInputData> &q)
+{
+    for (Shard &shard : shards)
+    {
+        LOCK(shard.cs);
+        while (!shard.q.empty())
+        {
+            q.push(shard.q.front());
+            shard.q.pop();
+            shard.nDepth--;
+            nSize--;
+        }
+    }
+}
+
+std::vector<uint64_t> CTxInputQueue::ShardDepths() const
+{
+    std::vector<uint64_t> vDepths;
+    for (const Shard &shard : shards)
+        vDepths.push_back(shard.nDepth.load());
+    return vDepths;
+}
+
+std::vector<uint64_t> CTxInputQueue::MaxShardDepths() const
+{
+    std::vector<uint64_t> vDepths;
+    for (const Shard &shard : shards)
+        vDepths.push_back(shard.nMaxDepth.load());
+    return vDepths;
+}
+
 void StartTxAdmission()
 {
     if (txCommitQ == nullptr)
-        txCommitQ = new std::map<uint256, CTxCommitData>();
+        txCommitQ = new CTxCommitBatch();
 
     txHandlerSnap.Load(); // Get an initial view for the transaction processors
 
@@ -109,7 +240,7 @@ void FlushTxAdmission()
         {
             {
                 LOCK(csTxInQ);
-                empty = txInQ.empty() & txDeferQ.empty();
+                empty = txInQ.empty() & txDeferQ.empty() & vOrphanWork.empty();
             }
             if (!empty)
                 MilliSleep(100);
@@ -127,7 +258,7 @@ void FlushTxAdmission()
             CORRAL(txProcessingCorral, CORRAL_TX_PAUSE);
             {
                 LOCK(csTxInQ);
-                empty = txInQ.empty() & txDeferQ.empty();
+                empty = txInQ.empty() & txDeferQ.empty() & vOrphanWork.empty();
             }
             {
                 boost::unique_lock<boost::mutex> lock(csCommitQ);
@@ -198,8 +329,7 @@ unsigned int TxAlreadyHave(const CInv &inv)
             return 2;
         {
             boost::unique_lock<boost::mutex> lock(csCommitQ);
-            const auto &elem = txCommitQ->find(inv.hash);
-            if (elem != txCommitQ->end())
+            if (txCommitQ->count(inv.hash))
             {
                 return 5;
             }
@@ -279,43 +409,103 @@ void CommitTxToMempool()
 {
     // Committing the tx to the mempool takes time.  We can continue to validate non-conflicting tx during this time.
     // To do so, before the transactions are finally commited to the mempool the txCommitQ pointer is copied
-    // to txCommitQFinal so that the lock on txCommitQ can be released and processing can continue.
+    // to txCommitQFinal and replaced by an empty batch so that the lock on txCommitQ can be released and
+    // processing can continue.
     // However, the incomingConflicts detector is not reset until all the transactions are committed to the mempool.
-    std::map<uint256, CTxCommitData> *txCommitQFinal = nullptr;
-
-    std::vector<uint256> vWhatChanged;
+    CTxCommitBatch *txCommitQFinal = nullptr;
     {
-        // We must hold the mempool lock for the duration because we want to be sure that we don't end up
-        // doing this loop in the middle of a reorg where we might be clearing the mempool.
-        WRITELOCK(mempool.cs_txmempool);
+        boost::unique_lock<boost::mutex> lock(csCommitQ);
+        avgCommitBatchSize = (avgCommitBatchSize * 24 + txCommitQ->size()) / 25;
+        txCommitQFinal = txCommitQ;
+        if (vSpareCommitBatches.empty())
+            txCommitQ = new CTxCommitBatch();
+        else
+        {
+            txCommitQ = vSpareCommitBatches.back();
+            vSpareCommitBatches.pop_back();
+        }
+    }
 
+    // The commit is done in two phases so that the mempool write lock, which blocks RPC readers, block template
+    // creation and graphene block reconstruction, is only held while the transactions are published.
+    //
+    // Phase 1: with a read lock, find the in-mempool ancestors of every transaction in the batch.  A transaction
+    // that spends an output of another transaction in the batch is left for phase 2 because its parent is
+    // not in the mempool yet.
+    const uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
+    std::vector<CTxMemPool::setEntries> vAncestors(txCommitQFinal->size());
+    std::vector<bool> vPrepared(txCommitQFinal->size(), false);
+    unsigned int nPreparedGeneration = 0;
+    {
+        READLOCK(mempool.cs_txmempool);
+        nPreparedGeneration = mempool._GetTransactionsUpdated();
+        size_t i = 0;
+        for (const CTxCommitData &data : *txCommitQFinal)
         {
-            boost::unique_lock<boost::mutex> lock(csCommitQ);
-            avgCommitBatchSize = (avgCommitBatchSize * 24 + txCommitQ->size()) / 25;
-            txCommitQFinal = txCommitQ;
-            txCommitQ = new std::map<uint256, CTxCommitData>();
+            const CTransaction &tx = data.entry.GetTx();
+            bool fParentInBatch = false;
+            for (const CTxIn &txin : tx.vin)
+            {
+                if (txCommitQFinal->count(txin.prevout.hash))
+                {
+                    fParentInBatch = true;
+                    break;
+                }
+            }
+            if (!fParentInBatch)
+            {
+                std::string dummy;
+                mempool._CalculateMemPoolAncestors(
+                    data.entry, vAncestors[i], nNoLimit, nNoLimit, nNoLimit, nNoLimit, dummy);
+                vPrepared[i] = true;
+            }
+            i++;
         }
+    }
+
+    // Phase 2: publish.  If anything was added to or removed from the mempool since phase 1 (for example by a
+    // reorg clearing the mempool) the prepared ancestor sets may hold stale entries, so recompute them all.
+    std::vector<uint256> vWhatChanged;
+    {
+        WRITELOCK(mempool.cs_txmempool);
+        const int64_t nLockStart = GetStopwatchMicros();
+        const bool fPreparedValid = (mempool._GetTransactionsUpdated() == nPreparedGeneration);
+        const bool fCurrentEstimate = !IsInitialBlockDownload();
 
         // These transactions have already been validated so store them directly into the mempool.
-        for (auto &it : *txCommitQFinal)
+        size_t i = 0;
+        for (const CTxCommitData &data : *txCommitQFinal)
         {
-            CTxCommitData &data = it.second;
-            mempool._addUnchecked(it.first, data.entry, !IsInitialBlockDownload());
+            if (fPreparedValid && vPrepared[i])
+                mempool.addUnchecked(data.hash, data.entry, vAncestors[i], fCurrentEstimate);
+            else
+                mempool._addUnchecked(data.hash, data.entry, fCurrentEstimate);
             vWhatChanged.push_back(data.hash);
-
-            // Indicate that this tx was fully processed/accepted and can now be removed from the req mgr.
-            requester.Received(CInv(MSG_TX, data.hash), nullptr);
+            i++;
         }
+        commitLockTimeHistogram.Add(GetStopwatchMicros() - nLockStart);
     }
-    for (auto &it : *txCommitQFinal)
-    {
-        CTxCommitData &data = it.second;
+
+    // Indicate that these txs were fully processed/accepted and can now be removed from the req mgr.
+    for (const uint256 &hash : vWhatChanged)
+        requester.Received(CInv(MSG_TX, hash), nullptr);
+
 #ifdef ENABLE_WALLET
+    for (const CTxCommitData &data : *txCommitQFinal)
+    {
         SyncWithWallets(data.entry.GetSharedTx(), nullptr, -1);
-#endif
     }
+#endif
+
+    // Recycle the batch so that its memory is reused by a later commit cycle
     txCommitQFinal->clear();
-    delete txCommitQFinal;
+    {
+        boost::unique_lock<boost::mutex> lock(csCommitQ);
+        if (vSpareCommitBatches.size() < MAX_SPARE_COMMIT_BATCHES)
+            vSpareCommitBatches.push_back(txCommitQFinal);
+        else
+            delete txCommitQFinal;
+    }
 
     std::map<uint256, CTxInputData> mapWasDeferred;
     {
@@ -324,11 +514,7 @@ void CommitTxToMempool()
         // deferred
         LOG(MEMPOOL, "txadmission incoming filter reset.  Current txInQ size: %d\n", txInQ.size());
         incomingConflicts.reset();
-        while (!txInQ.empty())
-        {
-            txDeferQ.push(txInQ.front());
-            txInQ.pop();
-        }
+        txInQ.drain(txDeferQ);
         // If the chain is now syncd and there are txns in the wait queue then add these also to the deferred queue.
         // The wait queue is not very active and it will typically have just 1 or 2 txns in it, if any at all.
         while (IsChainSyncd() && !txWaitNextBlockQ.empty())
@@ -384,7 +570,7 @@ void CommitTxToMempool()
             TestConflictEnqueueTx(it.second);
         }
     }
-    ProcessOrphans(vWhatChanged);
+    QueueOrphanWork(vWhatChanged);
 }
 
 void ThreadTxAdmission()
@@ -392,6 +578,10 @@ void ThreadTxAdmission()
     // Process at most this many transactions before letting the commit thread take over
     const int maxTxPerRound = 200;
 
+    // Each admission thread owns one shard of the input queue, and steals from the others when it is empty
+    static std::atomic<size_t> nNextShard{0};
+    const size_t nShard = nNextShard++ % CTxInputQueue::NUM_SHARDS;
+
     while (shutdown_threads.load() == false)
     {
         // Start or Stop threads as determined by the numTxAdmissionThreads tweak
@@ -430,7 +620,7 @@ void ThreadTxAdmission()
 
         {
             CCriticalBlock lock(csTxInQ, "csTxInQ", __FILE__, __LINE__, LockType::RECURSIVE_MUTEX);
-            while (txInQ.empty() && shutdown_threads.load() == false)
+            while (txInQ.empty() && vOrphanWork.empty() && shutdown_threads.load() == false)
             {
                 if (shutdown_threads.load() == true)
                 {
@@ -447,23 +637,29 @@ void ThreadTxAdmission()
         {
             CORRAL(txProcessingCorral, CORRAL_TX_PROCESSING);
 
+            // Resubmit the orphans of recently committed transactions.  This is done by the admission threads
+            // rather than by the commit thread so that a large set of newly unorphaned transactions is resolved
+            // in parallel, a batch per thread, without holding up the next commit.
+            std::vector<uint256> vOrphanBatch;
+            {
+                LOCK(csTxInQ);
+                const size_t nTake = std::min(vOrphanWork.size(), ORPHAN_WORK_BATCH_SIZE);
+                vOrphanBatch.assign(vOrphanWork.end() - nTake, vOrphanWork.end());
+                vOrphanWork.resize(vOrphanWork.size() - nTake);
+            }
+            if (!vOrphanBatch.empty())
+                ProcessOrphans(vOrphanBatch);
+
             for (unsigned int txPerRoundCount = 0; txPerRoundCount < maxTxPerRound; txPerRoundCount++)
             {
                 // tx must be popped within the TX_PROCESSING corral or the state break between processing
                 // and commitment will not be clean
+                if (!txInQ.pop(nShard, txd))
                 {
-                    CCriticalBlock lock(csTxInQ, "csTxInQ", __FILE__, __LINE__, LockType::RECURSIVE_MUTEX);
-                    if (txInQ.empty())
-                    {
-                        // speed up tx chunk processing when there is nothing else to do
-                        if (acceptedSomething)
-                            cvCommitQ.notify_all();
-                        break;
-                    }
-
-                    // Make a copy so we can pop and release
-                    txd = txInQ.front();
-                    txInQ.pop();
+                    // speed up tx chunk processing when there is nothing else to do
+                    if (acceptedSomething)
+                        cvCommitQ.notify_all();
+                    break;
                 }
 
                 CTransactionRef tx = txd.tx;
@@ -1331,7 +1527,7 @@ bool ParallelAcceptToMemoryPool(Snapshot &ss,
             eData.hash = hash;
 
             boost::unique_lock<boost::mutex> lock(csCommitQ);
-            (*txCommitQ).emplace(eData.hash, eData);
+            txCommitQ->insert(std::move(eData));
         }
     }
     uint64_t interval = (GetStopwatch() - start) / 1000;
@@ -1371,6 +1567,21 @@ TransactionClass ParseTransactionClass(const std::string &s)
 }
 
 
+void QueueOrphanWork(std::vector<uint256> &vWhatChanged)
+{
+    if (vWhatChanged.empty())
+        return;
+    {
+        LOCK(csTxInQ);
+        if (vOrphanWork.empty())
+            vOrphanWork.swap(vWhatChanged);
+        else
+            vOrphanWork.insert(vOrphanWork.end(), vWhatChanged.begin(), vWhatChanged.end());
+    }
+    vWhatChanged.clear();
+    cvTxInQ.notify_all();
+}
+
 void ProcessOrphans(std::vector<uint256> &vWorkQueue)
 {
     // Recursively process any orphan transactions that depended on this one.
@@ -1380,8 +1591,7 @@ void ProcessOrphans(std::vector<uint256> &vWorkQueue)
         READLOCK(orphanpool.cs_orphanpool);
         for (unsigned int i = 0; i < vWorkQueue.size(); i++)
         {
-            std::map<uint256, std::set<uint256> >::iterator itByPrev =
-                orphanpool.mapOrphanTransactionsByPrev.find(vWorkQueue[i]);
+            auto itByPrev = orphanpool.mapOrphanTransactionsByPrev.find(vWorkQueue[i]);
             if (itByPrev == orphanpool.mapOrphanTransactionsByPrev.end())
                 continue;
             for (std::set<uint256>::iterator mi = itByPrev->second.begin(); mi != itByPrev->second.end(); ++mi)
@@ -1392,16 +1602,15 @@ void ProcessOrphans(std::vector<uint256> &vWorkQueue)
                 // we always erase orphans and any mapOrphanTransactionsByPrev at the same time, still we need to
                 // be sure.
                 bool fOk = true;
-                std::map<uint256, CTxOrphanPool::COrphanTx>::iterator iter =
-                    orphanpool.mapOrphanTransactions.find(orphanHash);
+                CTxOrphanPool::indexed_orphan_set::iterator iter = orphanpool.mapOrphanTransactions.find(orphanHash);
                 DbgAssert(iter != orphanpool.mapOrphanTransactions.end(), fOk = false);
                 if (!fOk)
                     continue;
 
                 {
                     CTxInputData txd;
-                    txd.tx = iter->second.ptx;
-                    txd.nodeId = iter->second.fromPeer;
+                    txd.tx = iter->ptx;
+                    txd.nodeId = iter->fromPeer;
                     txd.nodeName = "orphan";
                     LOG(MEMPOOL, "Resubmitting orphan tx: %s\n", orphanHash.ToString());
                     mapEnqueue.emplace(std::move(orphanHash), std::move(txd));
@@ -1414,12 +1623,14 @@ void ProcessOrphans(std::vector<uint256> &vWorkQueue)
     // in the queue twice.
     {
         WRITELOCK(orphanpool.cs_orphanpool);
-        for (auto it = mapEnqueue.begin(); it != mapEnqueue.end(); it++)
+        for (auto it = mapEnqueue.begin(); it != mapEnqueue.end();)
         {
             // If the orphan was not erased then it must already have been erased/enqueued by another thread
             // so do not enqueue this orphan again.
             if (!orphanpool.EraseOrphanTx(it->first))
                 it = mapEnqueue.erase(it);
+            else
+                ++it;
         }
         orphanpool.EraseOrphansByTime();
     }
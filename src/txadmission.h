@@ -8,9 +8,11 @@
 #include "fastfilter.h"
 #include "main.h"
 #include "net.h"
+#include "stat.h"
 #include "threadgroup.h"
 #include "txdebugger.h"
 #include "txmempool.h"
+#include <atomic>
 #include <queue>
 
 /** The default value for -minrelaytxfee in sat/byte */
@@ -97,6 +99,47 @@ public:
     uint256 hash;
 };
 
+/** A batch of validated transactions waiting to be committed to the mempool.
+ *
+ * Entries are appended to a vector in arrival order and looked up by txid through an open addressing index.
+ * clear() keeps the allocated capacity so that batches can be recycled from one commit cycle to the next
+ * rather than being freed and reallocated at every cycle.
+ */
+class CTxCommitBatch
+{
+protected:
+    std::vector<CTxCommitData> vEntries;
+    // Each slot holds 1 + the position of an entry in vEntries, or 0 if empty.  The size is a power of 2
+    // and is kept at least twice the number of entries so that probe sequences stay short.
+    std::vector<uint32_t> vIndex;
+    SaltedTxidHasher hasher;
+
+    size_t FindSlot(const uint256 &hash) const;
+    void Rehash(size_t nSlots);
+
+public:
+    typedef std::vector<CTxCommitData>::iterator iterator;
+    typedef std::vector<CTxCommitData>::const_iterator const_iterator;
+
+    /** Append a transaction to the batch.  Returns false if a transaction with this hash is already present */
+    bool insert(CTxCommitData &&data);
+    /** Returns the entry with this hash, or nullptr if it is not in the batch */
+    const CTxCommitData *find(const uint256 &hash) const;
+    size_t count(const uint256 &hash) const { return find(hash) != nullptr; }
+
+    size_t size() const { return vEntries.size(); }
+    bool empty() const { return vEntries.empty(); }
+    /** Remove all entries but keep the allocated memory for reuse */
+    void clear();
+    /** Memory currently allocated by the batch, including unused capacity */
+    size_t DynamicMemoryUsage() const;
+
+    iterator begin() { return vEntries.begin(); }
+    iterator end() { return vEntries.end(); }
+    const_iterator begin() const { return vEntries.begin(); }
+    const_iterator end() const { return vEntries.end(); }
+};
+
 /** Communicate what class of transaction is acceptable to add to the memory pool
  */
 enum class TransactionClass
@@ -133,11 +176,61 @@ extern CRollingFastFilter<4 * 1024 * 1024> txRecentlyInBlock;
 // Finds transactions that may conflict with other pending transactions
 extern CFastFilter<4 * 1024 * 1024> incomingConflicts;
 
+/**
+ * Transactions that are waiting for validation, split into shards so that the admission threads popping
+ * transactions do not all contend on one lock.
+ *
+ * A transaction is routed to a shard by the hash of its first spent outpoint, so transactions that spend the same
+ * coin (the likely double spends) land in the same shard and are seen in arrival order by the same thread.  Each
+ * admission thread drains its own shard first and steals from the other shards when its shard is empty.
+ *
+ * Each shard has its own lock.  Pushes are still made while holding csTxInQ because the incomingConflicts filter
+ * decides whether a transaction goes onto this queue or onto txDeferQ.
+ */
+class CTxInputQueue
+{
+public:
+    static const size_t NUM_SHARDS = 16;
+
+private:
+    struct Shard
+    {
+        CCriticalSection cs;
+        std::queue<CTxInputData> q GUARDED_BY(cs);
+        //! Current depth, readable without taking the lock
+        std::atomic<uint64_t> nDepth{0};
+        //! Highest depth reached since startup
+        std::atomic<uint64_t> nMaxDepth{0};
+    };
+    Shard shards[NUM_SHARDS];
+    std::atomic<uint64_t> nSize{0};
+    std::atomic<uint64_t> nStolen{0};
+
+public:
+    /** Return the shard that a transaction is routed to */
+    static size_t ShardOf(const CTransaction &tx);
+
+    void push(const CTxInputData &txd);
+    /** Pop the next transaction from shard nShard, or steal one from another shard if it is empty */
+    bool pop(size_t nShard, CTxInputData &txd);
+    /** Move every queued transaction onto the back of q */
+    void drain(std::queue<CTxInputData> &q);
+
+    bool empty() const { return nSize.load() == 0; }
+    size_t size() const { return nSize.load(); }
+    /** Current depth of each shard */
+    std::vector<uint64_t> ShardDepths() const;
+    /** Highest depth each shard has reached */
+    std::vector<uint64_t> MaxShardDepths() const;
+    /** Number of transactions that were popped by a thread other than the one that owns their shard */
+    uint64_t Stolen() const { return nStolen.load(); }
+};
+
 // Transactions that are available to be added to the mempool, and protection
-// Guarded by csTxInQ
+// csTxInQ guards the incomingConflicts filter and the defer queues, and is used with cvTxInQ to wait for txInQ
 extern CCriticalSection csTxInQ;
 extern CCond cvTxInQ;
-extern std::queue<CTxInputData> txInQ;
+extern CTxInputQueue txInQ;
 
 // Transactions that cannot be processed in this round (may potentially conflict with other tx)
 // Guarded by csTxInQ
@@ -149,10 +242,21 @@ extern std::queue<CTxInputData> txDeferQ;
 // Guarded by csTxInQ
 extern std::queue<CTxInputData> txWaitNextBlockQ;
 
+// Hashes of transactions that were just committed to the mempool or mined, whose orphan children have not yet been
+// resubmitted.  The admission threads take these in batches of ORPHAN_WORK_BATCH_SIZE.
+// Guarded by csTxInQ
+extern std::vector<uint256> vOrphanWork;
+static const size_t ORPHAN_WORK_BATCH_SIZE = 1000;
+
 // Transactions that are validated and can be committed to the mempool, and protection
 extern CWaitableCriticalSection csCommitQ;
 extern CConditionVariable cvCommitQ;
-extern std::map<uint256, CTxCommitData> *txCommitQ;
+extern CTxCommitBatch *txCommitQ;
+
+// How long CommitTxToMempool held the mempool write lock, in microseconds.  Bucket i counts hold times
+// shorter than 2^i us.
+static const int COMMIT_LOCK_HISTOGRAM_BUCKETS = 24;
+extern CLog2Histogram<COMMIT_LOCK_HISTOGRAM_BUCKETS> commitLockTimeHistogram;
 
 // returns a transaction ref, if it exists in the commitQ
 CTransactionRef CommitQGet(uint256 hash);
@@ -167,6 +271,14 @@ void FlushTxAdmission();
 /// Put the tx on the tx admission queue for processing
 void EnqueueTxForAdmission(CTxInputData &txd);
 
+/** Hand the hashes of newly committed or mined transactions to the admission threads so that any orphans that
+ *  spend them are resubmitted.  vWhatChanged is left empty. */
+void QueueOrphanWork(std::vector<uint256> &vWhatChanged);
+
+/** Remove from the orphan pool and enqueue for admission every orphan that spends an output of one of the
+ *  transactions in vWorkQueue. */
+void ProcessOrphans(std::vector<uint256> &vWorkQueue);
+
 /** (try to) add transaction to memory pool **/
 bool AcceptToMemoryPool(CTxMemPool &pool,
     CValidationState &state,
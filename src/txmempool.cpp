@@ -15,6 +15,7 @@
 #include "core_io.h"
 #include "init.h"
 #include "main.h"
+#include "miner.h"
 #include "parallel.h"
 #include "policy/fees.h"
 #include "streams.h"
@@ -30,8 +31,8 @@
 
 using namespace std;
 CTxMemPoolEntry::CTxMemPoolEntry()
-    : tx(), nFee(), nTime(0), entryPriority(0), entryHeight(0), hadNoDependencies(0), inChainInputValue(0),
-      spendsCoinbase(false), sigOpCount(0), lockPoints()
+    : txid(), nFee(), nTime(0), nTxSize(0), tx(), entryPriority(0), entryHeight(0), hadNoDependencies(0),
+      inChainInputValue(0), spendsCoinbase(false), sigOpCount(0), lockPoints()
 {
     nModSize = 0;
     nUsageSize = 0;
@@ -50,9 +51,9 @@ CTxMemPoolEntry::CTxMemPoolEntry(const CTransactionRef _tx,
     bool _spendsCoinbase,
     unsigned int _sigOps,
     LockPoints lp)
-    : tx(_tx), nFee(_nFee), nTime(_nTime), entryPriority(_entryPriority), entryHeight(_entryHeight),
-      hadNoDependencies(poolHasNoInputsOf), inChainInputValue(_inChainInputValue), spendsCoinbase(_spendsCoinbase),
-      sigOpCount(_sigOps), lockPoints(lp)
+    : txid(_tx->GetHash()), nFee(_nFee), nTime(_nTime), nTxSize(_tx->GetTxSize()), tx(_tx),
+      entryPriority(_entryPriority), entryHeight(_entryHeight), hadNoDependencies(poolHasNoInputsOf),
+      inChainInputValue(_inChainInputValue), spendsCoinbase(_spendsCoinbase), sigOpCount(_sigOps), lockPoints(lp)
 {
     nModSize = tx->CalculateModifiedSize(tx->GetTxSize());
     nUsageSize = RecursiveDynamicUsage(*tx);
@@ -183,11 +184,13 @@ void CTxMemPool::UpdateTransactionsFromBlock(const std::vector<uint256> &vHashes
         {
             continue;
         }
-        std::map<COutPoint, CInPoint>::iterator iter = mapNextTx.lower_bound(COutPoint(hash, 0));
         // First calculate the children, and update setMemPoolChildren to
         // include them, and update their setMemPoolParents to include this tx.
-        for (; iter != mapNextTx.end() && iter->first.hash == hash; ++iter)
+        for (uint32_t n = 0; n < it->GetTx().vout.size(); n++)
         {
+            auto iter = mapNextTx.find(COutPoint(hash, n));
+            if (iter == mapNextTx.end())
+                continue;
             const uint256 &childHash = iter->second.ptx->GetHash();
             txiter childIter = mapTx.find(childHash);
             assert(childIter != mapTx.end());
@@ -504,6 +507,15 @@ void CTxMemPool::UpdateTxnChainState(mapEntryHistory &mapTxnChainTips)
 
     for (auto iter_tip : mapTxnChainTips)
     {
+        // Most chaintips had all of their parents mined, which leaves them as their only ancestor.
+        if (GetMemPoolParents(iter_tip.first).empty())
+        {
+            mapTx.modify(iter_tip.first,
+                replace_ancestor_state(iter_tip.first->GetTxSize(), iter_tip.first->GetModifiedFee(), 1,
+                             iter_tip.first->GetSigOpCount()));
+            continue;
+        }
+
         uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
         std::string dummy;
         int64_t nAncestorCount = 0;
@@ -535,6 +547,10 @@ void CTxMemPool::UpdateTxnChainState(mapEntryHistory &mapTxnChainTips)
         int nAncestorSigOpsDiff = iter_tip.first->GetSigOpCountWithAncestors() - iter_tip.second.modifySigOps;
         CAmount nAncestorModifiedFeeDiff = iter_tip.first->GetModFeesWithAncestors() - iter_tip.second.modifyFee;
 
+        // There is nothing to apply to a chaintip without children
+        if (GetMemPoolChildren(iter_tip.first).empty())
+            continue;
+
         // Get descendants but stop looking if/when we find another txnchaintip in the descendant tree.
         setEntries setDescendants;
         _CalculateDescendants(iter_tip.first, setDescendants, &mapTxnChainTips);
@@ -674,7 +690,7 @@ void CTxMemPoolEntry::ReplaceAncestorState(int64_t modifySize, CAmount modifyFee
 }
 
 CTxMemPool::CTxMemPool(const CFeeRate &_minReasonableRelayFee)
-    : nTransactionsUpdated(0), m_dspStorage(new DoubleSpendProofStorage())
+    : nTransactionsUpdated(0), blockCandidate(new CBlockCandidate()), m_dspStorage(new DoubleSpendProofStorage())
 {
     _clear(); // lock free clear
 
@@ -695,7 +711,12 @@ CTxMemPool::CTxMemPool(const CFeeRate &_minReasonableRelayFee)
     nPeakRate = 0;
 }
 
-CTxMemPool::~CTxMemPool() { delete minerPolicyEstimator; }
+CTxMemPool::~CTxMemPool()
+{
+    delete minerPolicyEstimator;
+    delete blockCandidate;
+}
+
 bool CTxMemPool::isSpent(const COutPoint &outpoint)
 {
     AssertWriteLockHeld(cs_txmempool);
@@ -729,6 +750,7 @@ bool CTxMemPool::addUnchecked(const uint256 &hash,
     }
     indexed_transaction_set::iterator newit = mapTx.insert(entry).first;
     mapLinks.insert(make_pair(newit, TxLinks()));
+    txMap.insert(newit->GetSharedTx());
 
     // Update transaction for any feeDelta created by PrioritiseTransaction
     // TODO: refactor so that the fee delta is calculated before inserting
@@ -780,6 +802,7 @@ bool CTxMemPool::addUnchecked(const uint256 &hash,
     txAdded += 1; // BU
     poolSize() = totalTxSize; // BU
     minerPolicyEstimator->processTransaction(entry, fCurrentEstimate);
+    blockCandidate->TxAdded(newit, setAncestors);
 
     return true;
 }
@@ -795,11 +818,18 @@ void CTxMemPool::removeUnchecked(txiter it)
 
     totalTxSize -= it->GetTxSize();
     cachedInnerUsage -= it->DynamicMemoryUsage();
-    cachedInnerUsage -= memusage::DynamicUsage(mapLinks[it].parents) + memusage::DynamicUsage(mapLinks[it].children);
-    mapLinks.erase(it);
+    txlinksMap::iterator linksit = mapLinks.find(it);
+    if (linksit != mapLinks.end())
+    {
+        cachedInnerUsage -=
+            memusage::DynamicUsage(linksit->second.parents) + memusage::DynamicUsage(linksit->second.children);
+        mapLinks.erase(linksit);
+    }
+    txMap.erase(hash);
     mapTx.erase(it);
     nTransactionsUpdated++;
     minerPolicyEstimator->removeTx(hash);
+    blockCandidate->TxRemoved(hash);
 }
 
 // Calculates descendants of entry that are not already in setDescendants, and adds to
@@ -852,10 +882,10 @@ void CTxMemPool::ResubmitCommitQ()
     // Clear txCommitQ
     {
         boost::unique_lock<boost::mutex> lock(csCommitQ);
-        for (auto &kv : *txCommitQ)
+        for (const CTxCommitData &data : *txCommitQ)
         {
             CTxInputData txd;
-            txd.tx = kv.second.entry.GetSharedTx();
+            txd.tx = data.entry.GetSharedTx();
             txd.nodeName = "rollback";
             EnqueueTxForAdmission(txd);
         }
@@ -882,7 +912,7 @@ void CTxMemPool::_removeRecursive(const CTransaction &origTx, std::list<CTransac
         // the mempool for any reason.
         for (unsigned int i = 0; i < origTx.vout.size(); i++)
         {
-            std::map<COutPoint, CInPoint>::iterator it = mapNextTx.find(COutPoint(origTx.GetHash(), i));
+            auto it = mapNextTx.find(COutPoint(origTx.GetHash(), i));
             if (it == mapNextTx.end())
                 continue;
             txiter nextit = mapTx.find(it->second.ptx->GetHash());
@@ -964,7 +994,7 @@ void CTxMemPool::_removeConflicts(const CTransaction &tx, std::list<CTransaction
     // Remove transactions which depend on inputs of tx, recursively
     for (const CTxIn &txin : tx.vin)
     {
-        std::map<COutPoint, CInPoint>::iterator it = mapNextTx.find(txin.prevout);
+        auto it = mapNextTx.find(txin.prevout);
         if (it != mapNextTx.end())
         {
             const CTransaction &txConflict = *it->second.ptx;
@@ -978,6 +1008,57 @@ void CTxMemPool::_removeConflicts(const CTransaction &tx, std::list<CTransaction
 }
 
 
+/** Blocks are classified against the mempool on several threads once each thread would get this many txns */
+static const size_t BLOCK_CLASSIFY_TXS_PER_THREAD = 2000;
+
+// Find the mempool entry for every txn in the block, and the txids of the mempool txns that spend the same
+// inputs as a block txn that is not in the mempool. Only lookups are made, so the block is split into ranges
+// which are classified concurrently while the caller holds the mempool write lock.
+static void ClassifyBlockTxs(CTxMemPool &pool,
+    const std::vector<CTransactionRef> &vtx,
+    std::vector<CTxMemPool::txiter> &vInPool,
+    std::vector<uint256> &vConflicts)
+{
+    auto classify = [&pool, &vtx, &vInPool](size_t nBegin, size_t nEnd, std::vector<uint256> &vFound) {
+        for (size_t i = nBegin; i < nEnd; i++)
+        {
+            const CTransaction &tx = *vtx[i];
+            vInPool[i] = pool.mapTx.find(tx.GetHash());
+            if (vInPool[i] != pool.mapTx.end())
+                continue; // every input of a mempool txn is spent by the txn itself
+            for (const CTxIn &txin : tx.vin)
+            {
+                auto it = pool.mapNextTx.find(txin.prevout);
+                if (it != pool.mapNextTx.end())
+                    vFound.push_back(it->second.ptx->GetHash());
+            }
+        }
+    };
+
+    vInPool.assign(vtx.size(), pool.mapTx.end());
+    const size_t nThreads =
+        std::max<size_t>(1, std::min<size_t>(GetNumCores(), vtx.size() / BLOCK_CLASSIFY_TXS_PER_THREAD));
+    if (nThreads == 1)
+    {
+        classify(0, vtx.size(), vConflicts);
+        return;
+    }
+
+    std::vector<std::vector<uint256> > vThreadConflicts(nThreads);
+    std::vector<std::thread> threads;
+    const size_t nPerThread = (vtx.size() + nThreads - 1) / nThreads;
+    for (size_t t = 1; t < nThreads; t++)
+    {
+        threads.emplace_back(classify, t * nPerThread, std::min(vtx.size(), (t + 1) * nPerThread),
+            std::ref(vThreadConflicts[t]));
+    }
+    classify(0, nPerThread, vThreadConflicts[0]);
+    for (std::thread &thread : threads)
+        thread.join();
+    for (const std::vector<uint256> &vFound : vThreadConflicts)
+        vConflicts.insert(vConflicts.end(), vFound.begin(), vFound.end());
+}
+
 // transactions need to be removed from the mempool in ancestor-first order so that
 // descendant/ancestor counts remain correct.  This is accomplished by looking at the
 // data in mapLinks and only removing transactions with no ancestors.
@@ -991,6 +1072,13 @@ void CTxMemPool::removeForBlock(const std::vector<CTransactionRef> &vtx,
     std::vector<CTxChange> *txChanges)
 {
     WRITELOCK(cs_txmempool);
+    // The next template is on a new tip and will be assembled from scratch
+    blockCandidate->Invalidate();
+
+    // Look up the whole block before changing anything, so that the removals below are applied in one pass.
+    std::vector<txiter> vInPool;
+    std::vector<uint256> vConflicts;
+    ClassifyBlockTxs(*this, vtx, vInPool, vConflicts);
 
     // Process the block for transasction removal and ancestor state updates.
     // As a first step remove all the txns that are in the block from the mempool by
@@ -1003,10 +1091,8 @@ void CTxMemPool::removeForBlock(const std::vector<CTransactionRef> &vtx,
     setEntries setAncestorsFromBlock;
     {
         setEntries setTxnsInBlock;
-        for (const auto &tx : vtx)
+        for (txiter it : vInPool)
         {
-            uint256 hash = tx->GetHash();
-            txiter it = mapTx.find(hash);
             if (it == mapTx.end())
             {
                 continue;
@@ -1015,13 +1101,15 @@ void CTxMemPool::removeForBlock(const std::vector<CTransactionRef> &vtx,
             // Get all ancestors from related to txns in the block. Stop looking if we've already looked up
             // this set of ancestors before; we don't want to be traversing the same part of the ancestor
             // tree more than once.
-            setEntries setAncestors;
-            uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
-            std::string dummy;
-            _CalculateMemPoolAncestors(
-                *it, setAncestors, nNoLimit, nNoLimit, nNoLimit, nNoLimit, dummy, &setAncestorsFromBlock, false);
-
-            setAncestorsFromBlock.insert(setAncestors.begin(), setAncestors.end());
+            if (!GetMemPoolParents(it).empty())
+            {
+                setEntries setAncestors;
+                uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
+                std::string dummy;
+                _CalculateMemPoolAncestors(
+                    *it, setAncestors, nNoLimit, nNoLimit, nNoLimit, nNoLimit, dummy, &setAncestorsFromBlock, false);
+                setAncestorsFromBlock.insert(setAncestors.begin(), setAncestors.end());
+            }
             setTxnsInBlock.insert(it);
 
             const setEntries &setMemPoolChildren = GetMemPoolChildren(it);
@@ -1107,11 +1195,26 @@ void CTxMemPool::removeForBlock(const std::vector<CTransactionRef> &vtx,
         });
     }
 
-    // Remove conflicting tx
-    for (const auto &tx : vtx)
+    // Remove conflicting tx, and all of their descendants, as one staged removal
+    setEntries setConflicts;
+    for (const uint256 &hash : vConflicts)
     {
-        _removeConflicts(*tx, conflicts);
-        _ClearPrioritisation(tx->GetHash());
+        txiter it = mapTx.find(hash);
+        if (it != mapTx.end())
+            _CalculateDescendants(it, setConflicts);
+    }
+    for (txiter it : setConflicts)
+    {
+        conflicts.push_back(it->GetSharedTx());
+    }
+    _RemoveStaged(setConflicts, false);
+
+    if (!mapDeltas.empty())
+    {
+        for (const uint256 &hash : vConflicts)
+            _ClearPrioritisation(hash);
+        for (const auto &tx : vtx)
+            _ClearPrioritisation(tx->GetHash());
     }
 
     // With the cs_txmepool lock on, resubmit the txCommitQ so we don't allow txns back into
@@ -1240,6 +1343,7 @@ void CTxMemPool::_clear()
 {
     mapLinks.clear();
     mapTx.clear();
+    txMap.clear();
     mapNextTx.clear();
     totalTxSize = 0;
     cachedInnerUsage = 0;
@@ -1247,6 +1351,7 @@ void CTxMemPool::_clear()
     blockSinceLastRollingFeeBump = false;
     rollingMinimumFeeRate = 0;
     ++nTransactionsUpdated;
+    blockCandidate->Invalidate();
 }
 
 void CTxMemPool::clear()
@@ -1314,7 +1419,7 @@ void CTxMemPool::check(const CCoinsViewCache *pcoins) const
                 assert(pcoins->HaveCoin(txin.prevout));
             }
             // Check whether its inputs are marked in mapNextTx.
-            std::map<COutPoint, CInPoint>::const_iterator it3 = mapNextTx.find(txin.prevout);
+            auto it3 = mapNextTx.find(txin.prevout);
             assert(it3 != mapNextTx.end());
             assert(it3->second.ptx == &tx);
             assert(it3->second.n == i);
@@ -1345,10 +1450,12 @@ void CTxMemPool::check(const CCoinsViewCache *pcoins) const
 
         // Check children against mapNextTx
         CTxMemPool::setEntries setChildrenCheck;
-        std::map<COutPoint, CInPoint>::const_iterator iter = mapNextTx.lower_bound(COutPoint(it->GetTx().GetHash(), 0));
         uint64_t childSizes = 0;
-        for (; iter != mapNextTx.end() && iter->first.hash == it->GetTx().GetHash(); ++iter)
+        for (uint32_t n = 0; n < it->GetTx().vout.size(); n++)
         {
+            auto iter = mapNextTx.find(COutPoint(it->GetTxHash(), n));
+            if (iter == mapNextTx.end())
+                continue;
             txiter childit = mapTx.find(iter->second.ptx->GetHash());
             assert(childit != mapTx.end()); // mapNextTx points to in-mempool transactions
             if (setChildrenCheck.insert(childit).second)
@@ -1393,7 +1500,7 @@ void CTxMemPool::check(const CCoinsViewCache *pcoins) const
             stepsSinceLastRemove = 0;
         }
     }
-    for (std::map<COutPoint, CInPoint>::const_iterator it = mapNextTx.begin(); it != mapNextTx.end(); it++)
+    for (auto it = mapNextTx.begin(); it != mapNextTx.end(); it++)
     {
         uint256 hash = it->second.ptx->GetHash();
         indexed_transaction_set::const_iterator it2 = mapTx.find(hash);
@@ -1408,11 +1515,7 @@ void CTxMemPool::check(const CCoinsViewCache *pcoins) const
     assert(innerUsage == cachedInnerUsage);
 }
 
-void CTxMemPool::queryHashes(vector<uint256> &vtxid) const
-{
-    READLOCK(mempool.cs_txmempool);
-    _queryHashes(vtxid);
-}
+void CTxMemPool::queryHashes(vector<uint256> &vtxid) const { txMap.queryHashes(vtxid); }
 void CTxMemPool::_queryHashes(vector<uint256> &vtxid) const
 {
     vtxid.clear();
@@ -1475,11 +1578,7 @@ CTransactionRef CTxMemPool::_get(const uint256 &hash) const
     return i->GetSharedTx();
 }
 
-CTransactionRef CTxMemPool::get(const uint256 &hash) const
-{
-    READLOCK(cs_txmempool);
-    return _get(hash);
-}
+CTransactionRef CTxMemPool::get(const uint256 &hash) const { return txMap.get(hash); }
 
 static TxMempoolInfo GetInfo(CTxMemPool::indexed_transaction_set::const_iterator it)
 {
@@ -1512,6 +1611,7 @@ void CTxMemPool::PrioritiseTransaction(const uint256 hash,
         txiter it = mapTx.find(hash);
         if (it != mapTx.end())
         {
+            blockCandidate->Invalidate();
             mapTx.modify(it, update_fee_delta(deltas.second));
             // Now update all ancestors' modified fees with descendants
             setEntries setAncestors;
@@ -1593,8 +1693,6 @@ bool CCoinsViewMemPool::HaveCoin(const COutPoint &outpoint) const
 size_t CTxMemPool::DynamicMemoryUsage() const
 {
     READLOCK(cs_txmempool);
-    // Estimate the overhead of mapTx to be 15 pointers + an allocation, as no exact formula for
-    // boost::multi_index_contained is implemented.
     return _DynamicMemoryUsage();
 }
 
@@ -1602,9 +1700,11 @@ size_t CTxMemPool::_DynamicMemoryUsage() const
 {
     AssertLockHeld(cs_txmempool);
     // Estimate the overhead of mapTx to be 15 pointers + an allocation, as no exact formula for
-    // boost::multi_index_contained is implemented.
+    // boost::multi_index_contained is implemented. The bucket arrays of the hashed indexes are charged per entry
+    // rather than as allocated, since they don't shrink when TrimToSize evicts entries.
     return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 15 * sizeof(void *)) * mapTx.size() +
-           memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(mapLinks) +
+           memusage::IncrementalDynamicUsage(mapNextTx) * mapNextTx.size() + memusage::DynamicUsage(mapDeltas) +
+           memusage::IncrementalDynamicUsage(mapLinks) * mapLinks.size() + txMap.DynamicMemoryUsage() +
            cachedInnerUsage;
 }
 
@@ -1916,6 +2016,67 @@ SaltedTxidHasher::SaltedTxidHasher()
 {
 }
 
+void CTxMemPoolTxMap::insert(const CTransactionRef &ptx)
+{
+    Shard &shard = shards[ShardOf(ptx->GetHash())];
+    WRITELOCK(shard.cs);
+    if (shard.txs.emplace(ptx->GetHash(), ptx).second)
+        nSize++;
+}
+
+void CTxMemPoolTxMap::erase(const uint256 &hash)
+{
+    Shard &shard = shards[ShardOf(hash)];
+    WRITELOCK(shard.cs);
+    if (shard.txs.erase(hash))
+        nSize--;
+}
+
+void CTxMemPoolTxMap::clear()
+{
+    for (Shard &shard : shards)
+    {
+        WRITELOCK(shard.cs);
+        nSize -= shard.txs.size();
+        shard.txs.clear();
+    }
+}
+
+CTransactionRef CTxMemPoolTxMap::get(const uint256 &hash) const
+{
+    Shard &shard = shards[ShardOf(hash)];
+    READLOCK(shard.cs);
+    auto it = shard.txs.find(hash);
+    if (it == shard.txs.end())
+        return nullptr;
+    return it->second;
+}
+
+bool CTxMemPoolTxMap::exists(const uint256 &hash) const
+{
+    Shard &shard = shards[ShardOf(hash)];
+    READLOCK(shard.cs);
+    return shard.txs.count(hash) != 0;
+}
+
+size_t CTxMemPoolTxMap::DynamicMemoryUsage() const
+{
+    // Like the mempool's other hashed indexes, the buckets are charged per entry
+    return memusage::IncrementalDynamicUsage(shards[0].txs) * size();
+}
+
+void CTxMemPoolTxMap::queryHashes(std::vector<uint256> &vtxid) const
+{
+    vtxid.clear();
+    vtxid.reserve(size());
+    for (Shard &shard : shards)
+    {
+        READLOCK(shard.cs);
+        for (const auto &item : shard.txs)
+            vtxid.push_back(item.first);
+    }
+}
+
 // Version is current unix epoch time. Nov 1, 2018 at 12am
 static const uint64_t MEMPOOL_DUMP_VERSION = 1541030400;
 
@@ -8,8 +8,10 @@
 #ifndef BITCOIN_TXMEMPOOL_H
 #define BITCOIN_TXMEMPOOL_H
 
+#include <atomic>
 #include <list>
 #include <set>
+#include <unordered_map>
 
 #include "amount.h"
 #include "coins.h"
@@ -18,6 +20,7 @@
 #include "sync.h"
 
 #undef foreach
+#include "boost/multi_index/hashed_index.hpp"
 #include "boost/multi_index/ordered_index.hpp"
 #include "boost/multi_index_container.hpp"
 #include <boost/thread/locks.hpp>
@@ -88,11 +91,30 @@ class CTxMemPool;
 class CTxMemPoolEntry
 {
 private:
-    CTransactionRef tx;
+    // The fields read by the mapTx index comparators come first and are kept together, so that searching or
+    // walking an index touches only the start of each entry and never has to follow tx to the transaction.
+    uint256 txid; //! Cached hash of tx
     CAmount nFee; //! Cached to avoid expensive parent-transaction lookups
+    int64_t feeDelta; //! Used for determining the priority of the transaction for mining in a block
+    int64_t nTime; //! Local time when entering the mempool
+    uint32_t nTxSize; //! Cached serialized size of tx
+
+    // Information about descendants of this transaction that are in the
+    // mempool; if we remove this transaction we must remove all of these
+    // descendants as well.  if nCountWithDescendants is 0, treat this entry as
+    // dirty, and nSizeWithDescendants and nModFeesWithDescendants will not be
+    // correct.
+    uint64_t nSizeWithDescendants; //! size of this transaction and its descendants
+    CAmount nModFeesWithDescendants; //! ... and total fees (all including us)
+
+    // Analogous statistics for ancestor transactions
+    uint64_t nSizeWithAncestors;
+    CAmount nModFeesWithAncestors;
+
+    // Fields that are not used for ordering
+    CTransactionRef tx;
     size_t nModSize; //! ... and modified size for priority
     size_t nUsageSize; //! ... and total memory usage
-    int64_t nTime; //! Local time when entering the mempool
     double entryPriority; //! Priority when entering the mempool
     unsigned int entryHeight; //! Chain height when entering the mempool
     bool hadNoDependencies; //! Not dependent on any other txs when it entered the mempool
@@ -101,22 +123,9 @@ private:
     unsigned int sigOpCount; //! Legacy sig ops plus P2SH sig op count
     uint64_t runtimeSigOpCount; //! Runtime signature operation count
     uint64_t runtimeSighashBytes; //! Runtime bytes hashed for signature operations
-    int64_t feeDelta; //! Used for determining the priority of the transaction for mining in a block
     LockPoints lockPoints; //! Track the height and time at which tx was final
-
-    // Information about descendants of this transaction that are in the
-    // mempool; if we remove this transaction we must remove all of these
-    // descendants as well.  if nCountWithDescendants is 0, treat this entry as
-    // dirty, and nSizeWithDescendants and nModFeesWithDescendants will not be
-    // correct.
     uint64_t nCountWithDescendants; //! number of descendant transactions
-    uint64_t nSizeWithDescendants; //! ... and size
-    CAmount nModFeesWithDescendants; //! ... and total fees (all including us)
-
-    // Analogous statistics for ancestor transactions
     uint64_t nCountWithAncestors;
-    uint64_t nSizeWithAncestors;
-    CAmount nModFeesWithAncestors;
     unsigned int nSigOpCountWithAncestors;
 
 public:
@@ -138,13 +147,15 @@ public:
 
     const CTransaction &GetTx() const { return *this->tx; }
     CTransactionRef GetSharedTx() const { return this->tx; }
+    /** The hash of the transaction, without dereferencing it */
+    const uint256 &GetTxHash() const { return txid; }
     /**
      * Fast calculation of lower bound of current priority as update
      * from entry priority. Only inputs that were originally in-chain will age.
      */
     double GetPriority(unsigned int currentHeight) const;
     const CAmount &GetFee() const { return nFee; }
-    size_t GetTxSize() const { return this->tx->GetTxSize(); }
+    size_t GetTxSize() const { return nTxSize; }
     int64_t GetTime() const { return nTime; }
     unsigned int GetHeight() const { return entryHeight; }
     bool WasClearAtEntry() const { return hadNoDependencies; }
@@ -257,7 +268,7 @@ private:
 struct mempoolentry_txid
 {
     typedef uint256 result_type;
-    result_type operator()(const CTxMemPoolEntry &entry) const { return entry.GetTx().GetHash(); }
+    result_type operator()(const CTxMemPoolEntry &entry) const { return entry.GetTxHash(); }
 };
 
 /** \class CompareTxMemPoolEntryByDescendantScore
@@ -311,7 +322,7 @@ public:
         double f2 = (double)b.GetModifiedFee() * a.GetTxSize();
         if (f1 == f2)
         {
-            return b.GetTx().GetHash() < a.GetTx().GetHash();
+            return b.GetTxHash() < a.GetTxHash();
         }
         return f1 > f2;
     }
@@ -367,6 +378,7 @@ struct ancestor_score
 };
 
 class CBlockPolicyEstimator;
+class CBlockCandidate;
 
 /**
  * Information about a mempool transaction
@@ -420,6 +432,44 @@ public:
     size_t operator()(const uint256 &txid) const { return SipHashUint256(k0, k1, txid); }
 };
 
+/**
+ * A txid to transaction map that mirrors CTxMemPool::mapTx and is read without taking cs_txmempool.
+ *
+ * The map is split by txid into shards, each with its own shared lock, so a relay lookup can only ever wait for
+ * the insert or erase of another transaction in the same shard, never for a whole commit or block connect.  The
+ * mempool updates it under its write lock wherever mapTx gains or loses an entry, so a reader may see a
+ * transaction that the mempool is in the middle of adding or removing.
+ */
+class CTxMemPoolTxMap
+{
+public:
+    static const size_t NUM_SHARDS = 64;
+
+private:
+    struct Shard
+    {
+        CSharedCriticalSection cs;
+        std::unordered_map<uint256, CTransactionRef, SaltedTxidHasher> txs GUARDED_BY(cs);
+    };
+    mutable Shard shards[NUM_SHARDS];
+    std::atomic<uint64_t> nSize{0};
+
+    static size_t ShardOf(const uint256 &hash) { return hash.GetCheapHash() % NUM_SHARDS; }
+
+public:
+    void insert(const CTransactionRef &ptx);
+    void erase(const uint256 &hash);
+    void clear();
+
+    /** Return the transaction with this txid, or nullptr if there is none */
+    CTransactionRef get(const uint256 &hash) const;
+    bool exists(const uint256 &hash) const;
+    /** Replace the contents of vtxid with the txid of every transaction in the map */
+    void queryHashes(std::vector<uint256> &vtxid) const;
+    size_t size() const { return nSize.load(); }
+    size_t DynamicMemoryUsage() const;
+};
+
 /**
  * CTxMemPool stores valid-according-to-the-current-best-chain
  * transactions that may be included in the next block.
@@ -526,8 +576,8 @@ public:
     typedef boost::multi_index_container<
         CTxMemPoolEntry,
         boost::multi_index::indexed_by<
-            // sorted by txid
-            boost::multi_index::ordered_unique<mempoolentry_txid>,
+            // hashed by txid
+            boost::multi_index::hashed_unique<mempoolentry_txid, SaltedTxidHasher>,
             // sorted by fee rate
             boost::multi_index::ordered_non_unique<boost::multi_index::tag<descendant_score>,
                 boost::multi_index::identity<CTxMemPoolEntry>,
@@ -551,7 +601,7 @@ public:
     typedef indexed_transaction_set::nth_index<0>::type::iterator txiter;
     struct CompareIteratorByHash
     {
-        bool operator()(const txiter &a, const txiter &b) const { return a->GetTx().GetHash() < b->GetTx().GetHash(); }
+        bool operator()(const txiter &a, const txiter &b) const { return a->GetTxHash() < b->GetTxHash(); }
     };
     typedef std::set<txiter, CompareIteratorByHash> setEntries;
     typedef std::map<CTxMemPool::txiter, TxMempoolOriginalState, CTxMemPool::CompareIteratorByHash>
@@ -580,7 +630,13 @@ private:
         setEntries children;
     };
 
-    typedef std::map<txiter, TxLinks, CompareIteratorByHash> txlinksMap;
+    // Entries never move within mapTx so their address identifies them as long as they are in the pool
+    struct TxiterHasher
+    {
+        size_t operator()(const txiter &it) const { return std::hash<const CTxMemPoolEntry *>()(&*it); }
+    };
+
+    typedef std::unordered_map<txiter, TxLinks, TxiterHasher> txlinksMap;
     txlinksMap mapLinks;
 
     void _UpdateParent(txiter entry, txiter parent, bool add);
@@ -588,8 +644,12 @@ private:
 
 public:
     // Connects an output to the transaction that spends it.
-    std::map<COutPoint, CInPoint> mapNextTx;
+    std::unordered_map<COutPoint, CInPoint, SaltedOutpointHasher> mapNextTx;
     std::map<uint256, std::pair<double, CAmount> > mapDeltas;
+    // The transactions selected for the last block template, followed as entries are added and removed.
+    CBlockCandidate *blockCandidate;
+    // Every transaction in mapTx by txid, for lookups that must not wait on cs_txmempool
+    CTxMemPoolTxMap txMap;
 
     /** Create a new CTxMemPool.
      *  minReasonableRelayFee should be a feerate which is, roughly, somewhere
@@ -748,6 +808,13 @@ public:
         setEntries *inBlock = nullptr,
         bool fSearchForParents = true) const;
 
+    /** Changes whenever a transaction is added to or removed from the pool.  Caller must hold cs_txmempool. */
+    unsigned int _GetTransactionsUpdated() const
+    {
+        AssertLockHeld(cs_txmempool);
+        return nTransactionsUpdated;
+    }
+
     /** Populate setDescendants with all in-mempool descendants of hash.  Assumes that setDescendants includes
      *  all in-mempool descendants of anything already in it.  */
     void _CalculateDescendants(txiter it, setEntries &setDescendants, mapEntryHistory *mapTxnChainTips = nullptr);
@@ -765,6 +832,8 @@ public:
     bool GetTxProperties(const uint256 &hash, CTxProperties *txProps) const
     {
         DbgAssert(txProps, return false);
+        if (!txMap.exists(hash))
+            return false;
         READLOCK(cs_txmempool);
         auto entryPtr = mapTx.find(hash);
         if (entryPtr == mapTx.end())
@@ -819,17 +888,12 @@ public:
         return totalTxSize;
     }
 
-    bool exists(const uint256 &hash) const
-    {
-        READLOCK(cs_txmempool);
-        return (mapTx.count(hash) != 0);
-    }
+    bool exists(const uint256 &hash) const { return txMap.exists(hash); }
     bool _exists(const uint256 &hash) const { return (mapTx.count(hash) != 0); }
     bool exists(const COutPoint &outpoint) const
     {
-        READLOCK(cs_txmempool);
-        auto it = mapTx.find(outpoint.hash);
-        return (it != mapTx.end() && outpoint.n < it->GetTx().vout.size());
+        CTransactionRef ptx = txMap.get(outpoint.hash);
+        return (ptx != nullptr && outpoint.n < ptx->vout.size());
     }
 
     CTransactionRef get(const uint256 &hash) const;
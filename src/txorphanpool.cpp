@@ -5,6 +5,7 @@
 
 #include "txorphanpool.h"
 #include "main.h"
+#include "memusage.h"
 #include "timedata.h"
 #include "util.h"
 #include "utiltime.h"
@@ -19,6 +20,18 @@ bool CTxOrphanPool::AlreadyHaveOrphan(const uint256 &hash)
     return false;
 }
 
+// Memory used by the orphan pool's indexes for one orphan: its multi-index node, its slot in vOrphanList and,
+// for each input, an entry in mapOrphanTransactionsByPrev.  Counting this along with the transaction itself means
+// that a flood of tiny orphans is bounded by the byte limit just like a few large ones.
+static uint64_t OrphanIndexUsage(const CTransaction &tx)
+{
+    static const std::set<uint256> setEmpty;
+    return memusage::MallocUsage(sizeof(CTxOrphanPool::COrphanTx) + 6 * sizeof(void *)) + sizeof(uint256) +
+           tx.vin.size() * (memusage::IncrementalDynamicUsage(setEmpty) +
+                               memusage::MallocUsage(sizeof(std::pair<const uint256, std::set<uint256> >) +
+                                                     sizeof(void *)));
+}
+
 bool CTxOrphanPool::AddOrphanTx(const CTransactionRef ptx, NodeId peer)
 {
     AssertWriteLockHeld(cs_orphanpool);
@@ -37,8 +50,9 @@ bool CTxOrphanPool::AddOrphanTx(const CTransactionRef ptx, NodeId peer)
         return false;
     }
 
-    uint64_t nTxMemoryUsed = RecursiveDynamicUsage(*ptx) + sizeof(ptx);
-    mapOrphanTransactions.emplace(hash, COrphanTx{ptx, peer, GetTime(), nTxMemoryUsed});
+    uint64_t nTxMemoryUsed = RecursiveDynamicUsage(*ptx) + sizeof(ptx) + OrphanIndexUsage(*ptx);
+    mapOrphanTransactions.insert(COrphanTx{ptx, peer, GetTime(), nTxMemoryUsed, vOrphanList.size()});
+    vOrphanList.push_back(hash);
     for (const CTxIn &txin : ptx->vin)
         mapOrphanTransactionsByPrev[txin.prevout.hash].insert(hash);
 
@@ -48,16 +62,14 @@ bool CTxOrphanPool::AddOrphanTx(const CTransactionRef ptx, NodeId peer)
     return true;
 }
 
-bool CTxOrphanPool::EraseOrphanTx(uint256 hash)
+void CTxOrphanPool::_EraseOrphan(indexed_orphan_set::iterator it)
 {
     AssertWriteLockHeld(cs_orphanpool);
 
-    std::map<uint256, COrphanTx>::iterator it = mapOrphanTransactions.find(hash);
-    if (it == mapOrphanTransactions.end())
-        return false;
-    for (const CTxIn &txin : it->second.ptx->vin)
+    const uint256 hash = it->ptx->GetHash();
+    for (const CTxIn &txin : it->ptx->vin)
     {
-        std::map<uint256, std::set<uint256> >::iterator itPrev = mapOrphanTransactionsByPrev.find(txin.prevout.hash);
+        auto itPrev = mapOrphanTransactionsByPrev.find(txin.prevout.hash);
         if (itPrev == mapOrphanTransactionsByPrev.end())
             continue;
         itPrev->second.erase(hash);
@@ -65,41 +77,65 @@ bool CTxOrphanPool::EraseOrphanTx(uint256 hash)
             mapOrphanTransactionsByPrev.erase(itPrev);
     }
 
-    nBytesOrphanPool -= it->second.nOrphanTxSize;
-    LOG(MEMPOOL, "Erased orphan tx %s of size %ld bytes, orphan pool bytes:%ld\n", it->second.ptx->GetHash().ToString(),
-        it->second.nOrphanTxSize, nBytesOrphanPool);
+    // Fill the hole in vOrphanList with the last orphan in the list
+    const size_t nPos = it->nListPos;
+    if (nPos != vOrphanList.size() - 1)
+    {
+        vOrphanList[nPos] = vOrphanList.back();
+        mapOrphanTransactions.find(vOrphanList[nPos])->nListPos = nPos;
+    }
+    vOrphanList.pop_back();
+
+    nBytesOrphanPool -= it->nOrphanTxSize;
+    LOG(MEMPOOL, "Erased orphan tx %s of size %ld bytes, orphan pool bytes:%ld\n", hash.ToString(),
+        it->nOrphanTxSize, nBytesOrphanPool);
     mapOrphanTransactions.erase(it);
+}
+
+bool CTxOrphanPool::EraseOrphanTx(uint256 hash)
+{
+    AssertWriteLockHeld(cs_orphanpool);
+
+    indexed_orphan_set::iterator it = mapOrphanTransactions.find(hash);
+    if (it == mapOrphanTransactions.end())
+        return false;
+    _EraseOrphan(it);
     return true;
 }
 
 void CTxOrphanPool::EraseOrphansByTime()
 {
     AssertWriteLockHeld(cs_orphanpool);
-    // Because we have to iterate through the entire orphan cache which can be large we don't want to check this
-    // every time a tx enters the mempool but just once every 5 minutes is good enough.
+    // Expired orphans are found from the oldest end of the entry time index so this is cheap, but there is
+    // still no need to check every time a tx enters the mempool: once every 5 minutes is good enough.
     if (GetTime() < nLastOrphanCheck + 5 * 60)
         return;
     int64_t nOrphanTxCutoffTime = GetTime() - GetArg("-orphanpoolexpiry", DEFAULT_ORPHANPOOL_EXPIRY) * 60 * 60;
-    std::map<uint256, COrphanTx>::iterator iter = mapOrphanTransactions.begin();
-    while (iter != mapOrphanTransactions.end())
+    auto &byTime = mapOrphanTransactions.get<entry_time>();
+    while (!byTime.empty() && byTime.begin()->nEntryTime < nOrphanTxCutoffTime)
     {
-        std::map<uint256, COrphanTx>::iterator mi = iter++; // increment to avoid iterator becoming invalid
-        int64_t nEntryTime = mi->second.nEntryTime;
-        if (nEntryTime < nOrphanTxCutoffTime)
-        {
-            uint256 txHash = mi->second.ptx->GetHash();
-
-            // Uncache any coins that may exist for orphans that will be erased
-            pcoinsTip->UncacheTx(*mi->second.ptx);
-
-            LOG(MEMPOOL, "Erased old orphan tx %s of age %d seconds\n", txHash.ToString(), GetTime() - nEntryTime);
-            EraseOrphanTx(txHash);
-        }
+        indexed_orphan_set::iterator it = mapOrphanTransactions.project<0>(byTime.begin());
+
+        // Uncache any coins that may exist for orphans that will be erased
+        pcoinsTip->UncacheTx(*it->ptx);
+
+        LOG(MEMPOOL, "Erased old orphan tx %s of age %d seconds\n", it->ptx->GetHash().ToString(),
+            GetTime() - it->nEntryTime);
+        _EraseOrphan(it);
     }
 
     nLastOrphanCheck = GetTime();
 }
 
+void CTxOrphanPool::_clear()
+{
+    AssertWriteLockHeld(cs_orphanpool);
+    mapOrphanTransactions.clear();
+    mapOrphanTransactionsByPrev.clear();
+    vOrphanList.clear();
+    nBytesOrphanPool = 0;
+}
+
 unsigned int CTxOrphanPool::LimitOrphanTxSize(unsigned int nMaxOrphans, uint64_t nMaxBytes)
 {
     AssertWriteLockHeld(cs_orphanpool);
@@ -111,15 +147,12 @@ unsigned int CTxOrphanPool::LimitOrphanTxSize(unsigned int nMaxOrphans, uint64_t
     while (mapOrphanTransactions.size() > nMaxOrphans || nBytesOrphanPool > nMaxBytes)
     {
         // Evict a random orphan:
-        uint256 randomhash = GetRandHash();
-        std::map<uint256, COrphanTx>::iterator it = mapOrphanTransactions.lower_bound(randomhash);
-        if (it == mapOrphanTransactions.end())
-            it = mapOrphanTransactions.begin();
+        indexed_orphan_set::iterator it = mapOrphanTransactions.find(vOrphanList[GetRand(vOrphanList.size())]);
 
         // Uncache any coins that may exist for orphans that will be erased
-        pcoinsTip->UncacheTx(*it->second.ptx);
+        pcoinsTip->UncacheTx(*it->ptx);
 
-        EraseOrphanTx(it->first);
+        _EraseOrphan(it);
         ++nEvicted;
     }
     return nEvicted;
@@ -128,6 +161,6 @@ unsigned int CTxOrphanPool::LimitOrphanTxSize(unsigned int nMaxOrphans, uint64_t
 void CTxOrphanPool::QueryHashes(std::vector<uint256> &vHashes)
 {
     READLOCK(cs_orphanpool);
-    for (auto &it : mapOrphanTransactions)
-        vHashes.push_back(it.first);
+    for (const COrphanTx &orphan : mapOrphanTransactions)
+        vHashes.push_back(orphan.ptx->GetHash());
 }
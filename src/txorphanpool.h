@@ -9,11 +9,18 @@
 #include "net.h"
 #include "primitives/transaction.h"
 #include "sync.h"
+#include "txmempool.h"
 #include "uint256.h"
 
-#include <map>
 #include <set>
 #include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index_container.hpp>
 
 class CTxOrphanPool
 {
@@ -22,7 +29,7 @@ private:
     int64_t nLastOrphanCheck;
 
 public:
-    //! Current in memory footprint of all txns in the orphan pool.
+    //! Current in memory footprint of all txns in the orphan pool, including the pool's own index overhead.
     uint64_t nBytesOrphanPool;
 
     struct COrphanTx
@@ -31,12 +38,42 @@ public:
         NodeId fromPeer;
         int64_t nEntryTime;
         uint64_t nOrphanTxSize;
+        //! Position of this orphan in vOrphanList
+        mutable size_t nListPos;
+    };
+
+    struct orphan_txid
+    {
+        typedef uint256 result_type;
+        result_type operator()(const COrphanTx &orphan) const { return orphan.ptx->GetHash(); }
+    };
+    struct entry_time
+    {
     };
 
+    typedef boost::multi_index_container<COrphanTx,
+        boost::multi_index::indexed_by<
+            // hashed by txid
+            boost::multi_index::hashed_unique<orphan_txid, SaltedTxidHasher>,
+            // sorted by entry time
+            boost::multi_index::ordered_non_unique<boost::multi_index::tag<entry_time>,
+                boost::multi_index::member<COrphanTx, int64_t, &COrphanTx::nEntryTime> > > >
+        indexed_orphan_set;
+
     CSharedCriticalSection cs_orphanpool;
-    std::map<uint256, COrphanTx> mapOrphanTransactions GUARDED_BY(cs_orphanpool);
-    std::map<uint256, std::set<uint256> > mapOrphanTransactionsByPrev GUARDED_BY(cs_orphanpool);
+    indexed_orphan_set mapOrphanTransactions GUARDED_BY(cs_orphanpool);
+    //! Orphans indexed by the txid of each transaction that they spend
+    std::unordered_map<uint256, std::set<uint256>, SaltedTxidHasher> mapOrphanTransactionsByPrev GUARDED_BY(
+        cs_orphanpool);
+
+private:
+    //! Every orphan's txid in no particular order, so that a random orphan can be evicted in constant time
+    std::vector<uint256> vOrphanList GUARDED_BY(cs_orphanpool);
 
+    //! Erase the orphan and update the indexes. The iterator must be valid.
+    void _EraseOrphan(indexed_orphan_set::iterator it);
+
+public:
     CTxOrphanPool();
 
     //! Do we already have this orphan in the orphan pool
@@ -52,6 +89,9 @@ public:
     //! Expire old orphans from the orphan pool
     void EraseOrphansByTime();
 
+    //! Remove every orphan from the orphan pool
+    void _clear();
+
     //! Limit the orphan pool size by either number of transactions or the max orphan pool size allowed.
     unsigned int LimitOrphanTxSize(unsigned int nMaxOrphans, uint64_t nMaxBytes);
 
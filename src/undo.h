@@ -27,7 +27,7 @@ public:
     template <typename Stream>
     void Serialize(Stream &s) const
     {
-        ::Serialize(s, VARINT(txout->nHeight * 2 + (txout->fCoinBase ? 1 : 0), VarIntMode::NONNEGATIVE_SIGNED));
+        ::Serialize(s, VARINT((int)(txout->nHeight * 2 + (txout->fCoinBase ? 1 : 0)), VarIntMode::NONNEGATIVE_SIGNED));
         if (txout->nHeight > 0)
         {
             // Required to maintain compatibility with older undo format.
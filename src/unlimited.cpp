@@ -2092,9 +2092,8 @@ UniValue validateblocktemplate(const UniValue &params, bool fHelp)
 extern std::vector<std::string> vUseDNSSeeds;
 extern std::list<CNode *> vNodesDisconnected;
 extern std::set<CNetAddr> setservAddNodeAddresses;
-extern std::map<uint256, CTxCommitData> *txCommitQ;
+extern CTxCommitBatch *txCommitQ;
 extern std::queue<CTxInputData> txDeferQ;
-extern std::queue<CTxInputData> txInQ;
 extern UniValue getstructuresizes(const UniValue &params, bool fHelp)
 {
     UniValue ret(UniValue::VOBJ);
@@ -2162,6 +2161,10 @@ extern UniValue getstructuresizes(const UniValue &params, bool fHelp)
     if (txCommitQ)
         ret.pushKV("txCommitQ", (uint64_t)txCommitQ->size());
     ret.pushKV("txInQ", (uint64_t)txInQ.size());
+    UniValue shards(UniValue::VARR);
+    for (uint64_t nDepth : txInQ.ShardDepths())
+        shards.push_back(nDepth);
+    ret.pushKV("txInQ.shards", shards);
     ret.pushKV("txDeferQ", (uint64_t)txDeferQ.size());
 #ifdef DEBUG_LOCKORDER
     {
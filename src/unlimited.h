@@ -45,6 +45,10 @@ enum
 
     // How many blocks from tip do we consider than chain to be "nearly" synced.
     DEFAULT_BLOCKS_FROM_TIP = 2,
+
+    // Threads that load the coins spent by a block from disk. They mostly wait on I/O, so there can be more of them
+    // than there are cores.
+    DEFAULT_PREFETCH_THREADS = 8,
 };
 
 class CBlock;
@@ -109,6 +113,12 @@ extern CTweak<uint64_t> maxScriptOps;
 // The maximum number of allowed sigcheck operations (consensus param)
 extern CTweak<uint64_t> maxSigChecks;
 
+// Verify the Schnorr signatures of a block in batches
+extern CTweak<bool> batchSchnorrTweak;
+
+// Number of threads that load the coins spent by a block before it is connected
+extern CTweak<unsigned int> coinsPrefetchThreads;
+
 // print out a configuration warning during initialization
 // bool InitWarning(const std::string &str);
 
@@ -18,6 +18,7 @@
 #include "index/txindex.h"
 #include "init.h"
 #include "requestManager.h"
+#include "script/sigcache.h"
 #include "sync.h"
 #include "timedata.h"
 #include "txadmission.h"
@@ -27,10 +28,11 @@
 #include "validationinterface.h"
 
 #include <boost/scope_exit.hpp>
+#include <atomic>
+#include <thread>
 #include <unordered_set>
 
 extern CTweak<unsigned int> unconfPushAction;
-void ProcessOrphans(std::vector<uint256> &vWorkQueue);
 
 class Hasher
 {
@@ -607,9 +609,7 @@ void UnloadBlockIndex()
 {
     {
         WRITELOCK(orphanpool.cs_orphanpool);
-        orphanpool.mapOrphanTransactions.clear();
-        orphanpool.mapOrphanTransactionsByPrev.clear();
-        orphanpool.nBytesOrphanPool = 0;
+        orphanpool._clear();
     }
 
     nPreferredDownload.store(0);
@@ -2059,6 +2059,52 @@ DisconnectResult DisconnectBlock(const CBlock &block, const CBlockIndex *pindex,
     return fClean ? DISCONNECT_OK : DISCONNECT_UNCLEAN;
 }
 
+// Fewer inputs than this are not worth starting another prefetch thread for
+static const size_t PREFETCH_COINS_PER_THREAD = 64;
+
+void PrefetchBlockCoins(const CBlock &block, const CCoinsViewCache *view)
+{
+    const size_t nMaxThreads = coinsPrefetchThreads.Value();
+    if (nMaxThreads == 0 || block.vtx.size() < 2)
+        return;
+    int64_t nStart = GetStopwatchMicros();
+
+    std::unordered_set<uint256, SaltedTxidHasher> setBlockTxids;
+    setBlockTxids.reserve(block.vtx.size());
+    for (const CTransactionRef &ptx : block.vtx)
+        setBlockTxids.insert(ptx->GetHash());
+
+    std::vector<COutPoint> vOutpoints;
+    for (size_t i = 1; i < block.vtx.size(); i++)
+    {
+        for (const CTxIn &txin : block.vtx[i]->vin)
+        {
+            bool fSpent = false;
+            if (!setBlockTxids.count(txin.prevout.hash) && !view->HaveCoinInCache(txin.prevout, fSpent))
+                vOutpoints.push_back(txin.prevout);
+        }
+    }
+    if (vOutpoints.empty())
+        return;
+
+    // Reads are handed out one at a time, since how long each takes depends on where it is on disk
+    std::atomic<size_t> nNext(0);
+    auto fetch = [&view, &vOutpoints, &nNext]() {
+        for (size_t i = nNext++; i < vOutpoints.size(); i = nNext++)
+            view->GetCoinFromDB(vOutpoints[i]);
+    };
+    const size_t nThreads = std::max<size_t>(
+        1, std::min<size_t>(nMaxThreads, vOutpoints.size() / PREFETCH_COINS_PER_THREAD));
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < nThreads; t++)
+        threads.emplace_back(fetch);
+    fetch();
+    for (std::thread &thread : threads)
+        thread.join();
+
+    LOG(BENCH, "Prefetched %u coins for block %s with %u threads in %.2fms\n", vOutpoints.size(),
+        block.GetHash().ToString(), nThreads, (GetStopwatchMicros() - nStart) * 0.001);
+}
 
 bool ConnectBlockPrevalidations(const CBlock &block,
     CValidationState &state,
@@ -2250,6 +2296,11 @@ bool ConnectBlockDependencyOrdering(const CBlock &block,
     // with the mutex so that the checking of inputs can be done with the chosen scriptcheckqueue.
     CCheckQueue<CScriptCheck> *pScriptQueue(PV->GetScriptCheckQueue());
 
+    // The Schnorr signatures checked by the script threads are verified in batches. This must be declared before
+    // the control, so that the script threads are finished with it before it is destroyed.
+    CSchnorrBatch schnorrBatch;
+    CSchnorrBatch *pSchnorrBatch = (batchSchnorrTweak.Value() && PV->ThreadCount()) ? &schnorrBatch : nullptr;
+
     // Aquire the control that is used to wait for the script threads to finish. Do this after aquiring the
     // scoped lock to ensure the scriptqueue is free and available.
     CCheckQueueControl<CScriptCheck> control(fScriptChecks && PV->ThreadCount() ? pScriptQueue : nullptr);
@@ -2263,6 +2314,8 @@ bool ConnectBlockDependencyOrdering(const CBlock &block,
         }
         BOOST_SCOPE_EXIT_END
 
+        // Warm the coins cache from disk before the inputs are looked up one at a time
+        PrefetchBlockCoins(block, pcoinsTip);
 
         // Start checking Inputs
         // When in parallel mode then unlock cs_main for this loop to give any other threads
@@ -2344,6 +2397,8 @@ bool ConnectBlockDependencyOrdering(const CBlock &block,
                             return error("%s: block %s CheckInputs on %s failed with %s", __func__,
                                 block.GetHash().ToString(), tx.GetHash().ToString(), FormatStateMessage(state));
                         }
+                        for (CScriptCheck &check : vChecks)
+                            check.SetSchnorrBatch(pSchnorrBatch);
                         control.Add(vChecks);
                         nChecked++;
                     }
@@ -2378,6 +2433,11 @@ bool ConnectBlockDependencyOrdering(const CBlock &block,
             // if we end up here then the signature verification failed and we must re-lock cs_main before returning.
             return state.DoS(100, false, REJECT_INVALID, "bad-blk-signatures", false, "parallel script check failed");
         }
+        if (pSchnorrBatch && !pSchnorrBatch->Flush())
+        {
+            return state.DoS(
+                100, false, REJECT_INVALID, "bad-blk-signatures", false, "batched schnorr signature check failed");
+        }
 
         if (PV->QuitReceived(this_id, fParallel))
         {
@@ -2445,6 +2505,11 @@ bool ConnectBlockCanonicalOrdering(const CBlock &block,
     // with the mutex so that the checking of inputs can be done with the chosen scriptcheckqueue.
     CCheckQueue<CScriptCheck> *pScriptQueue(PV->GetScriptCheckQueue());
 
+    // The Schnorr signatures checked by the script threads are verified in batches. This must be declared before
+    // the control, so that the script threads are finished with it before it is destroyed.
+    CSchnorrBatch schnorrBatch;
+    CSchnorrBatch *pSchnorrBatch = (batchSchnorrTweak.Value() && PV->ThreadCount()) ? &schnorrBatch : nullptr;
+
     // Aquire the control that is used to wait for the script threads to finish. Do this after aquiring the
     // scoped lock to ensure the scriptqueue is free and available.
     CCheckQueueControl<CScriptCheck> control(fScriptChecks && PV->ThreadCount() ? pScriptQueue : nullptr);
@@ -2470,6 +2535,9 @@ bool ConnectBlockCanonicalOrdering(const CBlock &block,
 
         txResourceTracker.resize(block.vtx.size());
 
+        // Warm the coins cache from disk before the inputs are looked up one at a time
+        PrefetchBlockCoins(block, pcoinsTip);
+
         // Outputs then Inputs algorithm: add outputs to the coin cache
         // and validate lexical ordering
         uint256 prevTxHash;
@@ -2588,6 +2656,8 @@ bool ConnectBlockCanonicalOrdering(const CBlock &block,
                             return error("%s: block %s CheckInputs on %s failed with %s", __func__,
                                 block.GetHash().ToString(), tx.GetHash().ToString(), FormatStateMessage(state));
                         }
+                        for (CScriptCheck &check : vChecks)
+                            check.SetSchnorrBatch(pSchnorrBatch);
                         control.Add(vChecks);
                         nChecked++;
                     }
@@ -2624,6 +2694,11 @@ bool ConnectBlockCanonicalOrdering(const CBlock &block,
             // if we end up here then the signature verification failed and we must re-lock cs_main before returning.
             return state.DoS(100, false, REJECT_INVALID, "bad-blk-signatures", false, "parallel script check failed");
         }
+        if (pSchnorrBatch && !pSchnorrBatch->Flush())
+        {
+            return state.DoS(
+                100, false, REJECT_INVALID, "bad-blk-signatures", false, "batched schnorr signature check failed");
+        }
 
         if (may2020Active)
         {
@@ -3259,7 +3334,7 @@ bool ConnectTip(CValidationState &state,
         {
             vWhatChanged.push_back(pblock->vtx[j]->GetHash());
         }
-        ProcessOrphans(vWhatChanged);
+        QueueOrphanWork(vWhatChanged);
     }
 
     int64_t nTime4 = GetStopwatchMicros();
@@ -119,6 +119,13 @@ uint32_t GetBlockScriptFlags(const CBlockIndex *pindex, const Consensus::Params
  *  of problems. Note that in any case, coins may be modified. */
 DisconnectResult DisconnectBlock(const CBlock &block, const CBlockIndex *pindex, CCoinsViewCache &view);
 
+/**
+ * Load the coins spent by a block from the coins database into the cache of view, using up to
+ * validation.prefetchThreads reader threads, so that connecting the block does not wait on the database one input
+ * at a time.  Coins that are already cached, or are created within the block, are skipped.
+ */
+void PrefetchBlockCoins(const CBlock &block, const CCoinsViewCache *view);
+
 /** Apply the effects of this block (with given index) on the UTXO set represented by coins */
 bool ConnectBlock(const CBlock &block,
     CValidationState &state,